@@ -1,17 +1,35 @@
 #include <iostream>
 #include <fstream>
 #include <filesystem>
-#include <miniz/miniz.h>
+#include <optional>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <barrier>
 
 #include "lexer/DecoyLexer.hpp"
 #include "parser/DecoyParser.hpp"
+#include "parser/DecoyParallelParser.hpp"
 #include "codegen/DecoySymbolTable.hpp"
-#include "codegen/DecoySemanticAnalyzer.hpp"
-#include "codegen/DecoyCodeGenerator.hpp"
+#include "codegen/DecoyCppGenerator.hpp"
+#include "codegen/DecoyProfile.hpp"
+#include "codegen/DecoyStringPool.hpp"
+#include "codegen/DecoyTiming.hpp"
+#include "codegen/DecoyRepeatLowering.hpp"
+#include "codegen/DecoyExpressions.hpp"
+#include "codegen/DecoyInliner.hpp"
+#include "codegen/DecoyVerifier.hpp"
+#include "archive/DecoyArchive.hpp"
+#include "cache/DecoyBuildCache.hpp"
+#include "cache/DecoyHash.hpp"
+#include "watch/DecoyFileWatcher.hpp"
+#include "libdecoyc/DecoyLibrary.hpp"
+#include "manifest/DecoyManifest.hpp"
 
 #include "DecoyDefs.hpp"
 
 #include <iomanip>
+#include <sstream>
 
 // Helper to convert TokenType to a string
 std::string getTokenTypeName(TokenType type) {
@@ -23,6 +41,7 @@ std::string getTokenTypeName(TokenType type) {
         case TokenType::LABEL:       return "LABEL";
         case TokenType::STRING:      return "STRING";
         case TokenType::COMMA:       return "COMMA";
+        case TokenType::OPERATOR:    return "OPERATOR";
         case TokenType::END_OF_LINE: return "END_OF_LINE";
         default:                     return "UNKNOWN";
     }
@@ -70,18 +89,604 @@ void printAST(const std::vector<InstructionNode>& ast, std::string filename) {
     std::cout << "----------------\n";
 }
 
+bool sameProgram(const std::vector<InstructionNode>& a, const std::vector<InstructionNode>& b) {
+    auto sameToken = [](const Token& x, const Token& y) {
+        return x.type == y.type && x.value == y.value && x.line == y.line && x.column == y.column;
+    };
+
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [&](const InstructionNode& x, const InstructionNode& y) {
+        return sameToken(x.instruction, y.instruction) &&
+            std::equal(x.operands.begin(), x.operands.end(), y.operands.begin(), y.operands.end(), sameToken);
+    });
+}
+
+// Times lexing + parsing of each input on 1..maxThreads threads and checks every result against the serial one
+void benchmarkFrontend(const std::vector<std::string>& inputFiles, size_t maxThreads) {
+    for (const auto& input : inputFiles) {
+        std::ifstream sourceFile(input);
+        if (!sourceFile.is_open()) {
+            throw std::runtime_error("Could not open source file: " + input);
+        }
+        std::string source((std::istreambuf_iterator(sourceFile)),
+                     std::istreambuf_iterator<char>());
+
+        std::cout << "Frontend Scaling (" << input << ", " << source.size() << " bytes):\n";
+        std::cout << "----------------\n";
+
+        std::vector<InstructionNode> serial;
+        double serialSeconds = 0;
+        for (size_t threads = 1; threads <= maxThreads; threads++) {
+            // Best of three runs
+            double seconds = 0;
+            std::vector<InstructionNode> program;
+            for (int run = 0; run < 3; run++) {
+                auto start = std::chrono::steady_clock::now();
+                program = ParallelParser(source, threads).parse();
+                double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                seconds = run == 0 ? elapsed : std::min(seconds, elapsed);
+            }
+
+            if (threads == 1) {
+                serial = std::move(program);
+                serialSeconds = seconds;
+            } else if (!sameProgram(serial, program)) {
+                throw std::runtime_error("Parallel frontend output differs from the serial one with " + std::to_string(threads) + " threads");
+            }
+
+            std::cout << "  " << std::setw(3) << threads << " threads "
+                      << std::setw(12) << std::fixed << std::setprecision(6) << seconds << "s "
+                      << std::setw(8) << std::setprecision(2) << serialSeconds / seconds << "x\n";
+        }
+        std::cout << "  " << serial.size() << " instructions, identical on every thread count\n";
+        std::cout << "----------------\n\n";
+    }
+}
+
+// Lexes, parses and analyzes every input without generating code or touching any archive,
+// and prints every error of every script. Scripts are checked in parallel.
+int checkScripts(const std::vector<std::string>& inputFiles, size_t threads) {
+    auto start = std::chrono::steady_clock::now();
+
+    size_t workers = std::max<size_t>(1, std::min(threads, inputFiles.size()));
+    std::vector<CompileResult> results(inputFiles.size());
+    std::atomic<size_t> next = 0;
+
+    auto work = [&] {
+        CompilerContext context;
+        CompilerSettings settings;
+        settings.threads = std::max<size_t>(1, threads / workers);
+
+        std::string source;
+        for (size_t i; (i = next++) < inputFiles.size();) {
+            std::ifstream sourceFile(inputFiles[i], std::ios::binary);
+            if (!sourceFile.is_open()) {
+                results[i].diagnostics.push_back({ 0, "Could not open source file" });
+                continue;
+            }
+            source.assign(std::istreambuf_iterator<char>(sourceFile), std::istreambuf_iterator<char>());
+            context.check(source, settings, results[i]);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < workers; i++) {
+        pool.emplace_back(work);
+    }
+    work();
+    for (auto& worker : pool) worker.join();
+
+    size_t errors = 0, failedScripts = 0;
+    for (size_t i = 0; i < inputFiles.size(); i++) {
+        for (const auto& diagnostic : results[i].diagnostics) {
+            std::cerr << inputFiles[i] << ':' << diagnostic.line << ": " << diagnostic.message << '\n';
+        }
+        errors += results[i].diagnostics.size();
+        failedScripts += results[i].diagnostics.empty() ? 0 : 1;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Checked " << inputFiles.size() << " scripts in " << std::fixed << std::setprecision(1) << ms << " ms: "
+              << errors << " errors in " << failedScripts << " scripts\n";
+    return errors == 0 ? 0 : 1;
+}
+
+static std::string formatMilliseconds(double nanoseconds, bool variableDelay) {
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(3) << nanoseconds / 1e6 << " ms";
+    if (variableDelay) text << " + variable delays";
+    return text.str();
+}
+
+static std::string describeEvent(const std::vector<InstructionNode>& ast, size_t index, const char* none) {
+    if (index == EventLatency::NO_EVENT) return none;
+    return ast[index].instruction.value + " (line " + std::to_string(ast[index].instruction.line) + ")";
+}
+
+// Checks every input and prints its static timing estimate (see estimateTiming): the time of
+// each basic block, the slowest gaps between input events and one iteration of every loop.
+// Fails for scripts with errors and for loops over the budget, so a build can catch a timing
+// regression before anything runs. Scripts are timed as they would compile: expressions and
+// rep blocks lowered, the latter with maxUnroll, and calls inlined.
+int timeScripts(const std::vector<std::string>& inputFiles, const CostModel& model, double loopBudgetMs, size_t maxUnroll) {
+    constexpr size_t SLOWEST_GAPS = 10;
+
+    CompilerContext context;
+    CompilerSettings settings;
+    size_t failedScripts = 0, slowLoops = 0;
+
+    for (const auto& inputFile : inputFiles) {
+        std::ifstream sourceFile(inputFile, std::ios::binary);
+        if (!sourceFile.is_open()) {
+            std::cerr << inputFile << ":0: Could not open source file\n";
+            failedScripts++;
+            continue;
+        }
+        std::string source((std::istreambuf_iterator<char>(sourceFile)), std::istreambuf_iterator<char>());
+
+        CompileResult result = context.check(source, settings);
+        if (!result.diagnostics.empty()) {
+            for (const auto& diagnostic : result.diagnostics) {
+                std::cerr << inputFile << ':' << diagnostic.line << ": " << diagnostic.message << '\n';
+            }
+            failedScripts++;
+            continue;
+        }
+
+        std::vector<InstructionNode> ast = context.program();
+        SymbolTable symbols = context.symbolTable();
+        if (ExpressionLowering::hasExpressions(ast)) {
+            ast = ExpressionLowering(symbols).lower(ast);
+        }
+        if (RepeatLowering::hasRepeats(ast)) {
+            ast = RepeatLowering(symbols, maxUnroll).lower(ast);
+        }
+        if (Inliner::hasCalls(ast)) {
+            ast = Inliner().inlineCalls(ast);
+        }
+
+        ControlFlowGraph cfg(ast);
+        TimingReport report = estimateTiming(ast, cfg, model, loopBudgetMs * 1e6);
+        const auto& blocks = cfg.getBlocks();
+
+        auto lines = [&](size_t block) {
+            return "lines " + std::to_string(ast[blocks[block].begin].instruction.line) + "-"
+                + std::to_string(ast[blocks[block].end - 1].instruction.line);
+        };
+
+        std::cout << inputFile << ": " << blocks.size() << " blocks, " << report.latencies.size() - 1 << " input events, "
+                  << report.loops.size() << " loops\n";
+
+        std::cout << "  Blocks:\n";
+        for (size_t b = 0; b < blocks.size(); b++) {
+            std::cout << "    #" << b << ' ' << lines(b) << " (" << blocks[b].end - blocks[b].begin << " instructions): "
+                      << formatMilliseconds(report.blocks[b].nanoseconds, report.blocks[b].variableDelay) << '\n';
+        }
+
+        std::vector<const EventLatency*> gaps;
+        for (const auto& latency : report.latencies) gaps.push_back(&latency);
+        std::stable_sort(gaps.begin(), gaps.end(), [](const EventLatency* a, const EventLatency* b) {
+            return a->unbounded != b->unbounded ? a->unbounded : a->nanoseconds > b->nanoseconds;
+        });
+        gaps.resize(std::min(gaps.size(), SLOWEST_GAPS));
+
+        std::cout << "  Slowest input gaps:\n";
+        for (const EventLatency* gap : gaps) {
+            std::cout << "    " << describeEvent(ast, gap->from, "start");
+            if (gap->unbounded) {
+                std::cout << ": unbounded, the loop at " << lines(gap->loopBlock) << " has no input events\n";
+            } else {
+                std::cout << " -> " << describeEvent(ast, gap->to, "end of program") << ": "
+                          << formatMilliseconds(gap->nanoseconds, gap->variableDelay) << '\n';
+            }
+        }
+
+        if (!report.loops.empty()) std::cout << "  Loops:\n";
+        for (const auto& loop : report.loops) {
+            std::cout << "    " << lines(loop.header) << " (" << loop.blocks.size() << " blocks): "
+                      << formatMilliseconds(loop.nanoseconds, loop.variableDelay) << " per iteration"
+                      << (loop.overBudget ? ", over budget\n" : "\n");
+            slowLoops += loop.overBudget ? 1 : 0;
+        }
+    }
+
+    std::cout << "Timed " << inputFiles.size() << " scripts: " << failedScripts << " with errors, "
+              << slowLoops << " loops over budget\n";
+    return failedScripts == 0 && slowLoops == 0 ? 0 : 1;
+}
+
 struct CompilationUnit {
     std::string source_path;
     std::vector<uint8_t> bytecode;
+    std::vector<uint8_t> lineTable;
+    std::vector<uint8_t> certificate; // Encoded; issued for bytecode once, when it was compiled or loaded
+};
+
+struct CompileOptions {
+    bool debugLexer = false;
+    bool debugParser = false;
+    bool debugLines = false;
+    bool debugColumns = false;
+    bool batchInput = false;
+    size_t maxUnroll = RepeatLowering::DEFAULT_MAX_UNROLL;
+    size_t registers = 0;
+    size_t threads = 1;
+    std::string cppOutputDir;
+    ProfileData profile;
+    std::string codegenOptions; // Everything above that changes the output, for cache keys
+    bool shareStrings = false; // Pool print strings shared by several units; applied per archive, after caching
+};
+
+// A module the verifier rejects is a compiler bug
+static std::vector<uint8_t> certify(const std::string& name, const std::vector<uint8_t>& module, size_t poolSize) {
+    auto verification = verifyModule(module, poolSize);
+    if (!verification.passed()) {
+        throw std::logic_error(name + " fails verification: " + verification.problems.front());
+    }
+    return verification.certificate.encode();
+}
+
+CompilationUnit compileUnit(const std::string& input, const CompileOptions& options, CompilerContext& context, BuildCache* cache) {
+    CompilationUnit unit;
+    unit.source_path = input;
+
+    std::ifstream sourceFile(input);
+    if (!sourceFile.is_open()) {
+        throw std::runtime_error("Could not open source file: " + input);
+    }
+
+    // Only the parallel front end needs the whole text; otherwise the source is streamed, so
+    // its text and tokens are never held whole
+    std::error_code sizeError;
+    auto sourceSize = std::filesystem::file_size(input, sizeError);
+    bool parallel = options.threads > 1 && !sizeError && sourceSize >= 2 * ParallelParser::MIN_CHUNK_SIZE;
+    std::string source;
+    if (parallel) {
+        source.assign(std::istreambuf_iterator(sourceFile), std::istreambuf_iterator<char>());
+    }
+
+    std::string stem = std::filesystem::path(input).stem().string();
+
+    std::string cacheKey;
+    if (cache) {
+        // Profile records are looked up by unit name, so with a profile the name is an input too
+        std::string keyOptions = options.codegenOptions + (options.profile.empty() ? "" : ";unit=" + stem);
+        cacheKey = parallel ? BuildCache::key(source, keyOptions) : BuildCache::key(sourceFile, keyOptions);
+
+        // The debug dumps and the C++ backend need the front end, so those builds always compile
+        bool needsFrontend = options.debugLexer || options.debugParser || !options.cppOutputDir.empty();
+        if (!needsFrontend) {
+            if (auto cached = cache->load(cacheKey)) {
+                unit.bytecode = std::move(cached->bytecode);
+                unit.lineTable = std::move(cached->lineTable);
+                unit.certificate = certify(input, unit.bytecode, 0);
+                return unit;
+            }
+        }
+    }
+
+    CompilerSettings settings;
+    settings.debugLines = options.debugLines;
+    settings.debugColumns = options.debugColumns;
+    settings.batchInput = options.batchInput;
+    settings.maxUnroll = options.maxUnroll;
+    settings.registers = options.registers;
+    settings.keepTokens = options.debugLexer; // The token dump needs the whole stream, so lex serially
+    settings.threads = options.threads;
+    settings.profile = &options.profile;
+    settings.unitName = stem;
+
+    CompileResult result;
+    if (parallel) {
+        context.compile(source, settings, result);
+    } else {
+        context.compile(sourceFile, settings, result);
+    }
+
+    if (options.debugLexer) {
+        printTokens(context.tokens(), input);
+    }
+    if (options.debugParser) {
+        printAST(context.program(), input);
+    }
+    if (!result.success) {
+        throw std::runtime_error(result.diagnostics.front().message);
+    }
+    unit.bytecode = std::move(result.bytecode);
+    unit.lineTable = std::move(result.lineTable);
+    unit.certificate = certify(input, unit.bytecode, 0);
+
+    if (!options.cppOutputDir.empty()) {
+        std::filesystem::create_directories(options.cppOutputDir);
+
+        std::ofstream cppFile(std::filesystem::path(options.cppOutputDir) / (stem + ".cpp"));
+        if (!cppFile.is_open()) {
+            throw std::runtime_error("Could not write C++ translation of " + input);
+        }
+
+        CppGenerator cppGenerator(context.symbolTable());
+        cppFile << cppGenerator.generate(context.program(), stem);
+    }
+
+    if (cache) {
+        try {
+            cache->store(cacheKey, { unit.bytecode, unit.lineTable });
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: " << e.what() << '\n';
+        }
+    }
+
+    return unit;
+}
+
+// Module, line table, certificate, string pool and inf entries for the units
+std::vector<ArchiveEntry> archiveEntries(const std::vector<CompilationUnit>& units, bool shareStrings,
+    PoolingStats* pooling = nullptr) {
+    std::vector<ArchiveEntry> entries;
+    std::vector<size_t> moduleEntries;
+    for (const auto& unit : units) {
+        std::string entryName = std::filesystem::path(unit.source_path).stem().string() + ".xexm";
+        moduleEntries.push_back(entries.size());
+        entries.push_back({ entryName, unit.bytecode, 0 });
+
+        if (!unit.lineTable.empty()) {
+            entries.push_back({ lineTableEntryName(entryName), unit.lineTable, 0 });
+        }
+    }
+
+    StringPool pool;
+    if (shareStrings) {
+        std::vector<PoolableModule> modules;
+        for (size_t index : moduleEntries) {
+            bool hasLines = index + 1 < entries.size() && entries[index + 1].name == lineTableEntryName(entries[index].name);
+            modules.push_back({ &entries[index].data, hasLines ? &entries[index + 1].data : nullptr });
+        }
+        pool = poolSharedStrings(modules, 2, pooling);
+    }
+    if (!pool.empty()) {
+        entries.push_back({ StringPool::ENTRY_NAME, pool.encode(), 0 });
+    }
+
+    // Last, since pooling rewrites modules. Only those it rewrote need verifying again; the rest
+    // keep the certificate of their unit, so a watch rebuild verifies just what it recompiled.
+    for (size_t u = 0; u < units.size(); u++) {
+        const auto& module = entries[moduleEntries[u]];
+        bool unchanged = !units[u].certificate.empty() && (pool.empty() || module.data == units[u].bytecode);
+        entries.push_back({ certificateEntryName(module.name),
+            unchanged ? units[u].certificate : certify(module.name, module.data, pool.strings.size()), 0 });
+    }
+
+    entries.push_back({ TAG_ENTRY_NAME, std::vector<uint8_t>(COMPILE_TAG, COMPILE_TAG + COMPILE_TAG_LEN), 0 });
+    return entries;
+}
+
+// Keeps the compiled units resident, with their line tables and certificates, and rebuilds only
+// the units whose sources change
+int watchAndRebuild(std::vector<CompilationUnit>& units, const std::string& outputFile, const CompileOptions& options,
+    const CompressionOptions& compression, CompilerContext& context, BuildCache* cache) {
+    std::vector<std::string> inputFiles;
+    for (const auto& unit : units) {
+        inputFiles.push_back(unit.source_path);
+    }
+
+    FileWatcher watcher(inputFiles);
+    std::cout << "Watching " << inputFiles.size() << " scripts (" << watcher.backendName() << "), press Ctrl+C to stop\n" << std::endl;
+
+    while (true) {
+        auto changed = watcher.wait();
+        auto start = std::chrono::steady_clock::now();
+
+        bool failed = false;
+        for (size_t index : changed) {
+            try {
+                units[index] = compileUnit(inputFiles[index], options, context, cache);
+            } catch (const std::exception& e) {
+                std::cerr << "Compilation of " << inputFiles[index] << " failed: " << e.what() << '\n';
+                failed = true;
+            }
+        }
+        auto compiled = std::chrono::steady_clock::now();
+
+        if (failed) {
+            std::cerr << "Keeping the previous " << outputFile << "\n\n";
+            continue;
+        }
+
+        try {
+            auto stats = updateArchive(outputFile, archiveEntries(units, options.shareStrings), compression);
+
+            auto done = std::chrono::steady_clock::now();
+            auto ms = [](auto duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+            std::cout << "Rebuilt " << changed.size() << " of " << units.size() << " scripts in "
+                      << std::fixed << std::setprecision(1) << ms(done - start) << " ms (compile "
+                      << ms(compiled - start) << " ms, archive " << ms(done - compiled) << " ms, "
+                      << stats.recompressed + stats.added << " entries written)" << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n\n";
+        }
+
+        if (cache) {
+            cache->evict();
+        }
+    }
+}
+
+void evictAndReport(BuildCache& cache) {
+    try {
+        cache.evict();
+    } catch (const std::exception& e) {
+        std::cerr << "Warning: " << e.what() << '\n';
+    }
+
+    auto stats = cache.getStats();
+    std::cout << "Build cache: " << stats.hits << " hits, " << stats.misses << " misses, "
+              << stats.stores << " stored, " << stats.evictions << " evicted ("
+              << stats.bytesRead << " bytes read, " << stats.bytesWritten << " written)\n";
+}
+
+struct ArchiveReport {
+    bool written = false;
+    std::string error;
+    size_t shared = 0; // Scripts some other archive of the manifest also uses
+    uint64_t bytecodeBytes = 0;
+    uint64_t archiveBytes = 0;
+    double milliseconds = 0;
+    ArchiveUpdateStats update;
 };
 
+// Builds every archive of a manifest in one process. Each distinct script is compiled once
+// and shared by every archive listing it; compiling and then archiving run on one set of
+// worker threads, each with its own compiler context.
+int buildManifest(const std::string& manifestFile, const CompileOptions& options, const CompressionOptions& compression,
+    size_t alignment, size_t threads, bool updateExisting, BuildCache* cache) {
+    auto start = std::chrono::steady_clock::now();
+    auto manifest = BuildManifest::load(manifestFile);
+    const auto& sources = manifest.getSources();
+    const auto& archives = manifest.getArchives();
+
+    // The debug dumps would interleave, so they get a single worker
+    bool serial = options.debugLexer || options.debugParser;
+    size_t workers = serial ? 1 : std::min(threads, std::max(sources.size(), archives.size()));
+
+    // Threads not needed for one script each go to splitting scripts internally
+    CompileOptions unitOptions = options;
+    unitOptions.threads = std::max<size_t>(1, threads / workers);
+    CompressionOptions archiveCompression = compression;
+    archiveCompression.threads = unitOptions.threads;
+
+    std::vector<CompilationUnit> units(sources.size());
+    std::vector<std::string> unitErrors(sources.size());
+    std::vector<ArchiveReport> reports(archives.size());
+
+    std::vector<size_t> useCounts(sources.size(), 0);
+    for (const auto& archive : archives) {
+        for (size_t source : archive.sources) useCounts[source]++;
+    }
+
+    std::atomic<size_t> nextUnit = 0, nextArchive = 0;
+    std::chrono::steady_clock::time_point compiled;
+    std::barrier compilePhase(static_cast<std::ptrdiff_t>(workers), [&]() noexcept { compiled = std::chrono::steady_clock::now(); });
+
+    auto worker = [&] {
+        CompilerContext context;
+        for (size_t i; (i = nextUnit++) < sources.size();) {
+            try {
+                units[i] = compileUnit(sources[i], unitOptions, context, cache);
+            } catch (const std::exception& e) {
+                unitErrors[i] = e.what();
+            }
+        }
+
+        compilePhase.arrive_and_wait();
+
+        for (size_t a; (a = nextArchive++) < archives.size();) {
+            auto archiveStart = std::chrono::steady_clock::now();
+            auto& report = reports[a];
+
+            std::vector<CompilationUnit> archiveUnits;
+            for (size_t source : archives[a].sources) {
+                if (useCounts[source] > 1) report.shared++;
+                if (!unitErrors[source].empty()) {
+                    report.error = "skipped, " + sources[source] + " failed";
+                } else if (report.error.empty()) {
+                    archiveUnits.push_back(units[source]);
+                    report.bytecodeBytes += units[source].bytecode.size();
+                }
+            }
+            if (!report.error.empty()) continue;
+
+            try {
+                auto entries = archiveEntries(archiveUnits, options.shareStrings);
+                if (alignment != 0) {
+                    writeIndexedArchive(archives[a].output, entries, alignment, archiveCompression);
+                } else if (updateExisting) {
+                    report.update = updateArchive(archives[a].output, entries, archiveCompression);
+                } else {
+                    writeArchive(archives[a].output, entries, archiveCompression);
+                }
+                report.archiveBytes = std::filesystem::file_size(archives[a].output);
+                report.written = true;
+            } catch (const std::exception& e) {
+                report.error = e.what();
+            }
+            report.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - archiveStart).count();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < workers; i++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    auto done = std::chrono::steady_clock::now();
+
+    bool failed = false;
+    for (size_t i = 0; i < sources.size(); i++) {
+        if (!unitErrors[i].empty()) {
+            std::cerr << "Compilation of " << sources[i] << " failed: " << unitErrors[i] << '\n';
+            failed = true;
+        }
+    }
+
+    auto ms = [](auto duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+
+    std::cout << "Manifest Build (" << manifestFile << "):\n";
+    std::cout << "----------------\n";
+    for (size_t a = 0; a < archives.size(); a++) {
+        const auto& report = reports[a];
+        std::cout << "  " << std::setw(24) << std::left << archives[a].output << std::right
+                  << std::setw(5) << archives[a].sources.size() << " scripts (" << report.shared << " shared) ";
+        if (!report.written) {
+            std::cout << report.error << '\n';
+            failed = true;
+            continue;
+        }
+        std::cout << std::setw(10) << report.bytecodeBytes << " bytes -> " << std::setw(10) << report.archiveBytes << " bytes "
+                  << std::setw(8) << std::fixed << std::setprecision(1) << report.milliseconds << " ms";
+        if (updateExisting && !report.update.rewritten) {
+            std::cout << " (already up to date)";
+        }
+        std::cout << '\n';
+    }
+    std::cout << "  " << archives.size() << " archives from " << sources.size() << " distinct scripts ("
+              << manifest.inputCount() - sources.size() << " repeat compiles avoided) on " << workers << " threads\n";
+    std::cout << "  Wall time " << std::fixed << std::setprecision(1) << ms(done - start) << " ms (compile "
+              << ms(compiled - start) << " ms, archive " << ms(done - compiled) << " ms)\n";
+    std::cout << "----------------\n";
+
+    if (cache) {
+        evictAndReport(*cache);
+    }
+
+    return failed ? 1 : 0;
+}
+
 int main(int argc, char* argv[]) {
     std::cout << TITLE << ' ' << COMPILE_TAG << " (C) " << CURRENT_YEAR << "\n\n";
     
     std::vector<std::string> inputFiles;
     std::string outputFile;
+    std::string cppOutputDir;
+    std::string profileFile;
+    std::string cacheDir;
+    std::string manifestFile;
+    std::string costModelFile;
+    std::string compressionLevel = "6";
+    size_t storeBelow = 0;
+    size_t alignment = 0;
+    uint64_t cacheSizeMB = 256;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t benchThreads = 0;
+    double loopBudgetMs = 0;
+    size_t maxUnroll = RepeatLowering::DEFAULT_MAX_UNROLL;
+    size_t registers = 0;
 
     bool showHelp = false, debugLexer = false, debugParser = false;
+    bool debugLines = false, debugColumns = false;
+    bool updateExisting = false, watch = false, shareStrings = false, checkOnly = false;
+    bool timing = false, batchInput = false;
 
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
@@ -92,100 +697,209 @@ int main(int argc, char* argv[]) {
             --i;
         } else if (arg == "-o" && i + 1 < argc) {
             outputFile = argv[++i];
+        } else if (arg == "--emit-cpp" && i + 1 < argc) {
+            cppOutputDir = argv[++i];
+        } else if (arg == "--profile-use" && i + 1 < argc) {
+            profileFile = argv[++i];
+        } else if (arg == "--manifest" && i + 1 < argc) {
+            manifestFile = argv[++i];
+        } else if (arg == "--cost-model" && i + 1 < argc) {
+            costModelFile = argv[++i];
+        } else if (arg == "--loop-budget" && i + 1 < argc) {
+            loopBudgetMs = std::stod(argv[++i]);
+        } else if (arg == "--max-unroll" && i + 1 < argc) {
+            maxUnroll = std::max(1ull, std::stoull(argv[++i]));
+        } else if (arg == "--registers" && i + 1 < argc) {
+            registers = std::min<size_t>(REGISTER_COUNT, std::stoull(argv[++i]));
+        } else if (arg == "--compression" && i + 1 < argc) {
+            compressionLevel = argv[++i];
+        } else if (arg == "--compression-threshold" && i + 1 < argc) {
+            storeBelow = std::stoull(argv[++i]);
+        } else if (arg == "--aligned" && i + 1 < argc) {
+            alignment = std::stoull(argv[++i]);
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cacheDir = argv[++i];
+        } else if (arg == "--cache-size" && i + 1 < argc) {
+            cacheSizeMB = std::stoull(argv[++i]);
+        } else if (arg == "-j" && i + 1 < argc) {
+            threads = std::max(1ull, std::stoull(argv[++i]));
+        } else if (arg == "--bench-frontend" && i + 1 < argc) {
+            benchThreads = std::max(1ull, std::stoull(argv[++i]));
         } else if (arg == "-h") {
             showHelp = true;
         } else if (arg == "--debug-lexer") {
             debugLexer = true;
         } else if (arg == "--debug-parser") {
             debugParser = true;
+        } else if (arg == "--watch") {
+            watch = true;
+        } else if (arg == "--check") {
+            checkOnly = true;
+        } else if (arg == "--timing") {
+            timing = true;
+        } else if (arg == "--batch-input") {
+            batchInput = true;
+        } else if (arg == "--share-strings") {
+            shareStrings = true;
+        } else if (arg == "--update") {
+            updateExisting = true;
+        } else if (arg == "-g") {
+            debugLines = true;
+        } else if (arg == "--debug-columns") {
+            debugLines = debugColumns = true;
         }
     }
     
-    if (showHelp || inputFiles.empty() || outputFile.empty()) {
-        std::cerr << "Usage: " << argv[0] << " [--debug-lexer] [--debug-parser] -i script1.dc script2.dc -o output.xex\n";
-        return 1;
-    }
-
-    std::vector<CompilationUnit> units;
-    for (const auto& input : inputFiles) {
+    if (benchThreads != 0 && !inputFiles.empty()) {
         try {
-            CompilationUnit unit;
-            unit.source_path = input;
+            benchmarkFrontend(inputFiles, benchThreads);
+        } catch (const std::exception& e) {
+            std::cerr << "\nBenchmark Failed!\nError: " << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
 
-            std::ifstream sourceFile(input);
-            if (!sourceFile.is_open()) {
-                throw std::runtime_error("Could not open source file: " + input);
-            }
-            std::string source((std::istreambuf_iterator(sourceFile)),
-                         std::istreambuf_iterator<char>());
-            
-            Lexer lexer(source);
-            auto tokens = lexer.tokenize();
-
-            if (debugLexer) {
-                printTokens(tokens, input);
-            }
-            
-            Parser parser(tokens);
-            auto ast = parser.parse();
+    if (checkOnly && !inputFiles.empty() && manifestFile.empty() && !watch) {
+        return checkScripts(inputFiles, threads);
+    }
 
-            if (debugParser) {
-                printAST(ast, input);
-            }
-            
-            SymbolTable symbols;
-            SemanticAnalyzer analyzer(symbols, ast);
-            analyzer.analyze();
-            
-            CodeGenerator generator(symbols);
-            unit.bytecode = generator.generate(ast);
-
-            if (unit.bytecode.empty()) {
-                throw std::runtime_error("Generated bytecode is empty");
-            }
-            
-            units.push_back(unit);
+    if (timing && !inputFiles.empty() && manifestFile.empty() && !watch) {
+        try {
+            return timeScripts(inputFiles, costModelFile.empty() ? CostModel() : CostModel::load(costModelFile), loopBudgetMs, maxUnroll);
         } catch (const std::exception& e) {
-            std::cerr << "\nCompilation Failed!\nError: " << e.what() << '\n';
+            std::cerr << "\nTiming Failed!\nError: " << e.what() << '\n';
             return 1;
         }
     }
 
-    mz_zip_archive zipArchive;
-    memset(&zipArchive, 0, sizeof(mz_zip_archive));
+    bool manifestMode = !manifestFile.empty();
+    bool conflicting = checkOnly || timing || (alignment != 0 && (updateExisting || watch));
+    if (showHelp || conflicting || (manifestMode ? watch || !inputFiles.empty() || !outputFile.empty() : inputFiles.empty() || outputFile.empty())) {
+        std::cerr << "Usage: " << argv[0] << " [--debug-lexer] [--debug-parser] [-g] [--debug-columns] [--emit-cpp dir] [--profile-use file] [-j threads] [--cache dir] [--cache-size MB] [--compression store|1-10] [--compression-threshold bytes] [--batch-input] [--max-unroll n] [--registers n] [--share-strings] [--aligned bytes | --update | --watch] -i script1.dc script2.dc -o output.xex\n";
+        std::cerr << "       " << argv[0] << " [same options except --watch] --manifest file\n";
+        std::cerr << "       " << argv[0] << " --check [-j threads] -i script1.dc script2.dc\n";
+        std::cerr << "       " << argv[0] << " --timing [--cost-model file] [--loop-budget ms] [--max-unroll n] -i script1.dc script2.dc\n";
+        std::cerr << "       " << argv[0] << " --bench-frontend max-threads -i script1.dc script2.dc\n";
+        return 1;
+    }
+
+    CompileOptions options;
+    options.debugLexer = debugLexer;
+    options.debugParser = debugParser;
+    options.debugLines = debugLines;
+    options.debugColumns = debugColumns;
+    options.threads = threads;
+    options.cppOutputDir = cppOutputDir;
+    options.batchInput = batchInput;
+    options.maxUnroll = maxUnroll;
+    options.registers = registers;
+    options.codegenOptions = "g=" + std::to_string(debugLines) + ";columns=" + std::to_string(debugColumns)
+        + (batchInput ? ";batch" : "")
+        + (maxUnroll != RepeatLowering::DEFAULT_MAX_UNROLL ? ";unroll=" + std::to_string(maxUnroll) : "")
+        + (registers != 0 ? ";registers=" + std::to_string(registers) : "");
+    options.shareStrings = shareStrings;
 
-    if (!mz_zip_writer_init_file(&zipArchive, outputFile.c_str(), 0)) {
-        std::cerr << "Failed to create output binary\n";
+    CompressionOptions compression;
+    compression.storeBelow = storeBelow;
+    compression.threads = threads;
+
+    try {
+        if (compressionLevel == "store") {
+            compression.level = 0;
+        } else {
+            size_t parsed = 0;
+            compression.level = std::stoi(compressionLevel, &parsed);
+            if (parsed != compressionLevel.size() || compression.level < 1 || compression.level > 10) {
+                throw std::invalid_argument("");
+            }
+        }
+    } catch (const std::exception&) {
+        std::cerr << "Error: --compression takes 'store' or a level from 1 to 10, not '" << compressionLevel << "'\n";
         return 1;
     }
 
-    for (const auto& unit : units) {
-        std::string entryName = std::filesystem::path(unit.source_path).stem().string() + ".xexm";
+    if ((alignment & (alignment - 1)) != 0 || alignment > MAX_ENTRY_ALIGNMENT) {
+        std::cerr << "Error: --aligned takes a power of two up to " << MAX_ENTRY_ALIGNMENT << '\n';
+        return 1;
+    }
 
-        if (unit.bytecode.empty()) {
-            std::cerr << "Empty bytecode for " << entryName << '\n';
-            continue;
+    std::optional<BuildCache> cache;
+    try {
+        if (!profileFile.empty()) {
+            options.profile = ProfileData::load(profileFile);
+
+            std::ifstream file(profileFile, std::ios::binary);
+            Sha256 profileHash;
+            profileHash.update(std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()));
+            options.codegenOptions += ";profile=" + Sha256::toHex(profileHash.finish());
+        }
+
+        if (!cacheDir.empty()) {
+            cache.emplace(cacheDir, cacheSizeMB * 1024 * 1024);
         }
-        
-        if (!mz_zip_writer_add_mem(&zipArchive, entryName.c_str(), unit.bytecode.data(), unit.bytecode.size(), MZ_DEFAULT_COMPRESSION)) {
-            std::cerr << "Failed to add " << entryName << " to output binary\n";
-            mz_zip_writer_end(&zipArchive);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 1;
+    }
+
+    if (manifestMode) {
+        try {
+            return buildManifest(manifestFile, options, compression, alignment, threads, updateExisting, cache ? &*cache : nullptr);
+        } catch (const std::exception& e) {
+            std::cerr << "\nManifest Build Failed!\nError: " << e.what() << '\n';
             return 1;
         }
     }
 
-    if (!mz_zip_writer_add_mem(&zipArchive, "inf", COMPILE_TAG, COMPILE_TAG_LEN, MZ_DEFAULT_COMPRESSION)) {
-        std::cerr << "Failed to add compile information to output binary\n";
-        mz_zip_writer_end(&zipArchive);
-        return 1;
+    std::vector<CompilationUnit> units;
+    CompilerContext context;
+    for (const auto& input : inputFiles) {
+        try {
+            units.push_back(compileUnit(input, options, context, cache ? &*cache : nullptr));
+        } catch (const std::exception& e) {
+            std::cerr << "\nCompilation Failed!\nError: " << e.what() << '\n';
+            return 1;
+        }
     }
 
-    if (!mz_zip_writer_finalize_archive(&zipArchive) || !mz_zip_writer_end(&zipArchive)) {
-        std::cerr << "Failed to finalize output binary\n";
+    try {
+        PoolingStats pooling;
+        auto entries = archiveEntries(units, options.shareStrings, &pooling);
+        if (pooling.pooledStrings != 0) {
+            std::cout << "Shared " << pooling.pooledStrings << " print strings across " << pooling.rewrittenModules
+                      << " modules (" << pooling.savedBytes << " bytes saved)\n";
+        }
+
+        if (alignment != 0) {
+            writeIndexedArchive(outputFile, entries, alignment, compression);
+        } else if (updateExisting || watch) {
+            auto stats = updateArchive(outputFile, entries, compression);
+            std::cout << "Archive update: " << stats.recompressed << " changed, " << stats.added << " added, "
+                      << stats.removed << " removed, " << stats.copied << " copied as is"
+                      << (stats.rewritten ? "" : " (already up to date)") << '\n';
+        } else {
+            writeArchive(outputFile, entries, compression);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
         return 1;
     }
 
     std::cout << "Successfully compiled " << units.size() << " scripts to " << outputFile << '\n';
 
+    if (cache) {
+        evictAndReport(*cache);
+    }
+
+    if (watch) {
+        try {
+            return watchAndRebuild(units, outputFile, options, compression, context, cache ? &*cache : nullptr);
+        } catch (const std::exception& e) {
+            std::cerr << "\nWatch Failed!\nError: " << e.what() << '\n';
+            return 1;
+        }
+    }
+
     return 0;
 }
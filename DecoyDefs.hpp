@@ -2,7 +2,9 @@
 
 #define TITLE "Decoy Compiler"
 
-#define VERSION "1.0"
+// Archives record COMPILE_TAG and runners only load their own, so bump VERSION with every change
+// to the bytecode or the archive layout
+#define VERSION "2.0"
 #define BRANCH "stable"
 
 #define COMPILE_TAG VERSION "-" BRANCH
@@ -0,0 +1,354 @@
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <set>
+#include <sstream>
+
+#include "archive/DecoyArchive.hpp"
+#include "archive/DecoyArchiveIndex.hpp"
+#include "codegen/DecoyBytecode.hpp"
+#include "codegen/DecoyLineTable.hpp"
+#include "codegen/DecoyStringPool.hpp"
+#include "codegen/DecoyVerifier.hpp"
+
+#include "DecoyDefs.hpp"
+
+#include <iomanip>
+
+struct SizeStats {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+struct ModuleProfile {
+    std::map<std::string, SizeStats> byOpcode;
+    std::map<std::string, SizeStats> byOperandKind;
+};
+
+std::string formatAddress(size_t address) {
+    std::ostringstream ss;
+    ss << std::hex << std::setw(6) << std::setfill('0') << address;
+    return ss.str();
+}
+
+std::string formatLiteral(const DecodedOperand& operand) {
+    switch (operand.type) {
+        case Type::I8: return std::to_string(static_cast<int8_t>(operand.value)) + "i8";
+        case Type::UI8: return std::to_string(static_cast<uint8_t>(operand.value)) + "ui8";
+        case Type::I16: return std::to_string(static_cast<int16_t>(operand.value)) + "i16";
+        case Type::UI16: return std::to_string(static_cast<uint16_t>(operand.value)) + "ui16";
+        case Type::I32: return std::to_string(static_cast<int32_t>(operand.value)) + "i32";
+        case Type::UI32: return std::to_string(operand.value) + "ui32";
+        case Type::F32: {
+            float real;
+            memcpy(&real, &operand.value, sizeof(float));
+            std::ostringstream ss;
+            ss << real << "f32";
+            return ss.str();
+        }
+        default: return "?";
+    }
+}
+
+std::string typeName(Type type) {
+    static const char* names[] = { "nt", "i8", "ui8", "i16", "ui16", "i32", "ui32", "f32", "str" };
+    auto index = static_cast<size_t>(type);
+    return index < std::size(names) ? names[index] : "?";
+}
+
+void disassemble(const std::vector<DecodedInstruction>& instructions, const LineTable* lineTable, const StringPool& stringPool) {
+    // Recover names for variable offsets and mark every jump target
+    std::unordered_map<uint32_t, std::string> variableNames;
+    std::set<uint32_t> targets;
+    for (const auto& instruction : instructions) {
+        if (instruction.opcode == Instruction::CV) {
+            variableNames[instruction.operands[2].value] = instruction.operands[0].text;
+        }
+        for (const auto& operand : instruction.operands) {
+            if (operand.kind == OperandKind::LABEL) targets.insert(operand.value);
+        }
+    }
+
+    // A register holds the one variable its fills name
+    std::unordered_map<uint32_t, std::string> registerNames;
+    for (const auto& instruction : instructions) {
+        if (instruction.opcode != Instruction::FILL) continue;
+        auto it = variableNames.find(instruction.operands[1].value);
+        if (it != variableNames.end()) registerNames[instruction.operands[0].value] = it->second;
+    }
+
+    for (const auto& instruction : instructions) {
+        if (targets.contains(static_cast<uint32_t>(instruction.address))) {
+            std::cout << "L_" << formatAddress(instruction.address) << ":\n";
+        }
+
+        std::cout << "  " << formatAddress(instruction.address) << ": "
+                  << std::setw(7) << std::left << findInstructionInfo(static_cast<uint8_t>(instruction.opcode))->mnemonic;
+
+        for (const auto& operand : instruction.operands) {
+            std::cout << ' ';
+            switch (operand.kind) {
+                case OperandKind::LITERAL: std::cout << formatLiteral(operand); break;
+                case OperandKind::STRING: std::cout << '"' << operand.text << '"'; break;
+                case OperandKind::POOLED_STRING: {
+                    std::cout << "str[" << operand.value << ']';
+                    if (operand.value < stringPool.strings.size()) std::cout << '"' << stringPool.strings[operand.value] << '"';
+                    break;
+                }
+                case OperandKind::EVENT: {
+                    std::cout << '+' << operand.value << "ms " << findInstructionInfo(static_cast<uint8_t>(operand.event))->mnemonic;
+                    break;
+                }
+                case OperandKind::TYPE: std::cout << typeName(operand.type); break;
+                case OperandKind::LABEL: std::cout << "L_" << formatAddress(operand.value); break;
+                case OperandKind::VARIABLE: {
+                    std::cout << '@' << operand.value;
+                    auto it = variableNames.find(operand.value);
+                    if (it != variableNames.end()) std::cout << '(' << it->second << ')';
+                    break;
+                }
+                case OperandKind::REGISTER: {
+                    std::cout << 'r' << operand.value;
+                    auto it = registerNames.find(operand.value);
+                    if (it != registerNames.end()) std::cout << '(' << it->second << ')';
+                    break;
+                }
+            }
+        }
+        if (lineTable) {
+            if (const LineEntry* entry = lineTable->lookup(instruction.address)) {
+                std::cout << "    ; line " << entry->line;
+                if (lineTable->hasColumns()) std::cout << ':' << entry->column;
+            }
+        }
+        std::cout << std::right << '\n';
+    }
+}
+
+void addToProfile(ModuleProfile& profile, const std::vector<DecodedInstruction>& instructions) {
+    for (const auto& instruction : instructions) {
+        auto& opcode = profile.byOpcode[findInstructionInfo(static_cast<uint8_t>(instruction.opcode))->mnemonic];
+        opcode.count++;
+        opcode.bytes += instruction.size;
+
+        // Opcode bytes plus print-list counts; everything else belongs to an operand
+        size_t overhead = instruction.size;
+        for (const auto& operand : instruction.operands) {
+            auto& kind = profile.byOperandKind[operandKindName(operand.kind)];
+            kind.count++;
+            kind.bytes += operand.size;
+            overhead -= operand.size;
+        }
+
+        auto& header = profile.byOperandKind["(opcode)"];
+        header.count++;
+        header.bytes += overhead;
+    }
+}
+
+void printHistogram(const std::string& title, const std::map<std::string, SizeStats>& stats) {
+    uint64_t totalBytes = 0;
+    for (const auto& [name, entry] : stats) totalBytes += entry.bytes;
+
+    std::vector<std::pair<std::string, SizeStats>> sorted(stats.begin(), stats.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second.bytes > b.second.bytes; });
+
+    std::cout << title << ":\n";
+    for (const auto& [name, entry] : sorted) {
+        double share = totalBytes ? 100.0 * entry.bytes / totalBytes : 0;
+        std::cout << "  " << std::setw(10) << std::left << name << std::right
+                  << std::setw(12) << entry.count << " x"
+                  << std::setw(12) << entry.bytes << " bytes"
+                  << std::setw(8) << std::fixed << std::setprecision(1) << share << "%\n";
+    }
+}
+
+void printProfile(const ModuleProfile& profile) {
+    printHistogram("Size by opcode", profile.byOpcode);
+    printHistogram("Size by operand kind", profile.byOperandKind);
+}
+
+void printIndex(const ArchiveIndex& index, const std::vector<ArchiveEntry>& entries) {
+    std::cout << "Module Index (" << index.alignment << "-byte aligned):\n";
+    std::cout << "----------------\n";
+    for (const auto& record : index.records) {
+        auto entry = std::find_if(entries.begin(), entries.end(), [&](const ArchiveEntry& other) { return other.name == record.name; });
+        auto stored = std::find_if(index.records.begin(), index.records.end(), [&](const IndexRecord& other) { return other.offset == record.offset; });
+        bool matches = false;
+        if (entry != entries.end()) {
+            Sha256 hash;
+            hash.update(entry->data.data(), entry->data.size());
+            matches = entry->data.size() == record.size && hash.finish() == record.hash;
+        }
+
+        std::cout << "  " << std::setw(24) << std::left << record.name << std::right
+                  << " @ " << formatAddress(record.offset) << std::setw(10) << record.size << " bytes  "
+                  << Sha256::toHex(record.hash).substr(0, 16)
+                  << (isExecutedEntry(record.name) && record.offset % index.alignment ? "  MISALIGNED" : "")
+                  << (matches ? "" : "  MISMATCH")
+                  << (stored->name != record.name ? "  alias of " + stored->name : "") << '\n';
+    }
+    std::cout << "----------------\n\n";
+}
+
+// Runs the verifier over every module and checks each certificate still matches its module.
+// Returns whether all modules pass; a module without a certificate passes, it just loads checked.
+bool printVerification(const std::vector<ArchiveEntry>& entries, const StringPool& stringPool) {
+    std::cout << "Verification:\n";
+    std::cout << "----------------\n";
+    bool passed = true;
+    for (const auto& entry : entries) {
+        if (!isModuleEntry(entry.name)) continue;
+
+        auto verification = verifyModule(entry.data, stringPool.strings.size());
+        auto certificateEntry = std::find_if(entries.begin(), entries.end(),
+            [&](const ArchiveEntry& other) { return other.name == certificateEntryName(entry.name); });
+
+        std::string certificate = "no certificate";
+        bool stale = false;
+        if (certificateEntry != entries.end()) {
+            auto decoded = ModuleCertificate::decode(certificateEntry->data);
+            stale = !verification.passed() || decoded.hash != verification.certificate.hash
+                || decoded.instructions != verification.certificate.instructions
+                || decoded.memorySize != verification.certificate.memorySize;
+            certificate = stale ? "STALE CERTIFICATE" : "certified";
+        }
+
+        std::cout << "  " << std::setw(24) << std::left << entry.name << std::right << "  "
+                  << (verification.passed() ? "ok" : "FAILED") << ", " << certificate << '\n';
+        for (const auto& problem : verification.problems) {
+            std::cout << "    " << problem << '\n';
+        }
+        passed = passed && verification.passed() && !stale;
+    }
+    std::cout << "----------------\n\n";
+    return passed;
+}
+
+int main(int argc, char* argv[]) {
+    std::cout << "Decoy Objdump " << COMPILE_TAG << " (C) " << CURRENT_YEAR << "\n\n";
+
+    std::string inputFile;
+    bool showHelp = false, showDisassembly = true, showSizes = true, showVerification = true;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-i" && i + 1 < argc) {
+            inputFile = argv[++i];
+        } else if (arg == "-d") {
+            showSizes = false;
+            showVerification = false;
+        } else if (arg == "-s") {
+            showDisassembly = false;
+            showVerification = false;
+        } else if (arg == "-v") {
+            showDisassembly = false;
+            showSizes = false;
+        } else if (arg == "-h") {
+            showHelp = true;
+        }
+    }
+
+    if (showHelp || inputFile.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [-d | -s | -v] -i input.xex\n";
+        std::cerr << "  -d  disassembly only\n";
+        std::cerr << "  -s  size profile only\n";
+        std::cerr << "  -v  verification only; exits with 1 if a module fails or its certificate is stale\n";
+        return 1;
+    }
+
+    try {
+        auto entries = readArchive(inputFile);
+
+        std::cout << "Archive Entries:\n";
+        std::cout << "----------------\n";
+        uint64_t totalSize = 0, totalCompressed = 0;
+        for (const auto& entry : entries) {
+            double ratio = entry.data.empty() ? 0 : 100.0 * entry.compressedSize / entry.data.size();
+            std::cout << "  " << std::setw(24) << std::left << entry.name << std::right
+                      << std::setw(10) << entry.data.size() << " -> "
+                      << std::setw(10) << entry.compressedSize
+                      << std::setw(8) << std::fixed << std::setprecision(1) << ratio << "%\n";
+            totalSize += entry.data.size();
+            totalCompressed += entry.compressedSize;
+        }
+        std::cout << "  " << std::setw(24) << std::left << "(total)" << std::right
+                  << std::setw(10) << totalSize << " -> " << std::setw(10) << totalCompressed << '\n';
+        std::cout << "----------------\n\n";
+
+        for (const auto& entry : entries) {
+            if (entry.name == TAG_ENTRY_NAME && !std::equal(entry.data.begin(), entry.data.end(), COMPILE_TAG, COMPILE_TAG + COMPILE_TAG_LEN)) {
+                std::cout << "Warning: archive was built by compiler " << std::string(entry.data.begin(), entry.data.end())
+                          << ", which may encode instructions differently\n\n";
+            }
+            if (entry.name == ArchiveIndex::ENTRY_NAME) {
+                printIndex(ArchiveIndex::decode(entry.data), entries);
+            }
+        }
+
+        StringPool stringPool;
+        for (const auto& entry : entries) {
+            if (entry.name == StringPool::ENTRY_NAME) {
+                stringPool = StringPool::decode(entry.data);
+                std::cout << "String Pool: " << stringPool.strings.size() << " strings\n\n";
+            }
+        }
+
+        bool verified = !showVerification || printVerification(entries, stringPool);
+
+        ModuleProfile archiveProfile;
+        size_t moduleCount = 0;
+        for (const auto& entry : entries) {
+            if (!isModuleEntry(entry.name) || (!showDisassembly && !showSizes)) continue;
+
+            std::vector<DecodedInstruction> instructions;
+            BytecodeReader reader(entry.data);
+            while (!reader.isAtEnd()) {
+                instructions.push_back(reader.next());
+            }
+
+            std::cout << "Module " << entry.name << " (" << instructions.size() << " instructions, "
+                      << entry.data.size() << " bytes)\n";
+            std::cout << "----------------\n";
+
+            if (showDisassembly) {
+                std::optional<LineTable> lineTable;
+                for (const auto& other : entries) {
+                    if (other.name == lineTableEntryName(entry.name)) {
+                        lineTable = LineTable::decode(other.data);
+                    }
+                }
+
+                disassemble(instructions, lineTable ? &*lineTable : nullptr, stringPool);
+                std::cout << '\n';
+            }
+
+            if (showSizes) {
+                ModuleProfile profile;
+                addToProfile(profile, instructions);
+                addToProfile(archiveProfile, instructions);
+                printProfile(profile);
+            }
+            std::cout << "----------------\n\n";
+            moduleCount++;
+        }
+
+        if (showSizes && moduleCount > 1) {
+            std::cout << "All Modules\n";
+            std::cout << "----------------\n";
+            printProfile(archiveProfile);
+            std::cout << "----------------\n";
+        }
+
+        if (!verified) {
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "\nDisassembly Failed!\nError: " << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,309 @@
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+
+#include "archive/DecoyArchive.hpp"
+#include "archive/DecoyMappedArchive.hpp"
+#include "codegen/DecoyCostModel.hpp"
+#include "codegen/DecoyLineTable.hpp"
+#include "codegen/DecoyStringPool.hpp"
+#include "codegen/DecoyVerifier.hpp"
+#include "vm/DecoyVM.hpp"
+
+#include "DecoyDefs.hpp"
+
+#include <iomanip>
+
+void printEvents(const RecordingInputDevice& device) {
+    std::cout << "Recorded Events:\n";
+    std::cout << "----------------\n";
+    for (const auto& event : device.getEvents()) {
+        std::cout << std::setw(10) << std::right << event.time << "ms "
+                  << std::setw(4) << std::left << RecordingInputDevice::eventKindName(event.kind) << ' ';
+        switch (event.kind) {
+            case InputEventKind::PRINT: std::cout << '"' << event.text << '"'; break;
+            case InputEventKind::MOVE_MOUSE: std::cout << event.x << ' ' << event.y; break;
+            case InputEventKind::IS_KEY_DOWN: std::cout << event.x << " -> " << event.y; break;
+            default: std::cout << event.x; break;
+        }
+        std::cout << '\n';
+    }
+    if (device.getDroppedEvents() != 0) {
+        std::cout << "... " << device.getDroppedEvents() << " more events not recorded\n";
+    }
+    std::cout << "----------------\n";
+}
+
+void printStats(const ExecutionStats& stats, const RecordingInputDevice& device, size_t memorySize) {
+    double rate = stats.seconds > 0 ? stats.instructions / stats.seconds : 0;
+
+    std::cout << "Execution Stats:\n";
+    std::cout << "----------------\n";
+    std::cout << "Instructions:   " << stats.instructions << (stats.finished ? "" : " (step limit reached)") << '\n';
+    std::cout << "Wall time:      " << std::fixed << std::setprecision(6) << stats.seconds << "s\n";
+    std::cout << "Instr/sec:      " << std::setprecision(0) << rate << '\n';
+    std::cout << "Device time:    " << device.getTime() << "ms\n";
+    std::cout << "Memory:         " << memorySize << " bytes\n";
+
+    std::vector<std::pair<uint64_t, uint8_t>> counts;
+    for (size_t opcode = 0; opcode < stats.opcodeCounts.size(); opcode++) {
+        if (stats.opcodeCounts[opcode] != 0) {
+            counts.emplace_back(stats.opcodeCounts[opcode], static_cast<uint8_t>(opcode));
+        }
+    }
+    std::sort(counts.rbegin(), counts.rend());
+
+    std::cout << "\nOpcode Counts:\n";
+    for (const auto& [count, opcode] : counts) {
+        const InstructionInfo* info = findInstructionInfo(opcode);
+        double share = 100.0 * count / stats.instructions;
+        std::cout << "  " << std::setw(8) << std::left << (info ? info->mnemonic : "?")
+                  << std::setw(14) << std::right << count
+                  << std::setw(8) << std::setprecision(2) << share << "%\n";
+    }
+    std::cout << "----------------\n\n";
+}
+
+void printLineProfile(const ExecutionStats& stats, const LineTable& lineTable, size_t limit) {
+    std::map<uint32_t, uint64_t> lineCounts;
+    for (const auto& [address, count] : stats.addressCounts) {
+        const LineEntry* entry = lineTable.lookup(address);
+        lineCounts[entry ? entry->line : 0] += count;
+    }
+
+    std::vector<std::pair<uint64_t, uint32_t>> sorted;
+    for (const auto& [line, count] : lineCounts) sorted.emplace_back(count, line);
+    std::sort(sorted.rbegin(), sorted.rend());
+    if (sorted.size() > limit) sorted.resize(limit);
+
+    std::cout << "Hottest Lines:\n";
+    for (const auto& [count, line] : sorted) {
+        double share = 100.0 * count / stats.instructions;
+        std::cout << "  line " << std::setw(8) << std::left << line << std::right
+                  << std::setw(14) << count
+                  << std::setw(8) << std::fixed << std::setprecision(2) << share << "%\n";
+    }
+    std::cout << "----------------\n\n";
+}
+
+// Writes the format read by the compiler's --profile-use (see codegen/DecoyProfile.hpp)
+void writeProfile(std::ostream& out, const std::string& moduleName, const ExecutionStats& stats, const LineTable* lineTable) {
+    out << "unit " << moduleName.substr(0, moduleName.size() - std::string(".xexm").size()) << '\n';
+
+    if (lineTable) {
+        std::map<uint32_t, uint64_t> lineCounts;
+        for (const auto& [address, count] : stats.addressCounts) {
+            if (const LineEntry* entry = lineTable->lookup(address)) {
+                lineCounts[entry->line] = std::max(lineCounts[entry->line], count);
+            }
+        }
+        for (const auto& [line, count] : lineCounts) {
+            out << "line " << line << ' ' << count << '\n';
+        }
+    } else {
+        for (const auto& [address, count] : stats.addressCounts) {
+            out << "address " << address << ' ' << count << '\n';
+        }
+    }
+}
+
+// Replaces the cost of every opcode that ran with its measured average and writes the model
+// back, for the compiler's --timing --cost-model. Time spent waiting (dl, tl) is not a cost.
+void writeCostModel(const std::string& path, const std::array<uint64_t, 256>& counts,
+    std::array<uint64_t, 256> nanoseconds, const std::array<uint64_t, 256>& delayMilliseconds, bool virtualTime) {
+    CostModel model = std::filesystem::exists(path) ? CostModel::load(path) : CostModel();
+
+    for (size_t opcode = 0; opcode < nanoseconds.size(); opcode++) {
+        uint64_t waited = virtualTime ? 0 : delayMilliseconds[opcode] * 1000000;
+        nanoseconds[opcode] = nanoseconds[opcode] > waited ? nanoseconds[opcode] - waited : 0;
+    }
+    model.calibrate(counts, nanoseconds);
+
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        throw std::runtime_error("Could not write cost model: " + path);
+    }
+    model.save(out);
+
+    size_t calibrated = std::count_if(counts.begin(), counts.end(), [](uint64_t count) { return count != 0; });
+    std::cout << "Calibrated " << calibrated << " opcodes into " << path << '\n';
+}
+
+int main(int argc, char* argv[]) {
+    std::cout << "Decoy Runner " << COMPILE_TAG << " (C) " << CURRENT_YEAR << "\n\n";
+
+    std::string inputFile, moduleName, profileFile, calibrateFile;
+    uint64_t maxSteps = 0;
+
+    bool showHelp = false, virtualTime = false, showEvents = false, quiet = false, showLines = false, mapped = false, checked = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-i" && i + 1 < argc) {
+            inputFile = argv[++i];
+        } else if (arg == "-m" && i + 1 < argc) {
+            moduleName = argv[++i];
+        } else if (arg == "--profile-out" && i + 1 < argc) {
+            profileFile = argv[++i];
+        } else if (arg == "--calibrate" && i + 1 < argc) {
+            calibrateFile = argv[++i];
+        } else if (arg == "--max-steps" && i + 1 < argc) {
+            maxSteps = std::stoull(argv[++i]);
+        } else if (arg == "-h") {
+            showHelp = true;
+        } else if (arg == "--virtual-time") {
+            virtualTime = true;
+        } else if (arg == "--events") {
+            showEvents = true;
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else if (arg == "--lines") {
+            showLines = true;
+        } else if (arg == "--mmap") {
+            mapped = true;
+        } else if (arg == "--checked") {
+            checked = true;
+        }
+    }
+
+    if (showHelp || inputFile.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--virtual-time] [--max-steps n] [--events] [--lines] [--profile-out file] [--calibrate cost-model] [--mmap] [--checked] [--quiet] [-m module] -i input.xex\n";
+        return 1;
+    }
+
+    try {
+        // Mapped runs load modules from the mapping, not from extracted copies; the rest of the
+        // archive is only read when needed
+        std::optional<MappedArchive> archive;
+        std::vector<ArchiveEntry> entries;
+        if (mapped) {
+            archive.emplace(inputFile);
+        }
+        if (!mapped || showLines || !profileFile.empty()) {
+            entries = readArchive(inputFile);
+        }
+
+        struct Module {
+            std::string name;
+            std::span<const uint8_t> bytecode;
+            std::optional<Sha256::Digest> hash; // Already checked against the archive index
+            std::optional<ModuleCertificate> certificate;
+        };
+        std::vector<Module> modules;
+        std::map<std::string, ModuleCertificate> certificates;
+        StringPool stringPool;
+        std::optional<std::string> tag;
+        if (archive) {
+            for (const auto& record : archive->getIndex().records) {
+                if (!archive->verify(record)) {
+                    throw std::runtime_error(record.name + " does not match its hash in the archive index");
+                }
+                if (isModuleEntry(record.name)) modules.push_back({ record.name, archive->moduleData(record), record.hash, {} });
+                if (isCertificateEntry(record.name)) certificates[record.name] = ModuleCertificate::decode(archive->moduleData(record));
+                if (record.name == StringPool::ENTRY_NAME) stringPool = StringPool::decode(archive->moduleData(record));
+                if (record.name == TAG_ENTRY_NAME) tag.emplace(archive->moduleData(record).begin(), archive->moduleData(record).end());
+            }
+        } else {
+            for (const auto& entry : entries) {
+                if (isModuleEntry(entry.name)) modules.push_back({ entry.name, entry.data, {}, {} });
+                if (isCertificateEntry(entry.name)) certificates[entry.name] = ModuleCertificate::decode(entry.data);
+                if (entry.name == StringPool::ENTRY_NAME) stringPool = StringPool::decode(entry.data);
+                if (entry.name == TAG_ENTRY_NAME) tag.emplace(entry.data.begin(), entry.data.end());
+            }
+        }
+
+        // Another compiler version may lay out the same opcodes differently, which the load
+        // checks would not catch
+        if (!tag) {
+            throw std::runtime_error(inputFile + " has no compiler tag; rebuild it with compiler " COMPILE_TAG);
+        }
+        if (*tag != COMPILE_TAG) {
+            throw std::runtime_error(inputFile + " was built by compiler " + *tag + "; rebuild it with compiler " COMPILE_TAG);
+        }
+
+        // Modules with a certificate that still matches them load without their checks (see
+        // VirtualMachine::load). Mapped modules were just hashed for the index, so that is free.
+        if (!checked) {
+            for (auto& module : modules) {
+                auto it = certificates.find(certificateEntryName(module.name));
+                if (it == certificates.end()) continue;
+                if (module.hash ? *module.hash == it->second.hash : it->second.certifies(module.bytecode)) {
+                    module.certificate = it->second;
+                }
+            }
+        }
+
+        std::ofstream profileOut;
+        if (!profileFile.empty()) {
+            profileOut.open(profileFile);
+            if (!profileOut.is_open()) {
+                throw std::runtime_error("Could not write profile: " + profileFile);
+            }
+        }
+
+        size_t modulesRun = 0;
+        std::array<uint64_t, 256> opcodeCounts{}, opcodeNanoseconds{}, opcodeDelayMilliseconds{};
+        for (const auto& entry : modules) {
+            if (!moduleName.empty() && entry.name != moduleName && entry.name != moduleName + ".xexm") continue;
+
+            const char* how = archive ? (entry.certificate ? " (mapped, verified)" : " (mapped)") : (entry.certificate ? " (verified)" : "");
+            std::cout << "Running " << entry.name << how << "\n\n";
+
+            // Events are only kept for --events
+            RecordingInputDevice device(virtualTime, !quiet, showEvents ? RecordingInputDevice::DEFAULT_EVENT_LIMIT : 0);
+            VirtualMachine vm(device);
+            vm.load(entry.bytecode, stringPool.strings, entry.certificate ? &*entry.certificate : nullptr);
+            vm.setProfiling(showLines || !profileFile.empty());
+            vm.setTiming(!calibrateFile.empty());
+            auto stats = vm.run(maxSteps);
+
+            for (size_t opcode = 0; opcode < opcodeCounts.size(); opcode++) {
+                opcodeCounts[opcode] += stats.opcodeCounts[opcode];
+                opcodeNanoseconds[opcode] += stats.opcodeNanoseconds[opcode];
+                opcodeDelayMilliseconds[opcode] += stats.opcodeDelayMilliseconds[opcode];
+            }
+
+            std::cout << "\n\n";
+            if (showEvents) {
+                printEvents(device);
+            }
+            printStats(stats, device, vm.getMemorySize());
+
+            auto lineEntry = std::find_if(entries.begin(), entries.end(),
+                [&](const ArchiveEntry& other) { return other.name == lineTableEntryName(entry.name); });
+            std::optional<LineTable> lineTable;
+            if (lineEntry != entries.end()) {
+                lineTable = LineTable::decode(lineEntry->data);
+            }
+
+            if (showLines) {
+                if (!lineTable) {
+                    std::cerr << "No line table for " << entry.name << " (compile with -g)\n\n";
+                } else {
+                    printLineProfile(stats, *lineTable, 20);
+                }
+            }
+
+            if (profileOut.is_open()) {
+                writeProfile(profileOut, entry.name, stats, lineTable ? &*lineTable : nullptr);
+            }
+            modulesRun++;
+        }
+
+        if (modulesRun == 0) {
+            throw std::runtime_error("No matching modules in " + inputFile);
+        }
+
+        if (!calibrateFile.empty()) {
+            writeCostModel(calibrateFile, opcodeCounts, opcodeNanoseconds, opcodeDelayMilliseconds, virtualTime);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "\nExecution Failed!\nError: " << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,459 @@
+#include "DecoyArchive.hpp"
+#include "DecoyArchiveIndex.hpp"
+#include "../codegen/DecoyStringPool.hpp"
+#include "../codegen/DecoyWorkRanges.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <span>
+#include <filesystem>
+#include <stdexcept>
+#include <unordered_map>
+#include <miniz/miniz.h>
+
+std::vector<ArchiveEntry> readArchive(const std::string& path) {
+    mz_zip_archive zipArchive;
+    memset(&zipArchive, 0, sizeof(mz_zip_archive));
+
+    if (!mz_zip_reader_init_file(&zipArchive, path.c_str(), 0)) {
+        throw std::runtime_error("Could not open archive: " + path);
+    }
+
+    std::vector<ArchiveEntry> entries;
+    mz_uint fileCount = mz_zip_reader_get_num_files(&zipArchive);
+    for (mz_uint i = 0; i < fileCount; i++) {
+        mz_zip_archive_file_stat stat;
+        if (!mz_zip_reader_file_stat(&zipArchive, i, &stat) || stat.m_is_directory) {
+            continue;
+        }
+
+        size_t size = 0;
+        void* data = mz_zip_reader_extract_to_heap(&zipArchive, i, &size, 0);
+        if (!data) {
+            mz_zip_reader_end(&zipArchive);
+            throw std::runtime_error(std::string("Failed to extract ") + stat.m_filename + " from " + path);
+        }
+
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        entries.push_back({ stat.m_filename, std::vector<uint8_t>(bytes, bytes + size), stat.m_comp_size });
+        mz_free(data);
+    }
+
+    mz_zip_reader_end(&zipArchive);
+
+    // Index records without an entry of their own are aliases of the entry stored at the same
+    // offset; each is read back as a copy placed right after the record listed before it
+    auto indexEntry = std::find_if(entries.begin(), entries.end(), [](const ArchiveEntry& entry) { return entry.name == ArchiveIndex::ENTRY_NAME; });
+    if (indexEntry != entries.end()) {
+        auto index = ArchiveIndex::decode(indexEntry->data);
+        std::unordered_map<std::string, size_t> byName;
+        for (size_t i = 0; i < entries.size(); i++) {
+            byName[entries[i].name] = i;
+        }
+
+        std::unordered_map<uint32_t, size_t> byOffset;
+        std::unordered_map<size_t, std::vector<ArchiveEntry>> aliasesAfter;
+        size_t previous = byName[ArchiveIndex::ENTRY_NAME];
+        for (const auto& record : index.records) {
+            auto it = byName.find(record.name);
+            if (it != byName.end()) {
+                byOffset.try_emplace(record.offset, it->second);
+                previous = it->second;
+                continue;
+            }
+
+            auto stored = byOffset.find(record.offset);
+            if (stored == byOffset.end()) {
+                throw std::runtime_error("Index of " + path + " lists " + record.name + " but the archive does not contain it");
+            }
+            aliasesAfter[previous].push_back({ record.name, entries[stored->second].data, 0 });
+        }
+
+        if (!aliasesAfter.empty()) {
+            std::vector<ArchiveEntry> expanded;
+            for (size_t i = 0; i < entries.size(); i++) {
+                expanded.push_back(std::move(entries[i]));
+                auto aliases = aliasesAfter.find(i);
+                if (aliases == aliasesAfter.end()) continue;
+                for (auto& alias : aliases->second) {
+                    expanded.push_back(std::move(alias));
+                }
+            }
+            entries = std::move(expanded);
+        }
+    }
+
+    return entries;
+}
+
+// Modification time of every written entry, so rebuilding the same entries reproduces the archive
+// byte for byte. DOS dates start in 1980; 1980-01-02 UTC is still in 1980 in every local time zone.
+static const MZ_TIME_T ENTRY_TIME = 315619200;
+
+// An entry ready to be added: deflated ahead of time, or stored when deflate would not pay off
+struct PreparedEntry {
+    const ArchiveEntry* entry;
+    std::vector<uint8_t> deflated; // Empty when stored
+    uint32_t crc = 0;
+};
+
+static std::vector<PreparedEntry> prepareEntries(const std::vector<const ArchiveEntry*>& entries, const CompressionOptions& compression) {
+    std::vector<PreparedEntry> prepared(entries.size());
+    int flags = static_cast<int>(tdefl_create_comp_flags_from_zip_params(compression.level, -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY));
+
+    WorkRanges ranges(entries.size(), compression.threads, 1);
+    ranges.run([&](size_t range) {
+        for (size_t i = ranges.begin(range); i < ranges.end(range); i++) {
+            const auto& data = entries[i]->data;
+            prepared[i].entry = entries[i];
+            if (compression.level == 0 || data.size() < compression.storeBelow || data.empty()) continue;
+
+            // Output must come out smaller than the input to be worth keeping; tdefl returns 0 if it does not fit
+            std::vector<uint8_t> deflated(data.size() - 1);
+            size_t size = deflated.empty() ? 0 : tdefl_compress_mem_to_mem(deflated.data(), deflated.size(), data.data(), data.size(), flags);
+            if (size == 0) continue;
+
+            deflated.resize(size);
+            prepared[i].deflated = std::move(deflated);
+            prepared[i].crc = static_cast<uint32_t>(mz_crc32(MZ_CRC32_INIT, data.data(), data.size()));
+        }
+    });
+
+    return prepared;
+}
+
+static void addEntry(mz_zip_archive& zipArchive, const PreparedEntry& prepared, const CompressionOptions& compression) {
+    const ArchiveEntry& entry = *prepared.entry;
+    MZ_TIME_T time = ENTRY_TIME;
+
+    mz_bool added;
+    if (prepared.deflated.empty()) {
+        added = mz_zip_writer_add_mem_ex_v2(&zipArchive, entry.name.c_str(), entry.data.data(), entry.data.size(), nullptr, 0,
+            MZ_NO_COMPRESSION, 0, 0, &time, nullptr, 0, nullptr, 0);
+    } else {
+        added = mz_zip_writer_add_mem_ex_v2(&zipArchive, entry.name.c_str(), prepared.deflated.data(), prepared.deflated.size(), nullptr, 0,
+            static_cast<mz_uint>(compression.level) | MZ_ZIP_FLAG_COMPRESSED_DATA, entry.data.size(), prepared.crc, &time, nullptr, 0, nullptr, 0);
+    }
+
+    if (!added) {
+        throw std::runtime_error("Failed to add " + entry.name + " to output binary");
+    }
+}
+
+// Whether an existing entry holds data, judged from the size and CRC-32 in its central directory
+// record alone. Inflating every entry to compare bytes cost as much as rebuilding the archive; a
+// same-size CRC collision between two builds of one entry is not worth that.
+static bool entryMatches(const mz_zip_archive_file_stat& stat, const std::vector<uint8_t>& data) {
+    return stat.m_uncomp_size == data.size() && stat.m_crc32 == mz_crc32(MZ_CRC32_INIT, data.data(), data.size());
+}
+
+// Entries the compiler writes for its inputs. An update gets all of them, so any it does not list
+// belong to a removed script or to an option no longer given.
+static bool isCompiledEntry(const std::string& name) {
+    return isModuleEntry(name) || name.ends_with(".xexl") || isCertificateEntry(name) || name == StringPool::ENTRY_NAME
+        || name == TAG_ENTRY_NAME || name == ArchiveIndex::ENTRY_NAME;
+}
+
+void writeArchive(const std::string& path, const std::vector<ArchiveEntry>& entries, const CompressionOptions& compression) {
+    std::vector<const ArchiveEntry*> pending;
+    for (const auto& entry : entries) {
+        pending.push_back(&entry);
+    }
+    auto prepared = prepareEntries(pending, compression);
+
+    mz_zip_archive zipArchive;
+    memset(&zipArchive, 0, sizeof(mz_zip_archive));
+
+    if (!mz_zip_writer_init_file(&zipArchive, path.c_str(), 0)) {
+        throw std::runtime_error("Failed to create output binary");
+    }
+
+    try {
+        for (const auto& entry : prepared) {
+            addEntry(zipArchive, entry, compression);
+        }
+    } catch (...) {
+        mz_zip_writer_end(&zipArchive);
+        throw;
+    }
+
+    if (!mz_zip_writer_finalize_archive(&zipArchive) || !mz_zip_writer_end(&zipArchive)) {
+        throw std::runtime_error("Failed to finalize output binary");
+    }
+}
+
+// Extra field zipalign uses for the same purpose: [2-byte id][2-byte size][2-byte alignment][zero padding]
+static const uint16_t ALIGNMENT_EXTRA_ID = 0xD935;
+static const size_t ALIGNMENT_EXTRA_MIN_SIZE = 6;
+
+// Extra field that moves data starting at dataStart up to the next multiple of alignment
+static std::vector<char> alignmentExtra(uint64_t dataStart, size_t alignment) {
+    size_t size = (alignment - dataStart % alignment) % alignment;
+    if (size == 0) return {};
+    while (size < ALIGNMENT_EXTRA_MIN_SIZE) size += alignment;
+
+    std::vector<char> extra(size, 0);
+    auto put16 = [&](size_t pos, size_t value) {
+        extra[pos] = static_cast<char>(value & 0xFF);
+        extra[pos + 1] = static_cast<char>((value >> 8) & 0xFF);
+    };
+    put16(0, ALIGNMENT_EXTRA_ID);
+    put16(2, size - 4);
+    put16(4, alignment);
+    return extra;
+}
+
+// Where an aligned stored entry's data starts when its local header is written at headerOffset
+static uint64_t alignedDataOffset(uint64_t headerOffset, const std::string& name, size_t alignment) {
+    uint64_t dataStart = headerOffset + MZ_ZIP_LOCAL_DIR_HEADER_SIZE + name.size();
+    return dataStart + alignmentExtra(dataStart, alignment).size();
+}
+
+static void addAlignedEntry(mz_zip_archive& zipArchive, const std::string& name, std::span<const uint8_t> data,
+    size_t alignment, uint64_t expectedOffset) {
+    auto extra = alignmentExtra(zipArchive.m_archive_size + MZ_ZIP_LOCAL_DIR_HEADER_SIZE + name.size(), alignment);
+    MZ_TIME_T time = ENTRY_TIME;
+
+    if (!mz_zip_writer_add_mem_ex_v2(&zipArchive, name.c_str(), data.data(), data.size(), nullptr, 0, MZ_NO_COMPRESSION, 0, 0,
+            &time, extra.data(), static_cast<mz_uint>(extra.size()), nullptr, 0)) {
+        throw std::runtime_error("Failed to add " + name + " to output binary");
+    }
+    if (zipArchive.m_archive_size != expectedOffset + data.size()) {
+        throw std::logic_error("Entry " + name + " was not written at its indexed offset");
+    }
+}
+
+void writeIndexedArchive(const std::string& path, const std::vector<ArchiveEntry>& entries, size_t alignment,
+    const CompressionOptions& compression) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment > MAX_ENTRY_ALIGNMENT) {
+        throw std::invalid_argument("Entry alignment must be a power of two up to " + std::to_string(MAX_ENTRY_ALIGNMENT));
+    }
+
+    // The string pool, the certificates and the compile tag are loaded alongside the modules, so
+    // they are indexed and mapped like them. Only what the VM executes from is aligned; the
+    // certificates and tag follow it packed, so a small --aligned archive does not pad each of
+    // them out to a full boundary
+    std::vector<const ArchiveEntry*> modules, packed, others;
+    for (const auto& entry : entries) {
+        if (isExecutedEntry(entry.name)) {
+            modules.push_back(&entry);
+        } else if (isCertificateEntry(entry.name) || entry.name == TAG_ENTRY_NAME) {
+            packed.push_back(&entry);
+        } else {
+            others.push_back(&entry);
+        }
+    }
+    size_t alignedCount = modules.size();
+    modules.insert(modules.end(), packed.begin(), packed.end());
+    auto entryAlignment = [&](size_t i) { return i < alignedCount ? alignment : 1; };
+
+    ArchiveIndex index;
+    index.alignment = static_cast<uint32_t>(alignment);
+    index.records.resize(modules.size());
+
+    WorkRanges ranges(modules.size(), compression.threads, 1);
+    ranges.run([&](size_t range) {
+        for (size_t i = ranges.begin(range); i < ranges.end(range); i++) {
+            Sha256 hash;
+            hash.update(modules[i]->data.data(), modules[i]->data.size());
+            index.records[i].hash = hash.finish();
+        }
+    });
+
+    // A module identical to an earlier one is stored once; its record becomes an alias pointing at
+    // the earlier module's data and it gets no entry of its own
+    std::vector<size_t> storedAs(modules.size());
+    std::unordered_map<std::string, size_t> firstWithHash;
+    for (size_t i = 0; i < modules.size(); i++) {
+        std::string key(index.records[i].hash.begin(), index.records[i].hash.end());
+        auto [it, added] = firstWithHash.try_emplace(key, i);
+        storedAs[i] = added || modules[it->second]->data != modules[i]->data ? i : it->second;
+    }
+
+    // Stored entries take exactly header + padding + data bytes, so every module's offset is
+    // known before anything is written and the index can go first
+    uint64_t indexOffset = alignedDataOffset(0, ArchiveIndex::ENTRY_NAME, alignment);
+    uint64_t end = indexOffset + ArchiveIndex::encodedSize(modules.size());
+    for (size_t i = 0; i < modules.size(); i++) {
+        uint64_t offset = index.records[storedAs[i]].offset;
+        if (storedAs[i] == i) {
+            offset = alignedDataOffset(end, modules[i]->name, entryAlignment(i));
+            end = offset + modules[i]->data.size();
+            if (end > UINT32_MAX) {
+                throw std::runtime_error("Modules do not fit the 4 GiB an indexed archive can address");
+            }
+        }
+        index.records[i].name = modules[i]->name;
+        index.records[i].offset = static_cast<uint32_t>(offset);
+        index.records[i].size = static_cast<uint32_t>(modules[i]->data.size());
+    }
+
+    auto prepared = prepareEntries(others, compression);
+    auto encodedIndex = index.encode();
+
+    mz_zip_archive zipArchive;
+    memset(&zipArchive, 0, sizeof(mz_zip_archive));
+
+    if (!mz_zip_writer_init_file(&zipArchive, path.c_str(), 0)) {
+        throw std::runtime_error("Failed to create output binary");
+    }
+
+    try {
+        addAlignedEntry(zipArchive, ArchiveIndex::ENTRY_NAME, encodedIndex, alignment, indexOffset);
+        for (size_t i = 0; i < modules.size(); i++) {
+            if (storedAs[i] != i) continue;
+            addAlignedEntry(zipArchive, modules[i]->name, modules[i]->data, entryAlignment(i), index.records[i].offset);
+        }
+        for (const auto& entry : prepared) {
+            addEntry(zipArchive, entry, compression);
+        }
+    } catch (...) {
+        mz_zip_writer_end(&zipArchive);
+        throw;
+    }
+
+    if (!mz_zip_writer_finalize_archive(&zipArchive) || !mz_zip_writer_end(&zipArchive)) {
+        throw std::runtime_error("Failed to finalize output binary");
+    }
+}
+
+ArchiveUpdateStats updateArchive(const std::string& path, const std::vector<ArchiveEntry>& entries,
+    const CompressionOptions& compression) {
+    ArchiveUpdateStats stats;
+
+    if (!std::filesystem::exists(path)) {
+        writeArchive(path, entries, compression);
+        stats.added = entries.size();
+        stats.rewritten = true;
+        return stats;
+    }
+
+    mz_zip_archive reader;
+    memset(&reader, 0, sizeof(mz_zip_archive));
+
+    if (!mz_zip_reader_init_file(&reader, path.c_str(), 0)) {
+        throw std::runtime_error("Could not open archive: " + path);
+    }
+
+    std::unordered_map<std::string, const ArchiveEntry*> pending;
+    for (const auto& entry : entries) {
+        pending[entry.name] = &entry;
+    }
+
+    // Decide what happens to every existing entry first, so an up-to-date archive is never touched
+    enum class Action { COPY, REPLACE, DROP };
+    std::vector<std::pair<Action, const ArchiveEntry*>> plan;
+
+    mz_uint fileCount = mz_zip_reader_get_num_files(&reader);
+    for (mz_uint i = 0; i < fileCount; i++) {
+        mz_zip_archive_file_stat stat;
+        if (!mz_zip_reader_file_stat(&reader, i, &stat)) {
+            mz_zip_reader_end(&reader);
+            throw std::runtime_error("Failed to read entry " + std::to_string(i) + " of " + path);
+        }
+
+        auto it = pending.find(stat.m_filename);
+        if (it == pending.end()) {
+            plan.emplace_back(isCompiledEntry(stat.m_filename) ? Action::DROP : Action::COPY, nullptr);
+            continue;
+        }
+
+        if (entryMatches(stat, it->second->data)) {
+            plan.emplace_back(Action::COPY, nullptr);
+        } else {
+            plan.emplace_back(Action::REPLACE, it->second);
+        }
+        pending.erase(it);
+    }
+
+    for (const auto& [action, entry] : plan) {
+        if (action == Action::COPY) stats.copied++;
+        if (action == Action::REPLACE) stats.recompressed++;
+        if (action == Action::DROP) stats.removed++;
+    }
+    stats.added = pending.size();
+    stats.rewritten = stats.recompressed + stats.added + stats.removed != 0;
+
+    if (!stats.rewritten) {
+        mz_zip_reader_end(&reader);
+        return stats;
+    }
+
+    // Deflate everything that changed up front, in the order it will be written
+    std::vector<const ArchiveEntry*> changed;
+    for (const auto& [action, entry] : plan) {
+        if (action == Action::REPLACE) changed.push_back(entry);
+    }
+    for (const auto& entry : entries) {
+        if (pending.contains(entry.name)) changed.push_back(&entry);
+    }
+
+    std::vector<PreparedEntry> prepared;
+    try {
+        prepared = prepareEntries(changed, compression);
+    } catch (...) {
+        mz_zip_reader_end(&reader);
+        throw;
+    }
+    size_t nextPrepared = 0;
+
+    mz_zip_archive writer;
+    memset(&writer, 0, sizeof(mz_zip_archive));
+
+    std::string temporary = path + ".tmp";
+    if (!mz_zip_writer_init_file(&writer, temporary.c_str(), 0)) {
+        mz_zip_reader_end(&reader);
+        throw std::runtime_error("Failed to create " + temporary);
+    }
+
+    try {
+        // Existing entries keep their order; the raw copy skips both inflate and deflate
+        for (mz_uint i = 0; i < fileCount; i++) {
+            const auto& [action, entry] = plan[i];
+            if (action == Action::REPLACE) {
+                addEntry(writer, prepared[nextPrepared++], compression);
+            } else if (action == Action::COPY && !mz_zip_writer_add_from_zip_reader(&writer, &reader, i)) {
+                throw std::runtime_error("Failed to copy entry " + std::to_string(i) + " to output binary");
+            }
+        }
+
+        while (nextPrepared < prepared.size()) {
+            addEntry(writer, prepared[nextPrepared++], compression);
+        }
+
+        if (!mz_zip_writer_finalize_archive(&writer)) {
+            throw std::runtime_error("Failed to finalize output binary");
+        }
+    } catch (...) {
+        mz_zip_writer_end(&writer);
+        mz_zip_reader_end(&reader);
+        std::filesystem::remove(temporary);
+        throw;
+    }
+
+    mz_zip_writer_end(&writer);
+    mz_zip_reader_end(&reader);
+
+    std::filesystem::rename(temporary, path);
+    return stats;
+}
+
+bool isModuleEntry(const std::string& name) {
+    return name.ends_with(".xexm");
+}
+
+bool isExecutedEntry(const std::string& name) {
+    return isModuleEntry(name) || name == StringPool::ENTRY_NAME;
+}
+
+std::string lineTableEntryName(const std::string& moduleName) {
+    return moduleName.substr(0, moduleName.size() - std::string(".xexm").size()) + ".xexl";
+}
+
+std::string certificateEntryName(const std::string& moduleName) {
+    return moduleName.substr(0, moduleName.size() - std::string(".xexm").size()) + ".xexv";
+}
+
+bool isCertificateEntry(const std::string& name) {
+    return name.ends_with(".xexv");
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ArchiveEntry {
+    std::string name;
+    std::vector<uint8_t> data;
+    uint64_t compressedSize;
+};
+
+// How written entries are compressed. Entries are deflated in parallel and added to the archive
+// in order with a fixed timestamp, so the archive bytes depend only on the entries and these
+// settings, never on the thread count.
+struct CompressionOptions {
+    int level = 6;          // 0 stores every entry, 1-10 deflate (10 is miniz's slowest "uber" level)
+    size_t storeBelow = 0;  // Entries smaller than this many bytes are stored raw
+    size_t threads = 1;
+};
+
+// Reads every file entry of a .xex archive into memory, plus a copy for every alias in its index
+std::vector<ArchiveEntry> readArchive(const std::string& path);
+
+// Writes a new archive, compressing every entry (compressedSize is ignored). Every entry is stored
+// on its own, even when its bytes match another's; only writeIndexedArchive stores those once.
+void writeArchive(const std::string& path, const std::vector<ArchiveEntry>& entries,
+    const CompressionOptions& compression = {});
+
+// Largest alignment writeIndexedArchive accepts; padding has to fit a 16-bit extra field length
+constexpr size_t MAX_ENTRY_ALIGNMENT = 32768;
+
+// Writes an archive that can be mapped and loaded without inflating: an ArchiveIndex entry first,
+// then every module entry and the string pool stored uncompressed with its data padded (through a
+// local-header extra field) to a multiple of alignment, then the module certificates and compile
+// tag, stored uncompressed and indexed but packed, then the remaining entries compressed as usual.
+// Byte-identical entries are stored once; the index lists the others as aliases at the same offset.
+void writeIndexedArchive(const std::string& path, const std::vector<ArchiveEntry>& entries, size_t alignment,
+    const CompressionOptions& compression = {});
+
+struct ArchiveUpdateStats {
+    size_t recompressed = 0; // Existing entries whose contents changed
+    size_t added = 0;
+    size_t copied = 0; // Entries kept with their compressed data as is
+    size_t removed = 0;
+    bool rewritten = false; // False when nothing changed and the archive was left untouched
+};
+
+// Brings an existing archive up to date with entries, which must hold every compiled entry
+// (modules, line tables, certificates, string pool, tag) the archive should have. Entries whose
+// size and CRC-32 are unchanged, and entries the compiler does not write, are copied without
+// recompressing; changed or new ones are compressed; compiled entries not in entries are dropped.
+// The result replaces the archive atomically. Creates the archive if needed. Like writeArchive, it
+// stores identical entries separately.
+ArchiveUpdateStats updateArchive(const std::string& path, const std::vector<ArchiveEntry>& entries,
+    const CompressionOptions& compression = {});
+
+// Entry holding the COMPILE_TAG of the compiler that built the archive
+constexpr const char* TAG_ENTRY_NAME = "inf";
+
+bool isModuleEntry(const std::string& name);
+
+// Modules and the string pool: the entries the VM executes from, so the only ones an indexed
+// archive aligns
+bool isExecutedEntry(const std::string& name);
+
+// Name of the optional debug line table entry that belongs to a module entry
+std::string lineTableEntryName(const std::string& moduleName);
+
+// Name of the verifier's certificate entry that belongs to a module entry (see DecoyVerifier.hpp)
+std::string certificateEntryName(const std::string& moduleName);
+bool isCertificateEntry(const std::string& name);
@@ -0,0 +1,59 @@
+#include "DecoyArchiveIndex.hpp"
+
+#include "../codegen/DecoyLittleEndian.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static const char INDEX_MAGIC[4] = { 'D', 'X', 'I', '1' };
+
+std::vector<uint8_t> ArchiveIndex::encode() const {
+    std::vector<uint8_t> out(INDEX_MAGIC, INDEX_MAGIC + sizeof(INDEX_MAGIC));
+    writeUI32(out, alignment);
+    writeUI32(out, static_cast<uint32_t>(records.size()));
+    writeUI32(out, RECORD_SIZE);
+
+    for (const auto& record : records) {
+        if (record.name.size() >= NAME_SIZE) {
+            throw std::runtime_error("Module name " + record.name + " is too long for the archive index");
+        }
+        out.insert(out.end(), record.name.begin(), record.name.end());
+        out.insert(out.end(), NAME_SIZE - record.name.size(), 0);
+        writeUI32(out, record.offset);
+        writeUI32(out, record.size);
+        out.insert(out.end(), record.hash.begin(), record.hash.end());
+    }
+
+    return out;
+}
+
+ArchiveIndex ArchiveIndex::decode(std::span<const uint8_t> data) {
+    if (data.size() < HEADER_SIZE || !std::equal(INDEX_MAGIC, INDEX_MAGIC + sizeof(INDEX_MAGIC), data.begin())) {
+        throw std::runtime_error("Not an archive index");
+    }
+
+    ArchiveIndex index;
+    index.alignment = readUI32(data, 4);
+    uint32_t count = readUI32(data, 8);
+    if (readUI32(data, 12) != RECORD_SIZE || data.size() != encodedSize(count)) {
+        throw std::runtime_error("Archive index has an unexpected layout");
+    }
+
+    for (size_t pos = HEADER_SIZE; pos < data.size(); pos += RECORD_SIZE) {
+        IndexRecord record;
+        const char* name = reinterpret_cast<const char*>(data.data() + pos);
+        record.name.assign(name, strnlen(name, NAME_SIZE - 1));
+        record.offset = readUI32(data, pos + NAME_SIZE);
+        record.size = readUI32(data, pos + NAME_SIZE + 4);
+        std::copy_n(data.begin() + pos + NAME_SIZE + 8, record.hash.size(), record.hash.begin());
+        index.records.push_back(std::move(record));
+    }
+
+    return index;
+}
+
+const IndexRecord* ArchiveIndex::find(const std::string& name) const {
+    auto it = std::find_if(records.begin(), records.end(), [&](const IndexRecord& record) { return record.name == name; });
+    return it == records.end() ? nullptr : &*it;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "../cache/DecoyHash.hpp"
+
+struct IndexRecord {
+    std::string name;
+    uint32_t offset; // Of the module's first bytecode byte, from the start of the archive
+    uint32_t size;
+    Sha256::Digest hash;
+};
+
+// Module index of an aligned archive (see writeIndexedArchive). It is always the archive's first
+// entry and is stored uncompressed, so a loader finds it from the local header at offset 0 and
+// reaches every module through it without inflating anything or reading the central directory.
+//
+// Encoding (little-endian, fixed layout):
+//   [4-byte magic "DXI1"][4-byte alignment][4-byte record count][4-byte record size (96)]
+//   per record: [56-byte name, NUL-padded][4-byte offset][4-byte size][32-byte SHA-256]
+class ArchiveIndex {
+    public:
+    static constexpr const char* ENTRY_NAME = "idx";
+    static constexpr size_t HEADER_SIZE = 16;
+    static constexpr size_t RECORD_SIZE = 96;
+    static constexpr size_t NAME_SIZE = 56; // Names may use all but the terminating NUL
+
+    uint32_t alignment = 1;
+    std::vector<IndexRecord> records;
+
+    std::vector<uint8_t> encode() const;
+    static ArchiveIndex decode(std::span<const uint8_t> data);
+
+    static size_t encodedSize(size_t recordCount) { return HEADER_SIZE + recordCount * RECORD_SIZE; }
+
+    const IndexRecord* find(const std::string& name) const;
+};
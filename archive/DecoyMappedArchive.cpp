@@ -0,0 +1,137 @@
+#include "DecoyMappedArchive.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Local file header fields used to find the index entry's data
+static const uint32_t LOCAL_HEADER_SIGNATURE = 0x04034b50;
+static const size_t LOCAL_HEADER_SIZE = 30;
+
+static uint32_t readLE(const uint8_t* data, size_t bytes) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        value |= static_cast<uint32_t>(data[i]) << (8 * i);
+    }
+    return value;
+}
+
+MappedArchive::MappedArchive(const std::string& path) {
+    map(path);
+    try {
+        readIndex(path);
+    } catch (...) {
+        unmap();
+        throw;
+    }
+}
+
+MappedArchive::~MappedArchive() {
+    unmap();
+}
+
+std::span<const uint8_t> MappedArchive::moduleData(const IndexRecord& record) const {
+    return { base + record.offset, record.size };
+}
+
+bool MappedArchive::verify(const IndexRecord& record) const {
+    Sha256 hash;
+    hash.update(base + record.offset, record.size);
+    return hash.finish() == record.hash;
+}
+
+void MappedArchive::readIndex(const std::string& path) {
+    // The index is the first entry and stored, so its data directly follows the first local header
+    if (size < LOCAL_HEADER_SIZE || readLE(base, 4) != LOCAL_HEADER_SIGNATURE || readLE(base + 8, 2) != 0) {
+        throw std::runtime_error(path + " is not an indexed archive (build it with --aligned)");
+    }
+
+    size_t nameSize = readLE(base + 26, 2);
+    size_t extraSize = readLE(base + 28, 2);
+    size_t dataStart = LOCAL_HEADER_SIZE + nameSize + extraSize;
+    size_t dataSize = readLE(base + 18, 4);
+    if (dataStart + dataSize > size ||
+        std::string(reinterpret_cast<const char*>(base + LOCAL_HEADER_SIZE), nameSize) != ArchiveIndex::ENTRY_NAME) {
+        throw std::runtime_error(path + " is not an indexed archive (build it with --aligned)");
+    }
+
+    index = ArchiveIndex::decode({ base + dataStart, dataSize });
+    for (const auto& record : index.records) {
+        if (static_cast<uint64_t>(record.offset) + record.size > size) {
+            throw std::runtime_error("Index of " + path + " points past the end of the archive");
+        }
+    }
+}
+
+#ifdef _WIN32
+
+void MappedArchive::map(const std::string& path) {
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        file = nullptr;
+        throw std::runtime_error("Could not open archive: " + path);
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        unmap();
+        throw std::runtime_error("Could not map archive: " + path);
+    }
+    size = static_cast<size_t>(fileSize.QuadPart);
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    base = mapping ? static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+    if (!base) {
+        unmap();
+        throw std::runtime_error("Could not map archive: " + path);
+    }
+}
+
+void MappedArchive::unmap() {
+    if (base) UnmapViewOfFile(base);
+    if (mapping) CloseHandle(mapping);
+    if (file) CloseHandle(file);
+    base = nullptr;
+    mapping = file = nullptr;
+    size = 0;
+}
+
+#else
+
+void MappedArchive::map(const std::string& path) {
+    descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) {
+        throw std::runtime_error("Could not open archive: " + path);
+    }
+
+    struct stat info;
+    if (fstat(descriptor, &info) != 0 || info.st_size == 0) {
+        unmap();
+        throw std::runtime_error("Could not map archive: " + path);
+    }
+    size = static_cast<size_t>(info.st_size);
+
+    void* address = mmap(nullptr, size, PROT_READ, MAP_SHARED, descriptor, 0);
+    if (address == MAP_FAILED) {
+        unmap();
+        throw std::runtime_error("Could not map archive: " + path);
+    }
+    base = static_cast<const uint8_t*>(address);
+}
+
+void MappedArchive::unmap() {
+    if (base) munmap(const_cast<uint8_t*>(base), size);
+    if (descriptor >= 0) close(descriptor);
+    base = nullptr;
+    descriptor = -1;
+    size = 0;
+}
+
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+
+#include "DecoyArchiveIndex.hpp"
+
+// Read-only memory mapping of an indexed archive (see writeIndexedArchive). Opening reads one
+// local header and the index; module data is then read straight from the mapping, with no
+// inflate, no extraction buffer and no walk of the central directory. VM::load still decodes it
+// into its own operations, so what mapping saves is the read and inflate, not the decode.
+class MappedArchive {
+    public:
+    explicit MappedArchive(const std::string& path);
+    ~MappedArchive();
+
+    MappedArchive(const MappedArchive&) = delete;
+    MappedArchive& operator=(const MappedArchive&) = delete;
+
+    const ArchiveIndex& getIndex() const { return index; }
+
+    std::span<const uint8_t> moduleData(const IndexRecord& record) const;
+
+    // Whether the module's bytes still match the hash in its index record
+    bool verify(const IndexRecord& record) const;
+
+    private:
+    const uint8_t* base = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#else
+    int descriptor = -1;
+#endif
+    ArchiveIndex index;
+
+    void map(const std::string& path);
+    void unmap();
+    void readIndex(const std::string& path);
+};
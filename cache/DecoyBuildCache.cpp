@@ -0,0 +1,181 @@
+#include "DecoyBuildCache.hpp"
+#include "DecoyHash.hpp"
+
+#include "../DecoyDefs.hpp"
+#include "../codegen/DecoyLittleEndian.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+namespace fs = std::filesystem;
+
+// Entry layout: [magic][4-byte bytecode size][bytecode][4-byte line table size][line table]
+static const char ENTRY_MAGIC[4] = { 'D', 'X', 'C', '1' };
+static const char* ENTRY_EXTENSION = ".dxc";
+static const char* TEMPORARY_EXTENSION = ".tmp"; // Followed by a random number (see store)
+
+static bool readBlob(const std::vector<uint8_t>& in, size_t& pos, std::vector<uint8_t>& blob) {
+    if (in.size() - pos < 4) return false;
+
+    uint32_t size = readUI32(in, pos);
+    pos += 4;
+
+    if (in.size() - pos < size) return false;
+    blob.assign(in.begin() + pos, in.begin() + pos + size);
+    pos += size;
+    return true;
+}
+
+BuildCache::BuildCache(const fs::path& directory, uint64_t maxBytes)
+    : directory(directory), maxBytes(maxBytes) {
+    fs::create_directories(directory);
+}
+
+std::string BuildCache::key(const std::string& source, const std::string& options) {
+    // Length-prefix every field so no two (tag, options, source) triples hash the same bytes
+    Sha256 hash;
+    for (const std::string& field : { std::string(COMPILE_TAG), options, source }) {
+        hash.update(std::to_string(field.size()) + ':');
+        hash.update(field);
+    }
+    return Sha256::toHex(hash.finish());
+}
+
+std::string BuildCache::key(std::istream& source, const std::string& options) {
+    std::vector<char> block(64 * 1024);
+    auto rewind = [&] {
+        source.clear();
+        source.seekg(0);
+    };
+
+    uint64_t size = 0;
+    while (source.read(block.data(), block.size()) || source.gcount() > 0) {
+        size += source.gcount();
+    }
+    rewind();
+
+    Sha256 hash;
+    for (const std::string& field : { std::string(COMPILE_TAG), options }) {
+        hash.update(std::to_string(field.size()) + ':');
+        hash.update(field);
+    }
+    hash.update(std::to_string(size) + ':');
+    while (source.read(block.data(), block.size()) || source.gcount() > 0) {
+        hash.update(block.data(), static_cast<size_t>(source.gcount()));
+    }
+    rewind();
+
+    return Sha256::toHex(hash.finish());
+}
+
+std::optional<CachedUnit> BuildCache::load(const std::string& key) {
+    fs::path path = entryPath(key);
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::lock_guard lock(statsMutex);
+        stats.misses++;
+        return std::nullopt;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+
+    CachedUnit unit;
+    size_t pos = sizeof(ENTRY_MAGIC);
+    bool valid = data.size() >= pos && std::equal(data.begin(), data.begin() + pos, ENTRY_MAGIC) &&
+        readBlob(data, pos, unit.bytecode) && readBlob(data, pos, unit.lineTable) && pos == data.size();
+
+    std::error_code ignored;
+    if (!valid) {
+        // Truncated or foreign file: drop it and rebuild
+        fs::remove(path, ignored);
+        std::lock_guard lock(statsMutex);
+        stats.misses++;
+        return std::nullopt;
+    }
+
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ignored);
+    std::lock_guard lock(statsMutex);
+    stats.hits++;
+    stats.bytesRead += data.size();
+    return unit;
+}
+
+void BuildCache::store(const std::string& key, const CachedUnit& unit) {
+    std::vector<uint8_t> data(ENTRY_MAGIC, ENTRY_MAGIC + sizeof(ENTRY_MAGIC));
+    writeUI32(data, static_cast<uint32_t>(unit.bytecode.size()));
+    data.insert(data.end(), unit.bytecode.begin(), unit.bytecode.end());
+    writeUI32(data, static_cast<uint32_t>(unit.lineTable.size()));
+    data.insert(data.end(), unit.lineTable.begin(), unit.lineTable.end());
+
+    static thread_local std::mt19937_64 random(std::random_device{}());
+    fs::path temporary = directory / (key + TEMPORARY_EXTENSION + std::to_string(random()));
+
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        if (!file.write(reinterpret_cast<const char*>(data.data()), data.size())) {
+            std::error_code ignored;
+            fs::remove(temporary, ignored);
+            throw std::runtime_error("Could not write cache entry " + temporary.string());
+        }
+    }
+
+    // Another build may have stored the same entry meanwhile; its contents are identical
+    fs::rename(temporary, entryPath(key));
+
+    std::lock_guard lock(statsMutex);
+    stats.stores++;
+    stats.bytesWritten += data.size();
+}
+
+void BuildCache::evict() {
+    struct Entry {
+        fs::path path;
+        fs::file_time_type lastUsed;
+        uint64_t size;
+    };
+
+    std::vector<Entry> entries;
+    uint64_t totalSize = 0;
+    auto staleBefore = fs::file_time_type::clock::now() - STALE_TEMPORARY_AGE;
+    for (const auto& file : fs::directory_iterator(directory)) {
+        if (!file.is_regular_file()) continue;
+
+        // A store that is still writing will rename its file shortly, so only old ones go
+        if (file.path().extension().string().starts_with(TEMPORARY_EXTENSION)) {
+            std::error_code ignored;
+            if (file.last_write_time() >= staleBefore || !fs::remove(file.path(), ignored)) {
+                totalSize += file.file_size();
+            }
+            continue;
+        }
+        if (file.path().extension() != ENTRY_EXTENSION) continue;
+
+        entries.push_back({ file.path(), file.last_write_time(), file.file_size() });
+        totalSize += entries.back().size;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+
+    for (const auto& entry : entries) {
+        if (totalSize <= maxBytes) break;
+
+        std::error_code ignored;
+        if (fs::remove(entry.path, ignored)) {
+            totalSize -= entry.size;
+            std::lock_guard lock(statsMutex);
+            stats.evictions++;
+        }
+    }
+}
+
+CacheStats BuildCache::getStats() const {
+    std::lock_guard lock(statsMutex);
+    return stats;
+}
+
+fs::path BuildCache::entryPath(const std::string& key) const {
+    return directory / (key + ENTRY_EXTENSION);
+}
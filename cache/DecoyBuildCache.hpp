@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// What the compiler produces for one source, i.e. everything an archive needs from it
+struct CachedUnit {
+    std::vector<uint8_t> bytecode;
+    std::vector<uint8_t> lineTable; // Empty unless built with -g
+};
+
+struct CacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t stores = 0;
+    uint64_t evictions = 0;
+    uint64_t bytesRead = 0;
+    uint64_t bytesWritten = 0;
+};
+
+// Content-addressed on-disk cache of compiled units.
+//
+// Entries are named by the SHA-256 of the compiler tag, the codegen options and the source
+// text, so a changed input simply misses and stale entries age out. Entries are written to a
+// temporary file and renamed into place, so concurrent builds sharing a directory never see
+// a partial entry. A hit refreshes the entry's modification time; evict() removes the least
+// recently used entries until the directory fits in maxBytes, counting temporary files too, and
+// deletes temporary files a crashed build left behind. Loads and stores are safe to call from
+// several threads at once.
+class BuildCache {
+    public:
+    BuildCache(const std::filesystem::path& directory, uint64_t maxBytes);
+
+    static std::string key(const std::string& source, const std::string& options);
+
+    // The same key for a source read from a stream, which is read twice (for its size, then
+    // its bytes) and left at its start
+    static std::string key(std::istream& source, const std::string& options);
+
+    std::optional<CachedUnit> load(const std::string& key);
+    void store(const std::string& key, const CachedUnit& unit);
+    void evict();
+
+    CacheStats getStats() const;
+
+    private:
+    // A temporary file this old belongs to no running store, which renames it within moments
+    static constexpr std::chrono::hours STALE_TEMPORARY_AGE{ 1 };
+
+    std::filesystem::path directory;
+    uint64_t maxBytes;
+    CacheStats stats;
+    mutable std::mutex statsMutex; // One cache serves every compile thread of a build
+
+    std::filesystem::path entryPath(const std::string& key) const;
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+// SHA-256, used to name content-addressed build artifacts
+class Sha256 {
+    public:
+    using Digest = std::array<uint8_t, 32>;
+
+    Sha256();
+
+    void update(const void* data, size_t size);
+    void update(const std::string& text) { update(text.data(), text.size()); }
+
+    Digest finish();
+
+    static std::string toHex(const Digest& digest);
+
+    private:
+    std::array<uint32_t, 8> state;
+    std::array<uint8_t, 64> block;
+    size_t blockSize = 0;
+    uint64_t totalSize = 0;
+
+    void transform(const uint8_t* chunk);
+};
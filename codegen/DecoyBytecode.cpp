@@ -0,0 +1,328 @@
+#include "DecoyBytecode.hpp"
+
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+    using L = OperandLayout;
+
+    const std::vector<InstructionInfo>& instructionTable() {
+        static const std::vector<InstructionInfo> table = {
+            {Instruction::CV, "cv", {L::STRING, L::TYPE, L::VARIABLE}},
+            {Instruction::AV, "av", {L::VARIABLE, L::VALUE}},
+            {Instruction::AAV, "aav", {L::VARIABLE, L::VALUE}},
+            {Instruction::SAV, "sav", {L::VARIABLE, L::VALUE}},
+            {Instruction::MAV, "mav", {L::VARIABLE, L::VALUE}},
+            {Instruction::DAV, "dav", {L::VARIABLE, L::VALUE}},
+            {Instruction::MOAV, "moav", {L::VARIABLE, L::VALUE}},
+            {Instruction::INC, "inc", {L::VARIABLE}},
+            {Instruction::DEC, "dec", {L::VARIABLE}},
+            {Instruction::P, "p", {L::PRINT_LIST}},
+            {Instruction::PL, "pl", {L::PRINT_LIST}},
+            {Instruction::PK, "pk", {L::VALUE}},
+            {Instruction::RK, "rk", {L::VALUE}},
+            {Instruction::IKD, "ikd", {L::VARIABLE, L::VARIABLE}},
+            {Instruction::MVM, "mvm", {L::VALUE, L::VALUE}},
+            {Instruction::DFP, "dfp", {}},
+            {Instruction::JMP, "jmp", {L::LABEL}},
+            {Instruction::CEJMP, "cejmp", {L::VARIABLE, L::VARIABLE, L::LABEL, L::LABEL}},
+            {Instruction::CGJMP, "cgjmp", {L::VARIABLE, L::VARIABLE, L::LABEL, L::LABEL}},
+            {Instruction::CLJMP, "cljmp", {L::VARIABLE, L::VARIABLE, L::LABEL, L::LABEL}},
+            {Instruction::CEGJMP, "cegjmp", {L::VARIABLE, L::VARIABLE, L::LABEL, L::LABEL}},
+            {Instruction::CELJMP, "celjmp", {L::VARIABLE, L::VARIABLE, L::LABEL, L::LABEL}},
+            {Instruction::DL, "dl", {L::VALUE}},
+            {Instruction::PKB, "pkb", {L::KEY_LIST}},
+            {Instruction::RKB, "rkb", {L::KEY_LIST}},
+            {Instruction::TL, "tl", {L::TIMELINE}},
+            {Instruction::CALL, "call", {L::LABEL}},
+            {Instruction::RET, "ret", {}},
+            {Instruction::FILL, "fill", {L::REGISTER, L::VARIABLE}},
+            {Instruction::SPILL, "spill", {L::REGISTER, L::VARIABLE}},
+            {Instruction::AVR, "avr", {L::REGISTER, L::VALUE}},
+            {Instruction::AAVR, "aavr", {L::REGISTER, L::VALUE}},
+            {Instruction::SAVR, "savr", {L::REGISTER, L::VALUE}},
+            {Instruction::MAVR, "mavr", {L::REGISTER, L::VALUE}},
+            {Instruction::DAVR, "davr", {L::REGISTER, L::VALUE}},
+            {Instruction::MOAVR, "moavr", {L::REGISTER, L::VALUE}},
+            {Instruction::INCR, "incr", {L::REGISTER}},
+            {Instruction::DECR, "decr", {L::REGISTER}},
+            {Instruction::CEJMPR, "cejmpr", {L::VALUE, L::VALUE, L::LABEL, L::LABEL}},
+            {Instruction::CGJMPR, "cgjmpr", {L::VALUE, L::VALUE, L::LABEL, L::LABEL}},
+            {Instruction::CLJMPR, "cljmpr", {L::VALUE, L::VALUE, L::LABEL, L::LABEL}},
+            {Instruction::CEGJMPR, "cegjmpr", {L::VALUE, L::VALUE, L::LABEL, L::LABEL}},
+            {Instruction::CELJMPR, "celjmpr", {L::VALUE, L::VALUE, L::LABEL, L::LABEL}},
+            {Instruction::NOP, "nop", {}},
+        };
+        return table;
+    }
+
+    // Memory form and register form of every instruction that has both
+    constexpr std::pair<Instruction, Instruction> registerForms[] = {
+        {Instruction::AV, Instruction::AVR},
+        {Instruction::AAV, Instruction::AAVR},
+        {Instruction::SAV, Instruction::SAVR},
+        {Instruction::MAV, Instruction::MAVR},
+        {Instruction::DAV, Instruction::DAVR},
+        {Instruction::MOAV, Instruction::MOAVR},
+        {Instruction::INC, Instruction::INCR},
+        {Instruction::DEC, Instruction::DECR},
+        {Instruction::CEJMP, Instruction::CEJMPR},
+        {Instruction::CGJMP, Instruction::CGJMPR},
+        {Instruction::CLJMP, Instruction::CLJMPR},
+        {Instruction::CEGJMP, Instruction::CEGJMPR},
+        {Instruction::CELJMP, Instruction::CELJMPR},
+    };
+}
+
+const InstructionInfo* findInstructionInfo(uint8_t opcode) {
+    static const auto byOpcode = [] {
+        std::unordered_map<uint8_t, const InstructionInfo*> map;
+        for (const auto& info : instructionTable()) {
+            map[static_cast<uint8_t>(info.opcode)] = &info;
+        }
+        return map;
+    }();
+
+    auto it = byOpcode.find(opcode);
+    return it == byOpcode.end() ? nullptr : it->second;
+}
+
+const InstructionInfo* findInstructionInfo(const std::string& mnemonic) {
+    static const auto byMnemonic = [] {
+        std::unordered_map<std::string, const InstructionInfo*> map;
+        for (const auto& info : instructionTable()) {
+            map[info.mnemonic] = &info;
+        }
+        return map;
+    }();
+
+    auto it = byMnemonic.find(mnemonic);
+    return it == byMnemonic.end() ? nullptr : it->second;
+}
+
+const char* operandKindName(OperandKind kind) {
+    switch (kind) {
+        case OperandKind::LITERAL:  return "literal";
+        case OperandKind::VARIABLE: return "variable";
+        case OperandKind::LABEL:    return "label";
+        case OperandKind::STRING:   return "string";
+        case OperandKind::TYPE:     return "type";
+        case OperandKind::POOLED_STRING: return "pooled";
+        case OperandKind::EVENT:    return "event";
+        case OperandKind::REGISTER: return "register";
+        default:                    return "unknown";
+    }
+}
+
+Instruction registerForm(Instruction opcode) {
+    for (const auto& [memory, registers] : registerForms) {
+        if (memory == opcode) return registers;
+    }
+    return opcode;
+}
+
+Instruction memoryForm(Instruction opcode) {
+    for (const auto& [memory, registers] : registerForms) {
+        if (registers == opcode) return memory;
+    }
+    return opcode;
+}
+
+size_t literalSize(Type type) {
+    switch (type) {
+        case Type::I8: case Type::UI8: return 1;
+        case Type::I16: case Type::UI16: return 2;
+        case Type::I32: case Type::UI32: case Type::F32: return 4;
+        default: return 0;
+    }
+}
+
+DecodedInstruction BytecodeReader::next(std::vector<OperandSlot>* slots) {
+    DecodedInstruction decoded;
+    decoded.address = pos;
+
+    uint8_t opcode = readByte();
+    const InstructionInfo* info = findInstructionInfo(opcode);
+    if (!info) {
+        pos = decoded.address;
+        throw decodeError("Unknown opcode " + std::to_string(opcode));
+    }
+    decoded.opcode = info->opcode;
+
+    for (OperandLayout layout : info->layout) {
+        size_t start = pos, firstOperand = decoded.operands.size();
+        readOperand(layout, decoded.operands);
+        if (slots) {
+            slots->push_back({ start - decoded.address, pos - start, firstOperand, decoded.operands.size() - firstOperand });
+        }
+    }
+
+    decoded.size = pos - decoded.address;
+    return decoded;
+}
+
+void BytecodeReader::readOperand(OperandLayout layout, std::vector<DecodedOperand>& operands) {
+    switch (layout) {
+        case OperandLayout::VALUE:
+            operands.push_back(readValue());
+            break;
+        case OperandLayout::VARIABLE:
+            operands.push_back({ .kind = OperandKind::VARIABLE, .value = readUI32(), .size = 4 });
+            break;
+        case OperandLayout::LABEL:
+            operands.push_back({ .kind = OperandKind::LABEL, .value = readUI32(), .size = 4 });
+            break;
+        case OperandLayout::STRING:
+            operands.push_back(readString());
+            break;
+        case OperandLayout::REGISTER:
+            operands.push_back({ .kind = OperandKind::REGISTER, .value = readRegister(), .size = 1 });
+            break;
+        case OperandLayout::TYPE: {
+            auto type = static_cast<Type>(readByte());
+            if (literalSize(type) == 0) throw decodeError("Invalid variable type");
+            operands.push_back({ .kind = OperandKind::TYPE, .type = type, .size = 1 });
+            break;
+        }
+        case OperandLayout::PRINT_LIST: {
+            uint8_t count = readByte();
+            for (uint8_t i = 0; i < count; i++) {
+                uint8_t rawTag = readByte();
+                auto tag = static_cast<Type>(rawTag);
+                if (rawTag == POOLED_STRING_TAG) {
+                    operands.push_back({ .kind = OperandKind::POOLED_STRING, .value = readUI32(), .size = 1 + 4 });
+                } else if (tag == Type::STR) {
+                    auto operand = readString();
+                    operand.size++;
+                    operands.push_back(operand);
+                } else if (tag == Type::NT) {
+                    operands.push_back({ .kind = OperandKind::VARIABLE, .value = readUI32(), .size = 1 + 4 });
+                } else {
+                    throw decodeError("Invalid print operand tag");
+                }
+            }
+            break;
+        }
+        case OperandLayout::KEY_LIST: {
+            uint8_t count = readByte();
+            for (uint8_t i = 0; i < count; i++) {
+                operands.push_back({ .kind = OperandKind::LITERAL, .type = Type::UI8, .value = readByte(), .size = 1 });
+            }
+            break;
+        }
+        case OperandLayout::TIMELINE: {
+            uint32_t count = readUI32();
+            for (uint32_t i = 0; i < count; i++) {
+                uint32_t delay = readUI32();
+                auto event = static_cast<Instruction>(readByte());
+                operands.push_back({ .kind = OperandKind::EVENT, .value = delay, .size = 4 + 1, .event = event });
+
+                if (event == Instruction::PK || event == Instruction::RK) {
+                    operands.push_back({ .kind = OperandKind::LITERAL, .type = Type::UI8, .value = readByte(), .size = 1 });
+                } else if (event == Instruction::MVM) {
+                    operands.push_back({ .kind = OperandKind::LITERAL, .type = Type::I32, .value = readUI32(), .size = 4 });
+                    operands.push_back({ .kind = OperandKind::LITERAL, .type = Type::I32, .value = readUI32(), .size = 4 });
+                } else if (event != Instruction::DL) {
+                    throw decodeError("Invalid timeline event");
+                }
+            }
+            break;
+        }
+    }
+}
+
+DecodedOperand BytecodeReader::readValue() {
+    uint8_t tag = readByte();
+    if (tag == REGISTER_TAG) {
+        return { .kind = OperandKind::REGISTER, .value = readRegister(), .size = 1 + 1 };
+    }
+
+    auto type = static_cast<Type>(tag);
+    if (type == Type::NT) {
+        return { .kind = OperandKind::VARIABLE, .value = readUI32(), .size = 1 + 4 };
+    }
+
+    size_t size = literalSize(type);
+    if (size == 0) throw decodeError("Invalid operand type tag");
+
+    uint32_t value = 0;
+    for (size_t i = 0; i < size; i++) {
+        value |= static_cast<uint32_t>(readByte()) << (8 * i);
+    }
+    return { .kind = OperandKind::LITERAL, .type = type, .value = value, .size = 1 + size };
+}
+
+DecodedOperand BytecodeReader::readString() {
+    uint32_t length = readUI32();
+    if (length > bytecode.size() - pos) throw decodeError("String runs past end of bytecode");
+
+    std::string text(reinterpret_cast<const char*>(bytecode.data() + pos), length);
+    pos += length;
+    return { .kind = OperandKind::STRING, .text = std::move(text), .size = 4 + length };
+}
+
+uint8_t BytecodeReader::readByte() {
+    if (isAtEnd()) throw decodeError("Unexpected end of bytecode");
+    return bytecode[pos++];
+}
+
+uint8_t BytecodeReader::readRegister() {
+    uint8_t index = readByte();
+    if (index >= REGISTER_COUNT) throw decodeError("Invalid register " + std::to_string(index));
+    return index;
+}
+
+uint32_t BytecodeReader::readUI32() {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= static_cast<uint32_t>(readByte()) << (8 * i);
+    }
+    return value;
+}
+
+std::runtime_error BytecodeReader::decodeError(const std::string& message) const {
+    return std::runtime_error("Offset " + std::to_string(pos) + ": " + message);
+}
+
+void BytecodeWriter::emitUI32(uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        emitByte((value >> (8 * i)) & 0xFF);
+    }
+}
+
+void BytecodeWriter::emitI32(int32_t value) {
+    emitUI32(value);
+}
+
+void BytecodeWriter::emitUI16(uint16_t value) {
+    emitByte(static_cast<uint8_t>(value & 0xFF));
+    emitByte(static_cast<uint8_t>((value >> 8) & 0xFF));
+}
+
+void BytecodeWriter::emitI16(int16_t value) {
+    emitUI16(static_cast<uint16_t>(value));
+}
+
+void BytecodeWriter::emitI8(int8_t value) {
+    emitUI8(static_cast<uint8_t>(value));
+}
+
+void BytecodeWriter::emitUI8(uint8_t value) {
+    emitByte(value);
+}
+
+void BytecodeWriter::emitF32(float value) {
+    uint32_t binary;
+    memcpy(&binary, &value, sizeof(float));
+    emitUI32(binary);
+}
+
+void BytecodeWriter::emitString(const std::string& str) {
+    emitUI32(str.size());
+    for (char c : str) emitByte(static_cast<uint8_t>(c));
+}
+
+void BytecodeWriter::emitType(Type type) {
+    emitByte(static_cast<uint8_t>(type));
+}
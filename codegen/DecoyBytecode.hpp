@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "../parser/DecoyParser.hpp"
+
+// How each operand of an instruction is laid out in the emitted bytecode
+enum class OperandLayout : uint8_t {
+    VALUE, // [type][literal], [NT][4-byte variable offset] or [REGISTER_TAG][1-byte register]
+    VARIABLE, // [4-byte variable offset]
+    LABEL, // [4-byte instruction address]
+    STRING, // [4-byte length][bytes]
+    TYPE, // [1-byte type]
+    PRINT_LIST, // [1-byte count] then per item [STR][string], [NT][4-byte variable offset] or [POOLED_STRING_TAG][4-byte pool index]
+    KEY_LIST, // [1-byte count] then a 1-byte key each
+    TIMELINE, // [4-byte count] then per record [4-byte delay ms][1-byte opcode] and the event's operands:
+              // pk/rk [1-byte key], mvm [4-byte x][4-byte y], dl nothing (a wait with no event)
+    REGISTER, // [1-byte register]
+};
+
+// Print-list tag of a string kept in the archive's string pool (see DecoyStringPool.hpp) instead of inline
+constexpr uint8_t POOLED_STRING_TAG = 0x80;
+
+// Value tag of a variable held in a VM register (see RegisterAllocator)
+constexpr uint8_t REGISTER_TAG = 0x80;
+
+// Registers the VM provides; register operands are below this
+constexpr size_t REGISTER_COUNT = 16;
+
+// What a decoded operand turned out to be
+enum class OperandKind : uint8_t {
+    LITERAL,
+    VARIABLE,
+    LABEL,
+    STRING,
+    TYPE,
+    POOLED_STRING, // value is the index into the archive's string pool
+    EVENT, // Timeline record: event happens value milliseconds after the previous one; its operands follow
+    REGISTER, // value is the register number
+};
+
+struct InstructionInfo {
+    Instruction opcode;
+    const char* mnemonic;
+    std::vector<OperandLayout> layout;
+};
+
+struct DecodedOperand {
+    OperandKind kind;
+    Type type = Type::NT; // Literal type, or the declared type of a TYPE operand
+    uint32_t value = 0; // Literal bits, variable offset or label address
+    std::string text; // String contents
+    size_t size = 0; // Encoded size including any type tag
+    Instruction event = Instruction::NOP; // What an EVENT does
+};
+
+// Where one operand of an instruction's layout is encoded. A list decodes to several operands,
+// or none, and its count is part of the slot but of no operand.
+struct OperandSlot {
+    size_t offset;       // From the instruction's address
+    size_t size;
+    size_t firstOperand; // Index into DecodedInstruction::operands
+    size_t operandCount;
+};
+
+struct DecodedInstruction {
+    size_t address;
+    size_t size;
+    Instruction opcode;
+    std::vector<DecodedOperand> operands;
+};
+
+const InstructionInfo* findInstructionInfo(uint8_t opcode);
+const InstructionInfo* findInstructionInfo(const std::string& mnemonic);
+
+const char* operandKindName(OperandKind kind);
+
+// The opcode that keeps an instruction's variable in a register (avr for av, cejmpr for cejmp),
+// or opcode itself if it has no register form. memoryForm maps back and leaves others alone.
+Instruction registerForm(Instruction opcode);
+Instruction memoryForm(Instruction opcode);
+
+size_t literalSize(Type type);
+
+class BytecodeReader {
+    public:
+    explicit BytecodeReader(std::span<const uint8_t> bytecode) : bytecode(bytecode), pos(0) {}
+
+    bool isAtEnd() const { return pos >= bytecode.size(); }
+    size_t position() const { return pos; }
+
+    // Appends the instruction's slots, one per entry of its layout, to slots if given
+    DecodedInstruction next(std::vector<OperandSlot>* slots = nullptr);
+
+    private:
+    std::span<const uint8_t> bytecode;
+    size_t pos;
+
+    void readOperand(OperandLayout layout, std::vector<DecodedOperand>& operands);
+    DecodedOperand readValue();
+    DecodedOperand readString();
+
+    uint8_t readByte();
+    uint8_t readRegister();
+    uint32_t readUI32();
+
+    std::runtime_error decodeError(const std::string& message) const;
+};
+
+// Writes encoded instructions into a preallocated span, so instructions whose addresses are
+// already known can be emitted independently (and concurrently) into one buffer
+class BytecodeWriter {
+    public:
+    BytecodeWriter(uint8_t* begin, uint8_t* end) : cursor(begin), limit(end) {}
+
+    bool isAtEnd() const { return cursor == limit; }
+
+    void emitByte(uint8_t value) {
+        if (cursor == limit) {
+            throw std::logic_error("Instruction is larger than its computed size");
+        }
+        *cursor++ = value;
+    }
+
+    void emitUI32(uint32_t value);
+    void emitI32(int32_t value);
+    void emitUI16(uint16_t value);
+    void emitI16(int16_t value);
+    void emitI8(int8_t value);
+    void emitUI8(uint8_t value);
+    void emitF32(float value);
+    void emitString(const std::string& str);
+    void emitType(Type type);
+
+    private:
+    uint8_t* cursor;
+    uint8_t* limit;
+};
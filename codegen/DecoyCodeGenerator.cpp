@@ -1,136 +1,360 @@
 #include "DecoyCodeGenerator.hpp"
+#include "DecoyWorkRanges.hpp"
+
+#include <algorithm>
+
+namespace {
+    // Calls visit(delay, event) for every record of the timeline a run of literal pk, rk, mvm
+    // and dl plays: each event with the delays before it summed, and a final wait (null event)
+    // for trailing delays. A delay too long for one record gets a wait of its own.
+    template <typename Visit>
+    void forEachTimelineRecord(const std::vector<InstructionNode>& ast, size_t begin, size_t end, Visit visit) {
+        uint64_t delay = 0;
+        bool waiting = false;
+        for (size_t i = begin; i < end; i++) {
+            if (ast[i].instruction.value == "dl") {
+                uint64_t milliseconds = std::stoul(ast[i].operands[0].value);
+                if (delay + milliseconds > UINT32_MAX) {
+                    visit(static_cast<uint32_t>(delay), nullptr);
+                    delay = 0;
+                }
+                delay += milliseconds;
+                waiting = true;
+            } else {
+                visit(static_cast<uint32_t>(delay), &ast[i]);
+                delay = 0;
+                waiting = false;
+            }
+        }
+        if (waiting) {
+            visit(static_cast<uint32_t>(delay), nullptr);
+        }
+    }
+}
 
 std::vector<uint8_t> CodeGenerator::generate(const std::vector<InstructionNode>& ast) {
-    bytecode.clear();
+    std::vector<uint8_t> bytecode;
+    generate(ast, bytecode);
+    return bytecode;
+}
+
+void CodeGenerator::generate(const std::vector<InstructionNode>& ast, std::vector<uint8_t>& bytecode) {
+    buildLayout(ast);
 
-    buildLabelMap(ast);
+    // Every instruction's address is known, so each range writes its own slice of the buffer
+    bytecode.assign(addresses.back(), 0);
+    WorkRanges ranges(ast.size(), threads, MIN_RANGE_SIZE);
+    ranges.run([&](size_t range) {
+        for (size_t i = ranges.begin(range); i < ranges.end(range); i++) {
+            const Batch* batch = batchAt(i);
+            if (batch && i != batch->begin) continue;
 
-    for (const auto& node : ast) {
-        generateInstruction(node);
+            BytecodeWriter out(bytecode.data() + addresses[i], bytecode.data() + addresses[batch ? batch->end : i + 1]);
+            if (batch) {
+                emitBatch(ast, *batch, out);
+            } else {
+                generateInstruction(ast[i], out);
+            }
+            if (!out.isAtEnd()) {
+                throw std::logic_error("Instruction is smaller than its computed size");
+            }
+        }
+    });
+
+    if (lineTable) {
+        for (size_t i = 0; i < ast.size(); i++) {
+            const Batch* batch = batchAt(i);
+            if (batch && i != batch->begin) continue;
+            lineTable->add(addresses[i], ast[i].instruction.line, ast[i].instruction.column);
+        }
     }
+}
 
-    return bytecode;
+void CodeGenerator::buildLayout(const std::vector<InstructionNode>& ast) {
+    findBatches(ast);
+
+    WorkRanges ranges(ast.size(), threads, MIN_RANGE_SIZE);
+    std::vector<size_t> rangeSizes(ranges.size(), 0);
+
+    // Size every instruction, then prefix-sum sizes into addresses: first within each range,
+    // then across ranges once every range total is known
+    addresses.assign(ast.size() + 1, 0);
+    ranges.run([&](size_t range) {
+        size_t address = 0;
+        for (size_t i = ranges.begin(range); i < ranges.end(range); i++) {
+            addresses[i] = address;
+            address += sizeAt(ast, i);
+        }
+        rangeSizes[range] = address;
+    });
+
+    std::vector<size_t> rangeStarts(ranges.size(), 0);
+    for (size_t range = 1; range < ranges.size(); range++) {
+        rangeStarts[range] = rangeStarts[range - 1] + rangeSizes[range - 1];
+    }
+    addresses.back() = rangeStarts.back() + rangeSizes.back();
+
+    ranges.run([&](size_t range) {
+        for (size_t i = ranges.begin(range); i < ranges.end(range); i++) {
+            addresses[i] += rangeStarts[range];
+        }
+    });
+
+    // A generator may be reused, and a stale label must never resolve in the next program
+    labelAddresses.clear();
+    for (size_t i = 0; i < ast.size(); i++) {
+        if (ast[i].instruction.value == "dfp") {
+            labelAddresses[ast[i].operands[0].value] = addresses[i];
+        }
+    }
+}
+
+std::vector<size_t> CodeGenerator::computeAddresses(const std::vector<InstructionNode>& ast) {
+    buildLayout(ast);
+    return { addresses.begin(), addresses.end() - 1 };
+}
+
+void CodeGenerator::findBatches(const std::vector<InstructionNode>& ast) {
+    batches.clear();
+    batchOf.clear();
+    if (!inputBatching) return;
+
+    batchOf.assign(ast.size(), NO_BATCH);
+    for (size_t i = 0; i < ast.size(); i++) {
+        size_t end = i;
+        while (end < ast.size() && isBatchable(ast[end])) end++;
+        if (end - i < 2) continue;
+
+        // Untimed key presses and releases go out as key batches, which a device can send at
+        // once; anything with delays or mouse movement becomes one timeline
+        bool keysOnly = std::all_of(ast.begin() + i, ast.begin() + end, [](const InstructionNode& node) {
+            return node.instruction.value == "pk" || node.instruction.value == "rk";
+        });
+        bool hasEvent = std::any_of(ast.begin() + i, ast.begin() + end, [](const InstructionNode& node) {
+            return node.instruction.value != "dl";
+        });
+
+        if (keysOnly) {
+            for (size_t begin = i; begin < end;) {
+                size_t same = begin + 1;
+                while (same < end && same - begin < MAX_KEY_BATCH && ast[same].instruction.value == ast[begin].instruction.value) same++;
+                if (same - begin >= 2) {
+                    addBatch(ast, begin, same, ast[begin].instruction.value == "pk" ? Instruction::PKB : Instruction::RKB);
+                }
+                begin = same;
+            }
+        } else if (hasEvent) {
+            addBatch(ast, i, end, Instruction::TL);
+        }
+        i = end - 1;
+    }
+}
+
+void CodeGenerator::addBatch(const std::vector<InstructionNode>& ast, size_t begin, size_t end, Instruction opcode) {
+    Batch batch{ .begin = begin, .end = end, .opcode = opcode, .records = 0, .size = 0 };
+
+    if (opcode == Instruction::TL) {
+        // [opcode][4-byte count], then per record [4-byte delay][1-byte opcode] and the event's operands
+        batch.size = 1 + 4;
+        forEachTimelineRecord(ast, begin, end, [&](uint32_t, const InstructionNode* event) {
+            batch.records++;
+            batch.size += 4 + 1;
+            if (event) batch.size += event->instruction.value == "mvm" ? 4 + 4 : 1;
+        });
+    } else {
+        // [opcode][1-byte count][1-byte key]...
+        batch.records = end - begin;
+        batch.size = 1 + 1 + batch.records;
+    }
+
+    for (size_t i = begin; i < end; i++) {
+        batchOf[i] = batches.size();
+    }
+    batches.push_back(batch);
+}
+
+const CodeGenerator::Batch* CodeGenerator::batchAt(size_t index) const {
+    if (batchOf.empty() || batchOf[index] == NO_BATCH) return nullptr;
+    return &batches[batchOf[index]];
 }
 
-void CodeGenerator::buildLabelMap(const std::vector<InstructionNode>& ast) {
-    size_t address = 0;
+size_t CodeGenerator::sizeAt(const std::vector<InstructionNode>& ast, size_t index) {
+    const Batch* batch = batchAt(index);
+    if (!batch) return calculateInstructionSize(ast[index]);
+    return index + 1 == batch->end ? batch->size : 0;
+}
+
+void CodeGenerator::emitBatch(const std::vector<InstructionNode>& ast, const Batch& batch, BytecodeWriter& out) {
+    out.emitByte(static_cast<uint8_t>(batch.opcode));
 
-    for (const auto& node : ast) {
-        if (node.instruction.value == "dfp") {
-            labelAddresses[node.operands[0].value] = address;
+    if (batch.opcode != Instruction::TL) {
+        out.emitUI8(static_cast<uint8_t>(batch.records));
+        for (size_t i = batch.begin; i < batch.end; i++) {
+            out.emitUI8(std::stoul(ast[i].operands[0].value));
         }
-        address += calculateInstructionSize(node);
+        return;
     }
+
+    out.emitUI32(static_cast<uint32_t>(batch.records));
+    forEachTimelineRecord(ast, batch.begin, batch.end, [&](uint32_t delay, const InstructionNode* event) {
+        out.emitUI32(delay);
+        if (!event) {
+            out.emitByte(static_cast<uint8_t>(Instruction::DL));
+        } else if (event->instruction.value == "mvm") {
+            out.emitByte(static_cast<uint8_t>(Instruction::MVM));
+            out.emitI32(std::stol(event->operands[0].value));
+            out.emitI32(std::stol(event->operands[1].value));
+        } else {
+            out.emitByte(static_cast<uint8_t>(event->instruction.value == "pk" ? Instruction::PK : Instruction::RK));
+            out.emitUI8(std::stoul(event->operands[0].value));
+        }
+    });
+}
+
+// Straight-line input with every operand known at compile time
+bool CodeGenerator::isBatchable(const InstructionNode& node) {
+    const std::string& inst = node.instruction.value;
+    if (inst != "pk" && inst != "rk" && inst != "mvm" && inst != "dl") return false;
+    return std::all_of(node.operands.begin(), node.operands.end(),
+        [](const Token& operand) { return operand.type == TokenType::LITERAL; });
 }
 
-void CodeGenerator::generateInstruction(const InstructionNode& node) {
-    auto opcode = instructionToOpcode(node.instruction.value);
-    emitByte(static_cast<uint8_t>(opcode));
+void CodeGenerator::generateInstruction(const InstructionNode& node, BytecodeWriter& out) {
+    auto opcode = opcodeFor(node);
+    out.emitByte(static_cast<uint8_t>(opcode));
 
     const std::string& inst = node.instruction.value;
 
     if (inst == "cv") {
-        // cv var type: [var_name][type]
-        emitString(node.operands[0].value);
-        emitType(symbols.getVariable(node.operands[0].value).type);
+        // cv var type: [var_name][type][var_offset]
+        out.emitString(node.operands[0].value);
+        out.emitType(symbols.getVariable(node.operands[0].value).type);
+        emitVariable(node.operands[0], out);
     }
     else if (inst == "av") {
-        // av var value: [var_offset][value]
-        emitVariable(node.operands[0]);
-        emitOperand(node.operands[1]);
+        // av var value: [var_offset][value], or [register][value] for avr
+        emitTarget(node.operands[0], out);
+        emitOperand(node.operands[1], out);
     }
     else if (inst == "aav" || inst == "sav" || inst == "mav" || 
              inst == "dav" || inst == "moav") {
         // aav var value: [var_offset][value]
-        emitVariable(node.operands[0]);
-        emitOperand(node.operands[1]);
+        emitTarget(node.operands[0], out);
+        emitOperand(node.operands[1], out);
     }
     else if (inst == "inc" || inst == "dec") {
         // inc var: [var_offset]
-        emitVariable(node.operands[0]);
+        emitTarget(node.operands[0], out);
+    }
+    else if (inst == "fill" || inst == "spill") {
+        // fill var: [register][var_offset]
+        emitTarget(node.operands[0], out);
+        emitVariable(node.operands[0], out);
     }
     else if (inst == "p" || inst == "pl") {
-        // p args...: [arg1][arg2]...
+        // p args...: [count][tag][arg1][tag][arg2]...
+        out.emitByte(static_cast<uint8_t>(node.operands.size()));
         for (const auto& operand : node.operands) {
             if (operand.type == TokenType::STRING) {
-                emitString(operand.value);
+                out.emitType(Type::STR);
+                out.emitString(operand.value);
             } else {
-                emitVariable(operand);
+                out.emitType(Type::NT);
+                emitVariable(operand, out);
             }
         }
     }
     else if (inst == "pk" || inst == "rk") {
         // pk value: [value]
-        emitOperand(node.operands[0]);
+        emitOperand(node.operands[0], out);
     }
     else if (inst == "ikd") {
         // ikd key res: [key_offset][res_offset]
-        emitVariable(node.operands[0]);
-        emitVariable(node.operands[1]);
+        emitVariable(node.operands[0], out);
+        emitVariable(node.operands[1], out);
     }
     else if (inst == "mvm") {
         // mvm x y: [x][y]
-        emitOperand(node.operands[0]);
-        emitOperand(node.operands[1]);
+        emitOperand(node.operands[0], out);
+        emitOperand(node.operands[1], out);
     }
     else if (inst == "dfp") {
         // dfp label: (no code, handled in label map)
     }
-    else if (inst == "jmp") {
+    else if (inst == "jmp" || inst == "call") {
         // jmp label: [address]
-        emitLabel(node.operands[0]);
+        emitLabel(node.operands[0], out);
     }
     else if (inst == "cejmp" || inst == "cgjmp" || inst == "cljmp" ||
              inst == "cegjmp" || inst == "celjmp") {
-        // cejmp a b t f: [a_offset][b_offset][t_addr][f_addr]
-        emitVariable(node.operands[0]);
-        emitVariable(node.operands[1]);
-        emitLabel(node.operands[2]);
-        emitLabel(node.operands[3]);
+        // cejmp a b t f: [a_offset][b_offset][t_addr][f_addr]; cejmpr takes two values instead
+        if (opcode != instructionToOpcode(inst)) {
+            emitOperand(node.operands[0], out);
+            emitOperand(node.operands[1], out);
+        } else {
+            emitVariable(node.operands[0], out);
+            emitVariable(node.operands[1], out);
+        }
+        emitLabel(node.operands[2], out);
+        emitLabel(node.operands[3], out);
     }
     else if (inst == "dl") {
         // dl duration: [duration]
-        emitOperand(node.operands[0]);
+        emitOperand(node.operands[0], out);
     }
-    else if (inst == "nop") {
+    else if (inst == "nop" || inst == "ret") {
         // nop: no operands
     }
 }
 
-void CodeGenerator::emitOperand(const Token& operand) {
+void CodeGenerator::emitOperand(const Token& operand, BytecodeWriter& out) {
     if (operand.type == TokenType::LITERAL) {
-        emitLiteral(operand.value, inferLiteralType(operand.value));
+        emitLiteral(operand.value, inferLiteralType(operand.value), out);
     } else if (operand.type == TokenType::IDENTIFIER) {
-        if (symbols.isVariable(operand.value)) {
-            emitVariable(operand);
+        if (inRegister(operand)) {
+            out.emitByte(REGISTER_TAG);
+            out.emitByte(registers->at(operand.value));
+        } else if (symbols.isVariable(operand.value)) {
+            // NT in the type slot marks a variable reference
+            out.emitType(Type::NT);
+            emitVariable(operand, out);
         } else {
-            emitLabel(operand);
+            emitLabel(operand, out);
         }
     }
 }
 
-void CodeGenerator::emitLiteral(const std::string& value, Type type) {
-    emitByte(static_cast<uint8_t>(type));
+void CodeGenerator::emitLiteral(const std::string& value, Type type, BytecodeWriter& out) {
+    out.emitByte(static_cast<uint8_t>(type));
     switch (type) {
-        case Type::I8: emitI8(std::stoi(value)); break;
-        case Type::UI8: emitUI8(std::stoul(value)); break;
-        case Type::I16: emitI16(std::stoi(value)); break;
-        case Type::UI16: emitUI16(std::stoul(value)); break;
-        case Type::I32: emitI32(std::stol(value)); break;
-        case Type::UI32: emitUI32(std::stoul(value)); break;
-        case Type::F32: emitF32(std::stof(value)); break;
+        case Type::I8: out.emitI8(std::stoi(value)); break;
+        case Type::UI8: out.emitUI8(std::stoul(value)); break;
+        case Type::I16: out.emitI16(std::stoi(value)); break;
+        case Type::UI16: out.emitUI16(std::stoul(value)); break;
+        case Type::I32: out.emitI32(std::stol(value)); break;
+        case Type::UI32: out.emitUI32(std::stoul(value)); break;
+        case Type::F32: out.emitF32(std::stof(value)); break;
         default: throw std::runtime_error("Unsupported literal type");
     }
 }
 
-void CodeGenerator::emitVariable(const Token& varToken) {
+void CodeGenerator::emitVariable(const Token& varToken, BytecodeWriter& out) {
     const auto& var = symbols.getVariable(varToken.value);
-    emitUI32(var.offset);
+    out.emitUI32(var.offset);
+}
+
+// The variable an instruction writes: its register when it has one, else its offset
+void CodeGenerator::emitTarget(const Token& varToken, BytecodeWriter& out) {
+    if (inRegister(varToken)) {
+        out.emitByte(registers->at(varToken.value));
+    } else {
+        emitVariable(varToken, out);
+    }
 }
 
-void CodeGenerator::emitLabel(const Token& labelToken) {
+void CodeGenerator::emitLabel(const Token& labelToken, BytecodeWriter& out) {
     size_t address = labelAddresses.at(labelToken.value);
-    emitUI32(static_cast<uint32_t>(address));
+    out.emitUI32(static_cast<uint32_t>(address));
 }
 
 Type CodeGenerator::inferLiteralType(const std::string& literal) {
@@ -139,73 +363,32 @@ Type CodeGenerator::inferLiteralType(const std::string& literal) {
     return Type::UI32;
 }
 
-void CodeGenerator::emitByte(uint8_t value) {
-    bytecode.push_back(value);
-}
-
-void CodeGenerator::emitUI32(uint32_t value) {
-    for (int i = 0; i < 4; i++) {
-        emitByte((value >> (8 * i)) & 0xFF);
-    }
-}
-
-void CodeGenerator::emitI32(int32_t value) {
-    emitUI32(value);
-}
-
-void CodeGenerator::emitUI16(uint16_t value) {
-    emitByte(static_cast<uint8_t>(value & 0xFF));
-    emitByte(static_cast<uint8_t>((value >> 8) & 0xFF));
-}
-
-void CodeGenerator::emitI16(int16_t value) {
-    emitUI16(static_cast<uint16_t>(value));
-}
-
-void CodeGenerator::emitI8(int8_t value) {
-    emitUI8(static_cast<uint8_t>(value));
-}
-
-void CodeGenerator::emitUI8(uint8_t value) {
-    emitByte(value);
-}
-
-void CodeGenerator::emitF32(float value) {
-    uint32_t binary;
-    memcpy(&binary, &value, sizeof(float));
-    emitUI32(binary);
-}
-
-void CodeGenerator::emitString(const std::string& str) {
-    emitUI32(str.size());
-    for (char c : str) emitByte(static_cast<uint8_t>(c));
-}
-
-void CodeGenerator::emitType(Type type) {
-    emitByte(static_cast<uint8_t>(type));
-}
-
 size_t CodeGenerator::calculateInstructionSize(const InstructionNode& node) {
     const std::string& inst = node.instruction.value;
     size_t size = 1; // Opcode
 
     if (inst == "cv") {
-        // [4-byte len][name][1-byte type]
-        size += 4 + node.operands[0].value.size() + 1;
+        // [4-byte len][name][1-byte type][4-byte offset]
+        size += 4 + node.operands[0].value.size() + 1 + 4;
     }
     else if (inst == "av" || inst == "aav" || inst == "sav" || 
              inst == "mav" || inst == "dav" || inst == "moav") {
         // [4-byte var][operand]
-        size += 4 + operandSize(node.operands[1]);
+        size += targetSize(node.operands[0]) + operandSize(node.operands[1]);
              }
     else if (inst == "inc" || inst == "dec") {
         // [4-byte var]
-        size += 4;
+        size += targetSize(node.operands[0]);
+    }
+    else if (inst == "fill" || inst == "spill") {
+        size += 1 + 4; // Register, variable
     }
     else if (inst == "p" || inst == "pl") {
+        // [1-byte count] then [1-byte tag] per operand
+        size += 1;
         for (const auto& operand : node.operands) {
-            size += (operand.type == TokenType::STRING) ? 
-                (4 + operand.value.size()) : 4;
+            size += 1 + ((operand.type == TokenType::STRING) ? 
+                (4 + operand.value.size()) : 4);
         }
     }
     else if (inst == "pk" || inst == "rk" || inst == "dl") {
@@ -217,49 +400,38 @@ size_t CodeGenerator::calculateInstructionSize(const InstructionNode& node) {
     else if (inst == "mvm") {
         size += operandSize(node.operands[0]) + operandSize(node.operands[1]);
     }
-    else if (inst == "jmp") {
+    else if (inst == "jmp" || inst == "call") {
         size += 4; // Address
     }
     else if (inst == "cejmp" || inst == "cgjmp" || inst == "cljmp" ||
              inst == "cegjmp" || inst == "celjmp") {
-        size += 4 + 4 + 4 + 4; // Two vars, two addresses
+        if (inRegister(node.operands[0]) || inRegister(node.operands[1])) {
+            size += operandSize(node.operands[0]) + operandSize(node.operands[1]) + 4 + 4; // Two values, two addresses
+        } else {
+            size += 4 + 4 + 4 + 4; // Two vars, two addresses
+        }
              }
     // nop: no size addition
 
     return size;
 }
 
+// Instructions on a variable held in a register use its register form; a conditional jump
+// needs it when either operand is in one
+Instruction CodeGenerator::opcodeFor(const InstructionNode& node) {
+    Instruction opcode = instructionToOpcode(node.instruction.value);
+    Instruction form = registerForm(opcode);
+    if (!registers || form == opcode) return opcode;
+
+    // Of the instructions with a register form, only the conditional jumps take four operands
+    bool pinned = inRegister(node.operands[0]) || (node.operands.size() == 4 && inRegister(node.operands[1]));
+    return pinned ? form : opcode;
+}
+
 Instruction CodeGenerator::instructionToOpcode(const std::string& inst) {
-    static const std::unordered_map<std::string, Instruction> opcodeMap = {
-        {"cv", Instruction::CV},
-        {"av", Instruction::AV},
-        {"aav", Instruction::AAV},
-        {"sav", Instruction::SAV},
-        {"mav", Instruction::MAV},
-        {"dav", Instruction::DAV},
-        {"moav", Instruction::MOAV},
-        {"inc", Instruction::INC},
-        {"dec", Instruction::DEC},
-        {"p", Instruction::P},
-        {"pl", Instruction::PL},
-        {"pk", Instruction::PK},
-        {"rk", Instruction::RK},
-        {"ikd", Instruction::IKD},
-        {"mvm", Instruction::MVM},
-        {"dfp", Instruction::DFP},
-        {"jmp", Instruction::JMP},
-        {"cejmp", Instruction::CEJMP},
-        {"cgjmp", Instruction::CGJMP},
-        {"cljmp", Instruction::CLJMP},
-        {"cegjmp", Instruction::CEGJMP},
-        {"celjmp", Instruction::CELJMP},
-        {"dl", Instruction::DL},
-        {"nop", Instruction::NOP}
-    };
-
-    auto it = opcodeMap.find(inst);
-    if (it == opcodeMap.end()) {
+    const InstructionInfo* info = findInstructionInfo(inst);
+    if (!info) {
         throw std::runtime_error("Unknown instruction: " + inst);
     }
-    return it->second;
+    return info->opcode;
 }
\ No newline at end of file
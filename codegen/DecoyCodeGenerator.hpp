@@ -3,6 +3,8 @@
 #include <vector>
 
 #include "DecoySymbolTable.hpp"
+#include "DecoyLineTable.hpp"
+#include "DecoyBytecode.hpp"
 
 class CodeGenerator {
     public:
@@ -11,40 +13,91 @@ class CodeGenerator {
 
     std::vector<uint8_t> generate(const std::vector<InstructionNode>& ast);
 
+    // Replaces the contents of bytecode, reusing its capacity
+    void generate(const std::vector<InstructionNode>& ast, std::vector<uint8_t>& bytecode);
+
+    // Forgets the last program's layout and labels; allocations are kept for the next one
+    void reset() { addresses.clear(); labelAddresses.clear(); batches.clear(); batchOf.clear(); }
+
+    // Records the source position of every emitted instruction while generating
+    void setLineTable(LineTable* table) { lineTable = table; }
+
+    // Instructions are sized, addressed and emitted across this many threads (output is identical)
+    void setThreads(size_t count) { threads = count; }
+
+    // Emits runs of pk, rk, mvm and dl with literal operands as one instruction: consecutive
+    // pk or rk become pkb or rkb, and anything mixed, or timed with dl, becomes a tl timeline
+    void setInputBatching(bool enabled) { inputBatching = enabled; }
+
+    // Variables held in VM registers (see RegisterAllocator): instructions on them use the
+    // register forms and register operands. Null keeps every variable in memory.
+    void setRegisters(const std::unordered_map<std::string, uint8_t>* assignments) { registers = assignments; }
+
+    static Type inferLiteralType(const std::string& literal);
+
+    // Address each instruction would be emitted at, without emitting anything
+    std::vector<size_t> computeAddresses(const std::vector<InstructionNode>& ast);
+
     private:
+    // Ranges smaller than this are not worth a thread
+    static constexpr size_t MIN_RANGE_SIZE = 16384;
+
+    static constexpr size_t NO_BATCH = static_cast<size_t>(-1);
+    static constexpr size_t MAX_KEY_BATCH = 255; // The key count is one byte
+
+    // A run of instructions emitted as one pkb, rkb or tl. It is emitted at the address of its
+    // first instruction and sized on its last, so every instruction of the run shares that
+    // address and per-instruction addresses (profiles, line tables) still line up.
+    struct Batch {
+        size_t begin;
+        size_t end;
+        Instruction opcode;
+        size_t records; // Keys or timeline records
+        size_t size;
+    };
+
     const SymbolTable& symbols;
-    std::vector<uint8_t> bytecode;
+    std::vector<size_t> addresses; // Per instruction, plus the end address
     std::unordered_map<std::string, size_t> labelAddresses;
+    LineTable* lineTable = nullptr;
+    size_t threads = 1;
+    bool inputBatching = false;
+    const std::unordered_map<std::string, uint8_t>* registers = nullptr;
+    std::vector<Batch> batches;
+    std::vector<size_t> batchOf; // Per instruction, NO_BATCH outside any batch; empty without batching
 
-    void buildLabelMap(const std::vector<InstructionNode>& ast);
+    void buildLayout(const std::vector<InstructionNode>& ast);
 
-    void generateInstruction(const InstructionNode& node);
+    void findBatches(const std::vector<InstructionNode>& ast);
+    void addBatch(const std::vector<InstructionNode>& ast, size_t begin, size_t end, Instruction opcode);
+    const Batch* batchAt(size_t index) const;
+    size_t sizeAt(const std::vector<InstructionNode>& ast, size_t index);
+    void emitBatch(const std::vector<InstructionNode>& ast, const Batch& batch, BytecodeWriter& out);
+    static bool isBatchable(const InstructionNode& node);
 
-    void emitOperand(const Token& operand);
-    void emitLiteral(const std::string& value, Type type);
-    void emitVariable(const Token& varToken);
-    void emitLabel(const Token& labelToken);
+    void generateInstruction(const InstructionNode& node, BytecodeWriter& out);
 
-    Type inferLiteralType(const std::string& literal);
+    void emitOperand(const Token& operand, BytecodeWriter& out);
+    void emitLiteral(const std::string& value, Type type, BytecodeWriter& out);
+    void emitVariable(const Token& varToken, BytecodeWriter& out);
+    void emitLabel(const Token& labelToken, BytecodeWriter& out);
+    void emitTarget(const Token& varToken, BytecodeWriter& out);
 
-    void emitByte(uint8_t value);
-    void emitUI32(uint32_t value);
-    void emitI32(int32_t value);
-    void emitUI16(uint16_t value);
-    void emitI16(int16_t value);
-    void emitI8(int8_t value);
-    void emitUI8(uint8_t value);
-    void emitF32(float value);
-    void emitString(const std::string& str);
-    void emitType(Type type);
+    bool inRegister(const Token& operand) const;
+    Instruction opcodeFor(const InstructionNode& node);
 
     size_t calculateInstructionSize(const InstructionNode& node);
 
     Instruction instructionToOpcode(const std::string& inst);
 
     size_t operandSize(const Token& operand);
+    size_t targetSize(const Token& varToken) const { return inRegister(varToken) ? 1 : 4; }
 };
 
+inline bool CodeGenerator::inRegister(const Token& operand) const {
+    return registers && operand.type == TokenType::IDENTIFIER && registers->contains(operand.value);
+}
+
 inline size_t CodeGenerator::operandSize(const Token& operand) {
     if (operand.type == TokenType::LITERAL) {
         Type type = inferLiteralType(operand.value);
@@ -55,5 +108,6 @@ inline size_t CodeGenerator::operandSize(const Token& operand) {
             default: throw std::runtime_error("Invalid literal type");
         }
     }
-    return 4; // Variable reference
+    if (inRegister(operand)) return 1 + 1; // Register tag + register
+    return 1 + 4; // NT tag + variable reference
 }
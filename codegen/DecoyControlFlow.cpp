@@ -0,0 +1,142 @@
+#include "DecoyControlFlow.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+ControlFlowGraph::ControlFlowGraph(const std::vector<InstructionNode>& ast) {
+    instructionBlocks.resize(ast.size());
+
+    for (size_t i = 0; i < ast.size(); i++) {
+        bool leader = i == 0 || ast[i].instruction.value == "dfp" || isJump(ast[i - 1]) || ast[i - 1].instruction.value == "ret";
+        if (leader) {
+            blocks.push_back({ .begin = i, .end = i, .successors = {}, .fallsThrough = false });
+        }
+
+        blocks.back().end = i + 1;
+        instructionBlocks[i] = blocks.size() - 1;
+
+        if (ast[i].instruction.value == "dfp") {
+            labelBlocks[ast[i].operands[0].value] = blocks.size() - 1;
+        }
+    }
+
+    for (size_t b = 0; b < blocks.size(); b++) {
+        auto& block = blocks[b];
+        const auto& last = ast[block.end - 1];
+
+        if (last.instruction.value == "jmp") {
+            block.successors.push_back(blockOfLabel(last.operands[0].value));
+        } else if (isConditionalJump(last)) {
+            block.successors.push_back(blockOfLabel(last.operands[2].value));
+            block.successors.push_back(blockOfLabel(last.operands[3].value));
+        } else if (last.instruction.value == "ret") {
+            block.successors.push_back(exitBlock());
+        } else {
+            block.fallsThrough = true;
+            block.successors.push_back(b + 1);
+        }
+
+        for (size_t i = block.begin; i < block.end; i++) {
+            if (isCall(ast[i])) block.successors.push_back(blockOfLabel(ast[i].operands[0].value));
+        }
+    }
+}
+
+size_t ControlFlowGraph::blockOfLabel(const std::string& label) const {
+    auto it = labelBlocks.find(label);
+    if (it == labelBlocks.end()) {
+        throw std::runtime_error("Undefined label '" + label + "'");
+    }
+    return it->second;
+}
+
+size_t ControlFlowGraph::blockOfInstruction(size_t index) const {
+    return instructionBlocks.at(index);
+}
+
+// Loops are found from the back edges of a depth-first search from the entry block. A loop's
+// body is everything that reaches one of its back edges without passing through its header.
+// Reverse postorder puts the header first and every other edge inside the body forward, so a
+// body edge whose target comes no later than its source in blocks is a back edge.
+std::vector<Loop> ControlFlowGraph::findLoops() const {
+    enum : char { UNVISITED, ACTIVE, DONE };
+
+    std::vector<char> state(blocks.size(), UNVISITED);
+    std::vector<std::vector<size_t>> latches(blocks.size());
+    std::vector<size_t> postorder;
+    std::vector<std::pair<size_t, size_t>> path; // Block, next successor to visit
+
+    if (!blocks.empty()) {
+        path.push_back({ 0, 0 });
+        state[0] = ACTIVE;
+    }
+    while (!path.empty()) {
+        auto& [block, next] = path.back();
+        const auto& successors = blocks[block].successors;
+        if (next == successors.size()) {
+            state[block] = DONE;
+            postorder.push_back(block);
+            path.pop_back();
+            continue;
+        }
+
+        size_t successor = successors[next++];
+        if (successor == exitBlock()) continue;
+
+        if (state[successor] == ACTIVE) {
+            latches[successor].push_back(block);
+        } else if (state[successor] == UNVISITED) {
+            state[successor] = ACTIVE;
+            path.push_back({ successor, 0 });
+        }
+    }
+
+    std::vector<size_t> rpoIndex(blocks.size(), 0);
+    for (size_t k = 0; k < postorder.size(); k++) {
+        rpoIndex[postorder[k]] = postorder.size() - 1 - k;
+    }
+
+    std::vector<std::vector<size_t>> predecessors(blocks.size());
+    for (size_t b = 0; b < blocks.size(); b++) {
+        if (state[b] == UNVISITED) continue;
+        for (size_t successor : blocks[b].successors) {
+            if (successor != exitBlock()) predecessors[successor].push_back(b);
+        }
+    }
+
+    std::vector<Loop> loops;
+    std::vector<char> inBody(blocks.size(), false);
+    for (size_t header = 0; header < blocks.size(); header++) {
+        if (latches[header].empty()) continue;
+
+        Loop loop{ .header = header, .latches = latches[header], .blocks = { header } };
+        inBody[header] = true;
+
+        std::vector<size_t> work = latches[header];
+        while (!work.empty()) {
+            size_t block = work.back();
+            work.pop_back();
+            if (inBody[block]) continue;
+            inBody[block] = true;
+            loop.blocks.push_back(block);
+            for (size_t predecessor : predecessors[block]) {
+                if (!inBody[predecessor]) work.push_back(predecessor);
+            }
+        }
+
+        for (size_t block : loop.blocks) inBody[block] = false;
+        std::sort(loop.blocks.begin(), loop.blocks.end(), [&](size_t a, size_t b) { return rpoIndex[a] < rpoIndex[b]; });
+        loops.push_back(std::move(loop));
+    }
+
+    return loops;
+}
+
+bool ControlFlowGraph::isJump(const InstructionNode& node) {
+    return node.instruction.value == "jmp" || isConditionalJump(node);
+}
+
+bool ControlFlowGraph::isConditionalJump(const InstructionNode& node) {
+    const std::string& inst = node.instruction.value;
+    return inst == "cejmp" || inst == "cgjmp" || inst == "cljmp" || inst == "cegjmp" || inst == "celjmp";
+}
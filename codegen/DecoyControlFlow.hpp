@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../parser/DecoyParser.hpp"
+
+struct BasicBlock {
+    size_t begin; // First instruction (index into the program)
+    size_t end; // One past the last instruction
+    std::vector<size_t> successors; // Block indices; exitBlock() when control leaves the program
+    bool fallsThrough; // Last instruction continues into the next block in source order
+};
+
+struct Loop {
+    size_t header;
+    std::vector<size_t> latches; // Blocks jumping back to the header
+    std::vector<size_t> blocks; // The header and the rest of the body, in reverse postorder
+};
+
+// Basic blocks of a parsed program. A block starts at the first instruction,
+// at every dfp and after every jump or ret; conditional jumps name both targets,
+// so only blocks that do not end in a jump or ret fall through.
+//
+// A call does not end its block: control comes back right after it. The called
+// label is an extra successor of the block making the call, and a ret leaves
+// for exitBlock(), as the graph does not track where a subroutine returns to.
+class ControlFlowGraph {
+    public:
+    explicit ControlFlowGraph(const std::vector<InstructionNode>& ast);
+
+    const std::vector<BasicBlock>& getBlocks() const { return blocks; }
+    size_t exitBlock() const { return blocks.size(); }
+
+    size_t blockOfLabel(const std::string& label) const;
+    size_t blockOfInstruction(size_t index) const;
+
+    // Loops among the blocks reachable from the entry, by header in source order
+    std::vector<Loop> findLoops() const;
+
+    static bool isJump(const InstructionNode& node);
+    static bool isConditionalJump(const InstructionNode& node);
+    static bool isCall(const InstructionNode& node) { return node.instruction.value == "call"; }
+
+    private:
+    std::vector<BasicBlock> blocks;
+    std::vector<size_t> instructionBlocks;
+    std::unordered_map<std::string, size_t> labelBlocks;
+};
@@ -0,0 +1,77 @@
+#include "DecoyCostModel.hpp"
+#include "DecoyBytecode.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+CostModel::CostModel() {
+    for (auto opcode : { Instruction::AV, Instruction::AAV, Instruction::SAV, Instruction::MAV, Instruction::DAV,
+             Instruction::MOAV, Instruction::INC, Instruction::DEC, Instruction::JMP, Instruction::CEJMP,
+             Instruction::CGJMP, Instruction::CLJMP, Instruction::CEGJMP, Instruction::CELJMP,
+             Instruction::CALL, Instruction::RET }) {
+        set(opcode, 10);
+        set(registerForm(opcode), 8);
+    }
+    set(Instruction::FILL, 10);
+    set(Instruction::SPILL, 10);
+    set(Instruction::CV, 5);
+    set(Instruction::DFP, 5);
+    set(Instruction::NOP, 5);
+    set(Instruction::DL, 50);
+    set(Instruction::IKD, 500);
+    set(Instruction::PK, 1000);
+    set(Instruction::RK, 1000);
+    set(Instruction::MVM, 1000);
+    set(Instruction::PKB, 1000);
+    set(Instruction::RKB, 1000);
+    set(Instruction::TL, 1000);
+    set(Instruction::P, 2000);
+    set(Instruction::PL, 2000);
+}
+
+CostModel CostModel::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open cost model: " + path);
+    }
+
+    CostModel model;
+    std::string text;
+    size_t lineNumber = 0;
+
+    while (std::getline(file, text)) {
+        lineNumber++;
+        text = text.substr(0, text.find('#'));
+
+        std::istringstream record(text);
+        std::string mnemonic;
+        if (!(record >> mnemonic)) continue;
+
+        double nanoseconds = 0;
+        const InstructionInfo* info = findInstructionInfo(mnemonic);
+        if (!info || !(record >> nanoseconds) || nanoseconds < 0) {
+            throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": expected '<mnemonic> <nanoseconds>'");
+        }
+        model.set(info->opcode, nanoseconds);
+    }
+
+    return model;
+}
+
+void CostModel::save(std::ostream& out) const {
+    out << "# Nanoseconds per execution of each opcode; dl also waits its operand\n";
+    for (size_t opcode = 0; opcode < costs.size(); opcode++) {
+        if (const InstructionInfo* info = findInstructionInfo(static_cast<uint8_t>(opcode))) {
+            out << info->mnemonic << ' ' << costs[opcode] << '\n';
+        }
+    }
+}
+
+void CostModel::calibrate(const std::array<uint64_t, 256>& counts, const std::array<uint64_t, 256>& nanoseconds) {
+    for (size_t opcode = 0; opcode < costs.size(); opcode++) {
+        if (counts[opcode] != 0) {
+            costs[opcode] = static_cast<double>(nanoseconds[opcode]) / counts[opcode];
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "../parser/DecoyParser.hpp"
+
+// Estimated time one execution of each opcode takes, for estimateTiming.
+//
+// File format (one record per line, '#' starts a comment):
+//   <mnemonic> <nanoseconds>   e.g. "pk 1500"
+//
+// Opcodes a file leaves out keep their defaults. Delays are not part of the model: a dl costs
+// its own entry plus the milliseconds it waits. DecoyRunner --calibrate writes this format
+// from measured runs.
+class CostModel {
+    public:
+    // Rough figures for the reference VM on a desktop: a few nanoseconds of dispatch for most
+    // opcodes, microseconds for calls into the input device and the console
+    CostModel();
+
+    static CostModel load(const std::string& path);
+    void save(std::ostream& out) const;
+
+    double nanoseconds(Instruction opcode) const { return costs[static_cast<uint8_t>(opcode)]; }
+    void set(Instruction opcode, double nanoseconds) { costs[static_cast<uint8_t>(opcode)] = nanoseconds; }
+
+    // Replaces the cost of every opcode that ran with its measured average
+    void calibrate(const std::array<uint64_t, 256>& counts, const std::array<uint64_t, 256>& nanoseconds);
+
+    private:
+    std::array<double, 256> costs{};
+};
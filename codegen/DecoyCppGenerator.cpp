@@ -0,0 +1,337 @@
+#include "DecoyCppGenerator.hpp"
+#include "DecoyCodeGenerator.hpp"
+
+#include "../DecoyDefs.hpp"
+
+#include <cctype>
+#include <iomanip>
+#include <unordered_set>
+
+std::string CppGenerator::generate(const std::vector<InstructionNode>& ast, const std::string& unitName) {
+    out.str("");
+    out.clear();
+
+    generatePrelude();
+
+    out << "DecoyRunResult " << entryPointName(unitName) << "(const DecoyHost& host, uint64_t maxSteps) {\n";
+    out << "    uint64_t steps = 0;\n";
+
+    // Locals in declaration order, zeroed like VM memory
+    for (const auto& node : ast) {
+        if (node.instruction.value == "cv") {
+            const auto& var = symbols.getVariable(node.operands[0].value);
+            out << "    " << cppType(var.type) << ' ' << variableName(node.operands[0].value) << " = 0;\n";
+        }
+    }
+
+    std::unordered_set<std::string> referencedLabels;
+    bool subroutines = false;
+    callSites = nextCallSite = 0;
+    for (const auto& node : ast) {
+        const std::string& inst = node.instruction.value;
+        subroutines = subroutines || inst == "call" || inst == "ret";
+        if (inst == "call") callSites++;
+        if (inst == "jmp" || inst == "call") {
+            referencedLabels.insert(node.operands[0].value);
+        } else if (inst == "cejmp" || inst == "cgjmp" || inst == "cljmp" || inst == "cegjmp" || inst == "celjmp") {
+            referencedLabels.insert(node.operands[2].value);
+            referencedLabels.insert(node.operands[3].value);
+        }
+    }
+
+    if (subroutines) {
+        out << "    uint32_t callStack[" << MAX_CALL_DEPTH << "];\n";
+        out << "    size_t callDepth = 0;\n";
+    }
+
+    out << "\n#define DECOY_STEP() if (maxSteps != 0 && steps >= maxSteps) return { steps, false, nullptr }; ++steps\n\n";
+
+    for (const auto& node : ast) {
+        out << "    // line " << node.instruction.line << ": " << node.instruction.value;
+        for (const auto& operand : node.operands) {
+            out << ' ' << (operand.type == TokenType::STRING ? "\"...\"" : operand.value);
+        }
+        out << '\n';
+
+        if (node.instruction.value == "dfp" && referencedLabels.contains(node.operands[0].value)) {
+            out << labelName(node.operands[0].value) << ":\n";
+        }
+        out << "    DECOY_STEP();\n";
+        generateInstruction(node);
+    }
+
+    out << "\n#undef DECOY_STEP\n";
+    out << "    return { steps, true, nullptr };\n";
+    out << "}\n";
+
+    return out.str();
+}
+
+std::string CppGenerator::entryPointName(const std::string& unitName) {
+    std::string name = "decoy_";
+    for (char c : unitName) {
+        name += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+    }
+    return name;
+}
+
+void CppGenerator::generatePrelude() {
+    out << "// Generated by " << TITLE << ' ' << COMPILE_TAG << ". Do not edit.\n";
+    out << "#include <cmath>\n";
+    out << "#include <cstddef>\n";
+    out << "#include <cstdint>\n";
+    out << "#include <sstream>\n";
+    out << "#include <string>\n\n";
+
+    out << "#ifndef DECOY_HOST_DEFINED\n";
+    out << "#define DECOY_HOST_DEFINED\n";
+    out << "struct DecoyHost {\n";
+    out << "    void* context;\n";
+    out << "    void (*pressKey)(void* context, uint8_t key);\n";
+    out << "    void (*releaseKey)(void* context, uint8_t key);\n";
+    out << "    bool (*isKeyDown)(void* context, uint8_t key);\n";
+    out << "    void (*moveMouse)(void* context, int32_t x, int32_t y);\n";
+    out << "    void (*print)(void* context, const char* text, size_t length);\n";
+    out << "    void (*delay)(void* context, uint32_t milliseconds);\n";
+    out << "};\n\n";
+    out << "struct DecoyRunResult {\n";
+    out << "    uint64_t steps;\n";
+    out << "    bool finished; // Ran off the end rather than hitting maxSteps\n";
+    out << "    const char* error; // Set when the script faults (e.g. division by zero)\n";
+    out << "};\n";
+    out << "#endif\n\n";
+
+    out << "namespace {\n";
+    out << "    std::string decoyFormat(int64_t value) { return std::to_string(value); }\n";
+    out << "    std::string decoyFormat(float value) { std::ostringstream ss; ss << value; return ss.str(); }\n";
+    out << "}\n\n";
+}
+
+void CppGenerator::generateInstruction(const InstructionNode& node) {
+    const std::string& inst = node.instruction.value;
+
+    if (inst == "av") {
+        generateAssignment(node);
+    }
+    else if (inst == "aav" || inst == "sav" || inst == "mav" ||
+             inst == "dav" || inst == "moav") {
+        generateArithmetic(node);
+    }
+    else if (inst == "inc" || inst == "dec") {
+        generateIncDec(node);
+    }
+    else if (inst == "p" || inst == "pl") {
+        generatePrint(node);
+    }
+    else if (inst == "pk") {
+        out << "    host.pressKey(host.context, static_cast<uint8_t>(" << integerExpr(node.operands[0]) << "));\n";
+    }
+    else if (inst == "rk") {
+        out << "    host.releaseKey(host.context, static_cast<uint8_t>(" << integerExpr(node.operands[0]) << "));\n";
+    }
+    else if (inst == "ikd") {
+        out << "    " << variableName(node.operands[1].value) << " = host.isKeyDown(host.context, static_cast<uint8_t>("
+            << integerExpr(node.operands[0]) << ")) ? 1 : 0;\n";
+    }
+    else if (inst == "mvm") {
+        out << "    host.moveMouse(host.context, static_cast<int32_t>(" << integerExpr(node.operands[0])
+            << "), static_cast<int32_t>(" << integerExpr(node.operands[1]) << "));\n";
+    }
+    else if (inst == "jmp") {
+        out << "    goto " << labelName(node.operands[0].value) << ";\n";
+    }
+    else if (inst == "cejmp" || inst == "cgjmp" || inst == "cljmp" ||
+             inst == "cegjmp" || inst == "celjmp") {
+        generateConditionalJmp(node);
+    }
+    else if (inst == "call") {
+        generateCall(node);
+    }
+    else if (inst == "ret") {
+        generateRet();
+    }
+    else if (inst == "dl") {
+        out << "    host.delay(host.context, static_cast<uint32_t>(" << integerExpr(node.operands[0]) << "));\n";
+    }
+    // cv, dfp and nop only count as a step
+}
+
+void CppGenerator::generateAssignment(const InstructionNode& node) {
+    const auto& var = symbols.getVariable(node.operands[0].value);
+    out << "    " << variableName(node.operands[0].value) << " = " << valueExpr(node.operands[1], var.type) << ";\n";
+}
+
+void CppGenerator::generateArithmetic(const InstructionNode& node) {
+    const std::string& inst = node.instruction.value;
+    const auto& var = symbols.getVariable(node.operands[0].value);
+    std::string name = variableName(node.operands[0].value);
+
+    if (var.type == Type::F32) {
+        std::string rhs = floatExpr(node.operands[1]);
+        if (inst == "moav") {
+            out << "    " << name << " = std::fmod(" << name << ", " << rhs << ");\n";
+        } else {
+            const char* op = inst == "aav" ? "+" : inst == "sav" ? "-" : inst == "mav" ? "*" : "/";
+            out << "    " << name << " = " << name << ' ' << op << ' ' << rhs << ";\n";
+        }
+        return;
+    }
+
+    // Integer variables compute in 64 bits and wrap to their own width, as in the VM
+    std::string rhs = integerExpr(node.operands[1]);
+    const char* type = cppType(var.type);
+    if (inst == "dav" || inst == "moav") {
+        const char* op = inst == "dav" ? "/" : "%";
+        out << "    { int64_t rhs = " << rhs << ";\n";
+        out << "      if (rhs == 0) return { steps, false, \"" << (inst == "dav" ? "Division by zero" : "Modulus by zero") << "\" };\n";
+        out << "      " << name << " = static_cast<" << type << ">(static_cast<int64_t>(" << name << ") " << op << " rhs); }\n";
+    } else {
+        const char* op = inst == "aav" ? "+" : inst == "sav" ? "-" : "*";
+        out << "    " << name << " = static_cast<" << type << ">(static_cast<uint64_t>(static_cast<int64_t>(" << name << ")) "
+            << op << " static_cast<uint64_t>(" << rhs << "));\n";
+    }
+}
+
+void CppGenerator::generateIncDec(const InstructionNode& node) {
+    const auto& var = symbols.getVariable(node.operands[0].value);
+    std::string name = variableName(node.operands[0].value);
+    const char* op = node.instruction.value == "inc" ? "+" : "-";
+
+    if (var.type == Type::F32) {
+        out << "    " << name << " = " << name << ' ' << op << " 1.0f;\n";
+    } else {
+        out << "    " << name << " = static_cast<" << cppType(var.type) << ">(static_cast<int64_t>(" << name << ") " << op << " 1);\n";
+    }
+}
+
+void CppGenerator::generatePrint(const InstructionNode& node) {
+    out << "    { std::string text;\n";
+    for (const auto& operand : node.operands) {
+        if (operand.type == TokenType::STRING) {
+            out << "      text += \"";
+            for (char c : operand.value) {
+                if (c == '"' || c == '\\') {
+                    out << '\\' << c;
+                } else if (std::isprint(static_cast<unsigned char>(c))) {
+                    out << c;
+                } else {
+                    out << "\\x" << std::hex << std::setw(2) << std::setfill('0')
+                        << static_cast<int>(static_cast<unsigned char>(c)) << std::dec << std::setfill(' ') << "\" \"";
+                }
+            }
+            out << "\";\n";
+        } else {
+            const auto& var = symbols.getVariable(operand.value);
+            out << "      text += decoyFormat(" << (var.type == Type::F32 ? floatExpr(operand) : integerExpr(operand)) << ");\n";
+        }
+    }
+    out << "      host.print(host.context, text.data(), text.size());";
+    if (node.instruction.value == "pl") {
+        out << "\n      host.print(host.context, \"\\n\", 1);";
+    }
+    out << " }\n";
+}
+
+void CppGenerator::generateConditionalJmp(const InstructionNode& node) {
+    static const std::unordered_map<std::string, const char*> comparisons = {
+        {"cejmp", "=="}, {"cgjmp", ">"}, {"cljmp", "<"}, {"cegjmp", ">="}, {"celjmp", "<="}
+    };
+
+    const auto& lhs = symbols.getVariable(node.operands[0].value);
+    const auto& rhs = symbols.getVariable(node.operands[1].value);
+
+    // Mixed comparisons go through float, like the VM
+    bool real = lhs.type == Type::F32 || rhs.type == Type::F32;
+    std::string a = real ? floatExpr(node.operands[0]) : integerExpr(node.operands[0]);
+    std::string b = real ? floatExpr(node.operands[1]) : integerExpr(node.operands[1]);
+
+    out << "    if (" << a << ' ' << comparisons.at(node.instruction.value) << ' ' << b << ") goto "
+        << labelName(node.operands[2].value) << "; else goto " << labelName(node.operands[3].value) << ";\n";
+}
+
+void CppGenerator::generateCall(const InstructionNode& node) {
+    size_t site = nextCallSite++;
+    out << "    if (callDepth == " << MAX_CALL_DEPTH << ") return { steps, false, \"Call stack overflow\" };\n";
+    out << "    callStack[callDepth++] = " << site << ";\n";
+    out << "    goto " << labelName(node.operands[0].value) << ";\n";
+    out << "decoy_return_" << site << ":\n";
+}
+
+void CppGenerator::generateRet() {
+    out << "    if (callDepth == 0) return { steps, false, \"ret without a call\" };\n";
+    out << "    switch (callStack[--callDepth]) {\n";
+    for (size_t site = 0; site < callSites; site++) {
+        out << "      case " << site << ": goto decoy_return_" << site << ";\n";
+    }
+    out << "    }\n";
+}
+
+std::string CppGenerator::valueExpr(const Token& operand, Type target) {
+    if (operand.type == TokenType::LITERAL) {
+        return literalExpr(operand.value, target);
+    }
+
+    const auto& var = symbols.getVariable(operand.value);
+    if (var.type == target) {
+        return variableName(operand.value);
+    }
+    return std::string("static_cast<") + cppType(target) + ">(" + (target == Type::F32 ? floatExpr(operand) : integerExpr(operand)) + ")";
+}
+
+std::string CppGenerator::integerExpr(const Token& operand) {
+    if (operand.type == TokenType::LITERAL) {
+        return "INT64_C(" + std::to_string(decodeLiteral(operand.value).toInteger()) + ")";
+    }
+    return "static_cast<int64_t>(" + variableName(operand.value) + ")";
+}
+
+std::string CppGenerator::floatExpr(const Token& operand) {
+    if (operand.type == TokenType::LITERAL) {
+        std::ostringstream ss;
+        ss << std::hexfloat << decodeLiteral(operand.value).toFloat() << 'f';
+        return ss.str();
+    }
+
+    const auto& var = symbols.getVariable(operand.value);
+    if (var.type == Type::F32) {
+        return variableName(operand.value);
+    }
+    return "static_cast<float>(static_cast<int64_t>(" + variableName(operand.value) + "))";
+}
+
+std::string CppGenerator::literalExpr(const std::string& literal, Type target) {
+    if (target == Type::F32) {
+        return floatExpr({ TokenType::LITERAL, literal, 0 });
+    }
+    return std::string("static_cast<") + cppType(target) + ">(" + integerExpr({ TokenType::LITERAL, literal, 0 }) + ")";
+}
+
+CppGenerator::LiteralValue CppGenerator::decodeLiteral(const std::string& literal) {
+    // Decode the literal exactly as CodeGenerator encodes it
+    switch (CodeGenerator::inferLiteralType(literal)) {
+        case Type::F32: return { true, 0, std::stof(literal) };
+        case Type::I32: return { false, static_cast<int32_t>(std::stol(literal)), 0.0f };
+        default: return { false, static_cast<uint32_t>(std::stoul(literal)), 0.0f };
+    }
+}
+
+std::string CppGenerator::variableName(const std::string& name) {
+    return "v_" + name;
+}
+
+std::string CppGenerator::labelName(const std::string& name) {
+    return "L_" + name;
+}
+
+const char* CppGenerator::cppType(Type type) {
+    switch (type) {
+        case Type::I8: return "int8_t";
+        case Type::UI8: return "uint8_t";
+        case Type::I16: return "int16_t";
+        case Type::UI16: return "uint16_t";
+        case Type::I32: return "int32_t";
+        case Type::UI32: return "uint32_t";
+        case Type::F32: return "float";
+        default: throw std::runtime_error("Type has no C++ equivalent");
+    }
+}
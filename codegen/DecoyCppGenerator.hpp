@@ -0,0 +1,61 @@
+#pragma once
+
+#include <sstream>
+#include <vector>
+
+#include "DecoySymbolTable.hpp"
+
+// Lowers an analyzed program to a self-contained C++ translation unit for host-side simulation.
+// Every variable becomes a typed local, every dfp a goto label, and the input/print/delay
+// instructions call back into a DecoyHost. A call pushes the number of its call site and
+// jumps; ret switches on the popped number back to the label after that site. Arithmetic, conversions and comparisons follow
+// the reference VM exactly so the translated script behaves like its bytecode.
+class CppGenerator {
+    public:
+    CppGenerator(const SymbolTable& symbols)
+        : symbols(symbols) {}
+
+    std::string generate(const std::vector<InstructionNode>& ast, const std::string& unitName);
+
+    static std::string entryPointName(const std::string& unitName);
+
+    private:
+    struct LiteralValue {
+        bool isFloat;
+        int64_t integer;
+        float real;
+
+        int64_t toInteger() const { return isFloat ? static_cast<int64_t>(real) : integer; }
+        float toFloat() const { return isFloat ? real : static_cast<float>(integer); }
+    };
+
+    // Same limit as the VM's
+    static constexpr size_t MAX_CALL_DEPTH = 1024;
+
+    const SymbolTable& symbols;
+    std::ostringstream out;
+    size_t callSites = 0;
+    size_t nextCallSite = 0;
+
+    void generatePrelude();
+    void generateInstruction(const InstructionNode& node);
+
+    void generateAssignment(const InstructionNode& node);
+    void generateArithmetic(const InstructionNode& node);
+    void generateIncDec(const InstructionNode& node);
+    void generatePrint(const InstructionNode& node);
+    void generateConditionalJmp(const InstructionNode& node);
+    void generateCall(const InstructionNode& node);
+    void generateRet();
+
+    std::string valueExpr(const Token& operand, Type target);
+    std::string integerExpr(const Token& operand);
+    std::string floatExpr(const Token& operand);
+    std::string literalExpr(const std::string& literal, Type target);
+
+    static LiteralValue decodeLiteral(const std::string& literal);
+
+    static std::string variableName(const std::string& name);
+    static std::string labelName(const std::string& name);
+    static const char* cppType(Type type);
+};
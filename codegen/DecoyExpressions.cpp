@@ -0,0 +1,324 @@
+#include "DecoyExpressions.hpp"
+#include "DecoyHiddenNames.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <unordered_map>
+
+bool ExpressionLowering::hasExpressions(const std::vector<InstructionNode>& ast) {
+    return std::any_of(ast.begin(), ast.end(), [](const InstructionNode& node) { return node.instruction.value == "="; });
+}
+
+std::vector<InstructionNode> ExpressionLowering::lower(const std::vector<InstructionNode>& ast) {
+    std::vector<InstructionNode> body;
+    body.reserve(ast.size());
+    out = &body;
+    for (const auto& node : ast) {
+        if (node.instruction.value == "=") {
+            lowerAssignment(node);
+        } else {
+            body.push_back(node);
+        }
+    }
+    out = nullptr;
+
+    std::vector<InstructionNode> result = std::move(declarations);
+    declarations.clear();
+    result.insert(result.end(), std::make_move_iterator(body.begin()), std::make_move_iterator(body.end()));
+    return result;
+}
+
+void ExpressionLowering::lowerAssignment(const InstructionNode& node) {
+    destination = &node.operands[0];
+    at = &node.instruction;
+    type = symbols.getVariable(destination->value).type;
+
+    // The operands are in postfix order, so every subexpression is complete, and folded, before
+    // the one using it
+    exprs.clear();
+    std::vector<size_t> stack;
+    for (size_t i = 1; i < node.operands.size(); i++) {
+        const Token& token = node.operands[i];
+        if (token.type != TokenType::OPERATOR) {
+            stack.push_back(makeLeaf(token));
+        } else if (token.value == "neg") {
+            stack.back() = makeUnary(stack.back());
+        } else {
+            size_t right = stack.back();
+            stack.pop_back();
+            stack.back() = makeBinary(token.value, stack.back(), right);
+        }
+    }
+
+    size_t root = stack.back();
+    const std::string& name = destination->value;
+    if (readsBeforeWrite(root, name) == exprs[root].reads) {
+        compute(root, name);
+    } else {
+        std::string temp = acquireTemp();
+        compute(root, temp);
+        emit("av", name, { TokenType::IDENTIFIER, temp, at->line, at->column });
+        releaseTemp();
+    }
+}
+
+size_t ExpressionLowering::makeLeaf(const Token& token) {
+    Expr expr;
+    expr.leaf = token;
+    if (token.type == TokenType::LITERAL) {
+        const char* begin = token.value.data();
+        const char* end = begin + token.value.size();
+        expr.constant = true;
+        if (type == Type::F32) {
+            std::from_chars(begin, end, expr.real);
+        } else {
+            std::from_chars(begin, end, expr.integer);
+        }
+    } else {
+        expr.reads = token.value == destination->value ? 1 : 0;
+    }
+
+    exprs.push_back(std::move(expr));
+    return exprs.size() - 1;
+}
+
+size_t ExpressionLowering::makeConstant(int64_t integer, float real) {
+    Expr expr;
+    expr.constant = true;
+    expr.integer = integer;
+    expr.real = real;
+    expr.leaf = { TokenType::LITERAL, type == Type::F32 ? formatFloat(real) : std::to_string(integer), at->line, at->column };
+
+    exprs.push_back(std::move(expr));
+    return exprs.size() - 1;
+}
+
+size_t ExpressionLowering::makeUnary(size_t operand) {
+    const Expr& inner = exprs[operand];
+    if (inner.constant) {
+        if (type == Type::F32) return makeConstant(0, -inner.real);
+        return makeConstant(wrap(static_cast<int64_t>(0 - static_cast<uint64_t>(inner.integer))), 0);
+    }
+    if (inner.op == "neg") return inner.left;
+
+    Expr expr;
+    expr.op = "neg";
+    expr.left = operand;
+    expr.reads = inner.reads;
+    expr.temps = inner.temps;
+
+    exprs.push_back(std::move(expr));
+    return exprs.size() - 1;
+}
+
+size_t ExpressionLowering::makeBinary(const std::string& op, size_t left, size_t right) {
+    if (exprs[left].constant && exprs[right].constant) {
+        int64_t integer = 0;
+        float real = 0;
+        if (fold(op, exprs[left], exprs[right], integer, real)) return makeConstant(integer, real);
+    }
+
+    // Identities; float additions keep their zero, which can change the sign of a zero
+    if ((op == "*" || op == "/") && isConstant(right, 1)) return left;
+    if (op == "*" && isConstant(left, 1)) return right;
+    if (type != Type::F32) {
+        if ((op == "+" || op == "-") && isConstant(right, 0)) return left;
+        if (op == "+" && isConstant(left, 0)) return right;
+        if (op == "-" && isConstant(left, 0)) return makeUnary(right);
+        if (op == "*" && (isConstant(left, 0) || isConstant(right, 0))) return makeConstant(0, 0);
+    }
+
+    // Commutative operands go where they cost least: the assigned variable first, so it can
+    // be computed in place, then the side that is an expression, then the one needing more
+    // temporaries
+    if (op == "+" || op == "*") {
+        const Expr& l = exprs[left];
+        const Expr& r = exprs[right];
+        bool swap = false;
+        if (l.reads == 0 && r.reads > 0) {
+            swap = true;
+        } else if (l.reads == 0 && r.reads == 0) {
+            swap = (l.op.empty() && !r.op.empty()) || (!l.op.empty() && !r.op.empty() && r.temps > l.temps);
+        }
+        if (swap) std::swap(left, right);
+    }
+
+    const Expr& l = exprs[left];
+    const Expr& r = exprs[right];
+
+    Expr expr;
+    expr.op = op;
+    expr.left = left;
+    expr.right = right;
+    expr.reads = l.reads + r.reads;
+    if (r.op.empty()) {
+        expr.temps = l.temps;
+    } else if (op == "-" && l.op.empty() && l.reads == 0) {
+        expr.temps = r.temps;
+    } else {
+        expr.temps = std::max(l.temps, r.temps + 1);
+    }
+
+    exprs.push_back(std::move(expr));
+    return exprs.size() - 1;
+}
+
+// Computes as the VM would; false for what only the VM can do: fail on a zero divisor, or
+// produce a float no literal can hold
+bool ExpressionLowering::fold(const std::string& op, const Expr& left, const Expr& right, int64_t& integer, float& real) const {
+    if (type == Type::F32) {
+        float a = left.real, b = right.real;
+        if (op == "+") real = a + b;
+        else if (op == "-") real = a - b;
+        else if (op == "*") real = a * b;
+        else if (op == "/") real = a / b;
+        else real = std::fmod(a, b);
+        return std::isfinite(real) && (real == 0 || std::isnormal(real));
+    }
+
+    uint64_t a = static_cast<uint64_t>(left.integer), b = static_cast<uint64_t>(right.integer);
+    if (op == "+") integer = static_cast<int64_t>(a + b);
+    else if (op == "-") integer = static_cast<int64_t>(a - b);
+    else if (op == "*") integer = static_cast<int64_t>(a * b);
+    else if (right.integer == 0) return false;
+    else if (op == "/") integer = left.integer / right.integer;
+    else integer = left.integer % right.integer;
+
+    integer = wrap(integer);
+    return true;
+}
+
+bool ExpressionLowering::isConstant(size_t expr, int64_t integer) const {
+    const Expr& e = exprs[expr];
+    if (!e.constant) return false;
+    return type == Type::F32 ? e.real == static_cast<float>(integer) : e.integer == integer;
+}
+
+// How many reads of target compute() makes before it first writes target. Those are the only
+// ones that may read the assigned variable when it is computed in place.
+size_t ExpressionLowering::readsBeforeWrite(size_t expr, const std::string& target) const {
+    const Expr* above = nullptr;
+    while (!exprs[expr].op.empty() && !negatesRight(exprs[expr], target)) {
+        above = &exprs[expr];
+        expr = exprs[expr].left;
+    }
+
+    const Expr& bottom = exprs[expr];
+    if (!bottom.op.empty()) return readsBeforeWrite(bottom.right, target);
+    if (bottom.leaf.type != TokenType::IDENTIFIER || bottom.leaf.value != target) return 0;
+
+    // target is already in place, so the first instruction above writes it once its right
+    // operand is read
+    size_t reads = 1;
+    if (above && above->op != "neg") reads += exprs[above->right].reads;
+    return reads;
+}
+
+// Leaves the value of expr in target. The left spine goes into target bottom up, with each
+// right operand applied to it directly when it is a leaf, or through a temporary otherwise.
+void ExpressionLowering::compute(size_t expr, const std::string& target) {
+    std::vector<size_t> spine = { expr };
+    while (!exprs[spine.back()].op.empty() && !negatesRight(exprs[spine.back()], target)) {
+        spine.push_back(exprs[spine.back()].left);
+    }
+
+    for (size_t k = spine.size(); k-- > 0;) {
+        const Expr& e = exprs[spine[k]];
+        if (e.op.empty()) {
+            if (e.leaf.type != TokenType::IDENTIFIER || e.leaf.value != target) emit("av", target, e.leaf);
+        } else if (e.op == "neg") {
+            emit("mav", target, { TokenType::LITERAL, minusOne(), at->line, at->column });
+        } else if (k == spine.size() - 1) {
+            // a - b computed as -b + a, so b needs no temporary
+            compute(e.right, target);
+            emit("mav", target, { TokenType::LITERAL, minusOne(), at->line, at->column });
+            emit("aav", target, exprs[e.left].leaf);
+        } else {
+            static const std::unordered_map<std::string, std::string> instructions = {
+                {"+", "aav"}, {"-", "sav"}, {"*", "mav"}, {"/", "dav"}, {"%", "moav"}
+            };
+            const std::string& instruction = instructions.at(e.op);
+            const Expr& right = exprs[e.right];
+            if (right.op.empty()) {
+                emit(instruction, target, right.leaf);
+            } else {
+                std::string temp = acquireTemp();
+                compute(e.right, temp);
+                emit(instruction, target, { TokenType::IDENTIFIER, temp, at->line, at->column });
+                releaseTemp();
+            }
+        }
+    }
+}
+
+// Whether compute() takes leaf - b as -b + leaf: when b is an expression, or target itself
+bool ExpressionLowering::negatesRight(const Expr& expr, const std::string& target) const {
+    if (expr.op != "-") return false;
+    const Expr& left = exprs[expr.left];
+    const Expr& right = exprs[expr.right];
+    if (!left.op.empty() || (left.leaf.type == TokenType::IDENTIFIER && left.leaf.value == target)) return false;
+    return !right.op.empty() || (right.leaf.type == TokenType::IDENTIFIER && right.leaf.value == target);
+}
+
+void ExpressionLowering::emit(const std::string& instruction, const std::string& target, const Token& operand) {
+    out->push_back(makeNode(instruction, { { TokenType::IDENTIFIER, target, at->line, at->column }, operand }, *at));
+}
+
+// Temporaries are stacked: an expression nested n deep uses the first n of its type
+std::string ExpressionLowering::acquireTemp() {
+    std::string name = hiddenName("expr_" + typeName(type) + "_" + std::to_string(tempsInUse++));
+    if (!symbols.isVariable(name)) {
+        symbols.addVariable(name, type);
+        declarations.push_back(makeNode("cv", { { TokenType::IDENTIFIER, name, at->line }, { TokenType::TYPE, typeName(type), at->line } }, *at));
+    }
+    return name;
+}
+
+int64_t ExpressionLowering::wrap(int64_t value) const {
+    switch (type) {
+        case Type::I8: return static_cast<int8_t>(value);
+        case Type::UI8: return static_cast<uint8_t>(value);
+        case Type::I16: return static_cast<int16_t>(value);
+        case Type::UI16: return static_cast<uint16_t>(value);
+        case Type::I32: return static_cast<int32_t>(value);
+        default: return static_cast<uint32_t>(value);
+    }
+}
+
+// Multiplying by this negates; unsigned types have no -1 literal, but their largest value
+// wraps the same way
+std::string ExpressionLowering::minusOne() const {
+    switch (type) {
+        case Type::UI8: return std::to_string(UINT8_MAX);
+        case Type::UI16: return std::to_string(UINT16_MAX);
+        case Type::UI32: return std::to_string(UINT32_MAX);
+        case Type::F32: return "-1.0";
+        default: return "-1";
+    }
+}
+
+// The shortest text that reads back as value; the code generator takes literals with a '.' as f32
+std::string ExpressionLowering::formatFloat(float value) {
+    char buffer[64];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed);
+    std::string text(buffer, end);
+    if (text.find('.') == std::string::npos) text += ".0";
+    return text;
+}
+
+std::string ExpressionLowering::typeName(Type type) {
+    switch (type) {
+        case Type::I8: return "i8";
+        case Type::UI8: return "ui8";
+        case Type::I16: return "i16";
+        case Type::UI16: return "ui16";
+        case Type::I32: return "i32";
+        case Type::UI32: return "ui32";
+        default: return "f32";
+    }
+}
+
+InstructionNode ExpressionLowering::makeNode(const std::string& instruction, std::vector<Token> operands, const Token& at) {
+    return { { TokenType::INSTRUCTION, instruction, at.line, at.column }, std::move(operands) };
+}
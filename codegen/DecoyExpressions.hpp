@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "DecoySymbolTable.hpp"
+
+// Lowers expression assignments (x = (a + b) * 3 - c, checked by SemanticAnalyzer) into
+// av/aav/sav/mav/dav/moav. An expression computes in the type of its variable one instruction
+// at a time, so every step wraps exactly as the hand-written instructions would:
+// - constant subexpressions are folded, and so are identities like a + 0 or a * 1; a division
+//   by a constant zero stays, to fail at runtime as dav does
+// - the variable is computed in place unless the expression reads it after changing it: that
+//   is fine for x = x * x + a or x = a - x, but x = a * x + x needs a temporary
+// - operands that are expressions themselves go to hidden temporaries, one per type and
+//   nesting depth, shared by every expression of the program. Commutative operands are
+//   swapped so the larger side is computed in place, which keeps most expressions free of them.
+class ExpressionLowering {
+    public:
+    explicit ExpressionLowering(SymbolTable& symbols) : symbols(symbols) {}
+
+    static bool hasExpressions(const std::vector<InstructionNode>& ast);
+
+    // Declares the temporaries in the symbol table, with their cv at the start of the program
+    std::vector<InstructionNode> lower(const std::vector<InstructionNode>& ast);
+
+    private:
+    struct Expr {
+        Token leaf;             // A variable or literal, when op is empty
+        std::string op;         // + - * / % or neg
+        size_t left = 0;        // The operand of neg
+        size_t right = 0;
+        bool constant = false;  // A literal leaf, with its value in the expression's type
+        int64_t integer = 0;
+        float real = 0;
+        size_t reads = 0;       // Of the assigned variable
+        size_t temps = 0;       // Temporaries needed besides the target, to order operands
+    };
+
+    SymbolTable& symbols;
+    std::vector<InstructionNode> declarations;
+
+    // The expression being lowered
+    std::vector<Expr> exprs;
+    Type type = Type::NT;
+    const Token* destination = nullptr;
+    const Token* at = nullptr;
+    std::vector<InstructionNode>* out = nullptr;
+    size_t tempsInUse = 0;
+
+    void lowerAssignment(const InstructionNode& node);
+
+    size_t makeLeaf(const Token& token);
+    size_t makeConstant(int64_t integer, float real);
+    size_t makeUnary(size_t operand);
+    size_t makeBinary(const std::string& op, size_t left, size_t right);
+    bool fold(const std::string& op, const Expr& left, const Expr& right, int64_t& integer, float& real) const;
+    bool isConstant(size_t expr, int64_t integer) const;
+    size_t readsBeforeWrite(size_t expr, const std::string& target) const;
+
+    void compute(size_t expr, const std::string& target);
+    bool negatesRight(const Expr& expr, const std::string& target) const;
+    void emit(const std::string& instruction, const std::string& target, const Token& operand);
+
+    std::string acquireTemp();
+    void releaseTemp() { tempsInUse--; }
+
+    int64_t wrap(int64_t value) const;
+    std::string minusOne() const;
+    static std::string formatFloat(float value);
+    static std::string typeName(Type type);
+    static InstructionNode makeNode(const std::string& instruction, std::vector<Token> operands, const Token& at);
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// Names of the variables and labels the compiler adds while lowering. Source identifiers never
+// have an underscore after the first character, so a hidden name can never clash with a user's,
+// and a user's label renamed with a hidden suffix can never clash with another user label.
+
+// "__" + name
+inline std::string hiddenName(std::string_view name) {
+    std::string hidden = "__";
+    hidden += name;
+    return hidden;
+}
+
+// "_" + kind + copy, for the labels of the copy-th copy of a block
+inline std::string hiddenSuffix(std::string_view kind, size_t copy) {
+    std::string suffix = "_";
+    suffix += kind;
+    suffix += std::to_string(copy);
+    return suffix;
+}
@@ -0,0 +1,233 @@
+#include "DecoyInliner.hpp"
+#include "DecoyControlFlow.hpp"
+#include "DecoyHiddenNames.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+bool Inliner::hasCalls(const std::vector<InstructionNode>& ast) {
+    return std::any_of(ast.begin(), ast.end(), [](const InstructionNode& node) { return ControlFlowGraph::isCall(node); });
+}
+
+std::vector<InstructionNode> Inliner::inlineCalls(const std::vector<InstructionNode>& ast, std::vector<uint64_t>* counts) {
+    program = &ast;
+    programCounts = counts;
+    subroutines.clear();
+    result.clear();
+    resultCounts.clear();
+    result.reserve(ast.size());
+
+    // Copies stop once the program has doubled, with room to spare for small programs
+    growthLimit = 2 * ast.size() + 4096;
+
+    findSubroutines();
+    emittedAt.assign(ast.size(), 0);
+    emitRange(0, ast.size(), {}, nullptr, 1.0);
+    removeUncalled();
+
+    if (counts) *counts = std::move(resultCounts);
+    program = nullptr;
+    programCounts = nullptr;
+    return std::move(result);
+}
+
+void Inliner::findSubroutines() {
+    const auto& ast = *program;
+
+    std::unordered_map<std::string, size_t> labels;
+    std::unordered_map<std::string, std::vector<size_t>> references;
+    for (size_t i = 0; i < ast.size(); i++) {
+        const auto& node = ast[i];
+        if (node.instruction.value == "dfp") {
+            labels[node.operands[0].value] = i;
+            continue;
+        }
+        for (size_t k : labelOperands(node)) {
+            references[node.operands[k].value].push_back(i);
+        }
+        if (ControlFlowGraph::isCall(node)) {
+            subroutines[node.operands[0].value].callSites++;
+        }
+    }
+
+    for (auto& [name, subroutine] : subroutines) {
+        subroutine.entry = labels.at(name);
+        subroutine.ret = subroutine.entry + 1;
+        while (subroutine.ret < ast.size() && ast[subroutine.ret].instruction.value != "ret") subroutine.ret++;
+        if (subroutine.ret == ast.size()) continue;
+
+        std::unordered_set<std::string> own;
+        for (size_t i = subroutine.entry + 1; i < subroutine.ret; i++) {
+            if (ast[i].instruction.value == "dfp") own.insert(ast[i].operands[0].value);
+        }
+
+        // Copies end where the ret was, so nothing may call into the body: calls from the body
+        // go to other subroutines (or recurse to this one), and its labels are reached only by
+        // its own jumps
+        subroutine.inlinable = true;
+        for (const auto& label : own) {
+            for (size_t at : references[label]) {
+                bool inside = at > subroutine.entry && at < subroutine.ret;
+                subroutine.inlinable = subroutine.inlinable && inside && !ControlFlowGraph::isCall(ast[at]);
+            }
+        }
+        for (size_t i = subroutine.entry + 1; i < subroutine.ret && subroutine.inlinable; i++) {
+            if (!ControlFlowGraph::isJump(ast[i])) continue;
+            for (size_t k : labelOperands(ast[i])) {
+                const auto& label = ast[i].operands[k].value;
+                subroutine.reentered = subroutine.reentered || label == name;
+                subroutine.inlinable = subroutine.inlinable && (label == name || own.contains(label));
+            }
+        }
+    }
+}
+
+bool Inliner::shouldInline(size_t call, const Subroutine& subroutine) const {
+    size_t size = subroutine.ret - subroutine.entry - 1;
+    if (result.size() + size > growthLimit) return false;
+    if (size <= TINY_BODY || subroutine.callSites == 1) return true;
+    return programCounts && size <= MAX_HOT_BODY && (*programCounts)[call] >= size * HOT_CALLS_PER_INSTRUCTION;
+}
+
+// Emits program instructions, inlining the call sites that should be. site is the call the
+// range is copied for (the outermost one when copies nest), or null for the program itself.
+void Inliner::emitRange(size_t begin, size_t end, const Renames& renames, const Token* site, double scale) {
+    const auto& ast = *program;
+
+    for (size_t i = begin; i < end; i++) {
+        const auto& node = ast[i];
+        double count = programCounts ? static_cast<double>((*programCounts)[i]) * scale : 0;
+
+        if (ControlFlowGraph::isCall(node)) {
+            auto it = subroutines.find(node.operands[0].value);
+            if (it != subroutines.end() && it->second.inlinable
+                && std::find(inlining.begin(), inlining.end(), &it->second) == inlining.end()
+                && shouldInline(i, it->second)) {
+                emitCopy(it->second, site ? *site : node.instruction, count);
+                continue;
+            }
+        }
+
+        // The original declares the variable; it stays where it is even if its subroutine goes
+        if (site && node.instruction.value == "cv") continue;
+
+        if (!site) emittedAt[i] = result.size();
+        emit(node, renames, site, static_cast<uint64_t>(std::llround(count)));
+    }
+}
+
+void Inliner::emitCopy(const Subroutine& subroutine, const Token& site, double siteCount) {
+    const auto& ast = *program;
+    const std::string& name = ast[subroutine.entry].operands[0].value;
+
+    Renames renames;
+    std::string suffix = hiddenSuffix("inl", copies++);
+    for (size_t i = subroutine.entry + 1; i < subroutine.ret; i++) {
+        if (ast[i].instruction.value == "dfp") renames[ast[i].operands[0].value] = ast[i].operands[0].value + suffix;
+    }
+
+    // Every count in the copy is the original's share of this site's calls
+    double entryCount = programCounts ? static_cast<double>(std::max<uint64_t>(1, (*programCounts)[subroutine.entry])) : 1;
+    double scale = siteCount / entryCount;
+
+    inlining.push_back(&subroutine);
+    if (subroutine.reentered) {
+        renames[name] = name + suffix;
+        emit(ast[subroutine.entry], renames, &site, static_cast<uint64_t>(std::llround(siteCount)));
+    }
+    emitRange(subroutine.entry + 1, subroutine.ret, renames, &site, scale);
+    inlining.pop_back();
+}
+
+void Inliner::emit(const InstructionNode& node, const Renames& renames, const Token* site, uint64_t count) {
+    result.push_back(node);
+    auto& emitted = result.back();
+
+    if (site) {
+        emitted.instruction.line = site->line;
+        emitted.instruction.column = site->column;
+    }
+
+    // Calls always go to the original subroutine; copies have no ret to come back with
+    if (!renames.empty() && !ControlFlowGraph::isCall(emitted)) {
+        std::vector<size_t> operands = labelOperands(emitted);
+        if (emitted.instruction.value == "dfp") operands = { 0 };
+        for (size_t k : operands) {
+            auto it = renames.find(emitted.operands[k].value);
+            if (it != renames.end()) emitted.operands[k].value = it->second;
+        }
+    }
+
+    if (programCounts) resultCounts.push_back(count);
+}
+
+// Drops subroutines nothing calls or jumps to any more, unless the code before them falls
+// through into them. Removing one can leave another without callers, so this repeats; their
+// variable declarations stay.
+void Inliner::removeUncalled() {
+    std::vector<const Subroutine*> candidates;
+    for (auto& [name, subroutine] : subroutines) {
+        if (subroutine.inlinable) candidates.push_back(&subroutine);
+    }
+    if (candidates.empty()) return;
+    std::sort(candidates.begin(), candidates.end(), [](const Subroutine* a, const Subroutine* b) { return a->entry < b->entry; });
+
+    std::unordered_map<std::string, size_t> references;
+    for (const auto& node : result) {
+        for (size_t k : labelOperands(node)) references[node.operands[k].value]++;
+    }
+
+    std::vector<char> removed(result.size(), false);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const Subroutine* subroutine : candidates) {
+            size_t entry = emittedAt[subroutine->entry], ret = emittedAt[subroutine->ret];
+            if (removed[entry]) continue;
+
+            // Jumps back to its own entry do not keep it alive
+            const std::string& name = result[entry].operands[0].value;
+            size_t own = 0;
+            for (size_t i = entry + 1; i < ret; i++) {
+                if (removed[i]) continue;
+                for (size_t k : labelOperands(result[i])) own += result[i].operands[k].value == name ? 1 : 0;
+            }
+            if (references[name] != own) continue;
+
+            // cv does nothing at runtime, so control falls through it
+            size_t before = entry;
+            while (before > 0 && (removed[before - 1] || result[before - 1].instruction.value == "cv")) before--;
+            if (before == 0) continue;
+            const auto& previous = result[before - 1];
+            if (!ControlFlowGraph::isJump(previous) && previous.instruction.value != "ret") continue;
+
+            for (size_t i = entry; i <= ret; i++) {
+                if (removed[i] || result[i].instruction.value == "cv") continue;
+                removed[i] = true;
+                for (size_t k : labelOperands(result[i])) references[result[i].operands[k].value]--;
+            }
+            changed = true;
+        }
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < result.size(); i++) {
+        if (removed[i]) continue;
+        if (kept != i) {
+            result[kept] = std::move(result[i]);
+            if (programCounts) resultCounts[kept] = resultCounts[i];
+        }
+        kept++;
+    }
+    result.resize(kept);
+    if (programCounts) resultCounts.resize(kept);
+}
+
+// Operands naming a label that control goes to (a dfp only declares its label)
+const std::vector<size_t>& Inliner::labelOperands(const InstructionNode& node) {
+    static const std::vector<size_t> none, first = { 0 }, targets = { 2, 3 };
+    if (node.instruction.value == "jmp" || ControlFlowGraph::isCall(node)) return first;
+    if (ControlFlowGraph::isConditionalJump(node)) return targets;
+    return none;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../parser/DecoyParser.hpp"
+
+// Replaces calls to small subroutines with a copy of the subroutine. A subroutine runs from a
+// called label to the first ret after it, and can be inlined when control stays inside it:
+// its jumps go to its own labels, and nothing outside jumps or calls into it past its entry.
+//
+// Every call site is decided on its own. A site is inlined when:
+// - the body has at most TINY_BODY instructions, no more than the call, dfp and ret it saves
+// - it is the subroutine's only call site, so the body exists once either way
+// - with execution counts, it ran at least HOT_CALLS_PER_INSTRUCTION times per body
+//   instruction, for bodies of up to MAX_HOT_BODY instructions
+// Other sites stay real calls, so cold shared code exists once. A subroutine left without
+// callers is removed when nothing can fall or jump into it.
+//
+// Copies take the line of their call site, which keeps line profiles of an inlined build
+// usable for the next one, and get labels of their own.
+class Inliner {
+    public:
+    static bool hasCalls(const std::vector<InstructionNode>& ast);
+
+    // counts, when given, are execution counts for ast (see ProfileData); they are replaced
+    // by estimates for the returned program
+    std::vector<InstructionNode> inlineCalls(const std::vector<InstructionNode>& ast, std::vector<uint64_t>* counts = nullptr);
+
+    private:
+    static constexpr size_t TINY_BODY = 3;
+    static constexpr size_t MAX_HOT_BODY = 32;
+    static constexpr uint64_t HOT_CALLS_PER_INSTRUCTION = 16;
+
+    struct Subroutine {
+        size_t entry = 0;           // Its dfp
+        size_t ret = 0;
+        size_t callSites = 0;
+        bool inlinable = false;
+        bool reentered = false;     // The body jumps back to the entry label, so copies need one
+    };
+
+    // Source label name to its name in the copy being emitted
+    using Renames = std::unordered_map<std::string, std::string>;
+
+    const std::vector<InstructionNode>* program = nullptr;
+    const std::vector<uint64_t>* programCounts = nullptr;
+    std::unordered_map<std::string, Subroutine> subroutines;
+    std::vector<const Subroutine*> inlining; // Subroutines being copied, innermost last
+    std::vector<InstructionNode> result;
+    std::vector<uint64_t> resultCounts;
+    std::vector<size_t> emittedAt; // Where each program instruction landed in result, unless inlined away
+    size_t growthLimit = 0;
+    size_t copies = 0;
+
+    void findSubroutines();
+    bool shouldInline(size_t call, const Subroutine& subroutine) const;
+
+    void emitRange(size_t begin, size_t end, const Renames& renames, const Token* site, double scale);
+    void emitCopy(const Subroutine& subroutine, const Token& site, double siteCount);
+    void emit(const InstructionNode& node, const Renames& renames, const Token* site, uint64_t count);
+
+    void removeUncalled();
+
+    static const std::vector<size_t>& labelOperands(const InstructionNode& node);
+};
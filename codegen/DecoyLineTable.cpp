@@ -0,0 +1,89 @@
+#include "DecoyLineTable.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+void LineTable::add(size_t address, size_t line, size_t column) {
+    if (!withColumns) column = 0;
+
+    if (!entries.empty()) {
+        const auto& last = entries.back();
+        if (last.line == line && last.column == column) return;
+        if (address < last.address) throw std::runtime_error("Line table addresses must be increasing");
+    }
+
+    entries.push_back({ static_cast<uint32_t>(address), static_cast<uint32_t>(line), static_cast<uint32_t>(column) });
+}
+
+std::vector<uint8_t> LineTable::encode() const {
+    std::vector<uint8_t> out;
+    out.push_back(withColumns ? 1 : 0);
+    writeVarint(out, entries.size());
+
+    LineEntry previous{ 0, 0, 0 };
+    for (const auto& entry : entries) {
+        writeVarint(out, entry.address - previous.address);
+        writeSigned(out, static_cast<int64_t>(entry.line) - previous.line);
+        if (withColumns) {
+            writeSigned(out, static_cast<int64_t>(entry.column) - previous.column);
+        }
+        previous = entry;
+    }
+
+    return out;
+}
+
+LineTable LineTable::decode(const std::vector<uint8_t>& data) {
+    if (data.empty()) throw std::runtime_error("Empty line table");
+
+    LineTable table(data[0] & 1);
+    size_t pos = 1;
+    uint64_t count = readVarint(data, pos);
+
+    LineEntry current{ 0, 0, 0 };
+    for (uint64_t i = 0; i < count; i++) {
+        current.address += static_cast<uint32_t>(readVarint(data, pos));
+        current.line += static_cast<uint32_t>(readSigned(data, pos));
+        if (table.withColumns) {
+            current.column += static_cast<uint32_t>(readSigned(data, pos));
+        }
+        table.entries.push_back(current);
+    }
+
+    return table;
+}
+
+const LineEntry* LineTable::lookup(size_t address) const {
+    auto it = std::upper_bound(entries.begin(), entries.end(), address,
+        [](size_t value, const LineEntry& entry) { return value < entry.address; });
+    if (it == entries.begin()) return nullptr;
+    return &*(it - 1);
+}
+
+void LineTable::writeVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void LineTable::writeSigned(std::vector<uint8_t>& out, int64_t value) {
+    writeVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+uint64_t LineTable::readVarint(const std::vector<uint8_t>& data, size_t& pos) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= data.size()) throw std::runtime_error("Truncated line table");
+        uint8_t byte = data[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    throw std::runtime_error("Malformed line table varint");
+}
+
+int64_t LineTable::readSigned(const std::vector<uint8_t>& data, size_t& pos) {
+    uint64_t value = readVarint(data, pos);
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
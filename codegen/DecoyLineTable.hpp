@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct LineEntry {
+    uint32_t address;
+    uint32_t line;
+    uint32_t column;
+};
+
+// Maps bytecode addresses back to source positions. Stored as its own
+// archive entry (<unit>.xexl) so release archives can simply leave it out.
+//
+// Encoding:
+//   [1-byte flags]  bit 0: columns present
+//   [varint count]
+//   per entry: [varint address delta][zigzag varint line delta]([zigzag varint column delta])
+//
+// An entry covers every address from its own up to the next entry's. Entries
+// are only written when the source position changes.
+class LineTable {
+    public:
+    explicit LineTable(bool withColumns = false) : withColumns(withColumns) {}
+
+    void add(size_t address, size_t line, size_t column);
+
+    std::vector<uint8_t> encode() const;
+    static LineTable decode(const std::vector<uint8_t>& data);
+
+    const LineEntry* lookup(size_t address) const;
+
+    const std::vector<LineEntry>& getEntries() const { return entries; }
+    bool hasColumns() const { return withColumns; }
+    bool empty() const { return entries.empty(); }
+
+    private:
+    bool withColumns;
+    std::vector<LineEntry> entries;
+
+    static void writeVarint(std::vector<uint8_t>& out, uint64_t value);
+    static void writeSigned(std::vector<uint8_t>& out, int64_t value);
+    static uint64_t readVarint(const std::vector<uint8_t>& data, size_t& pos);
+    static int64_t readSigned(const std::vector<uint8_t>& data, size_t& pos);
+};
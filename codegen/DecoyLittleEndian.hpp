@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// The 4-byte little-endian fields of the module, certificate, string pool, index and cache
+// formats. readUI32 does not check bounds; callers check the size first.
+
+inline void writeUI32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back((value >> (8 * i)) & 0xFF);
+    }
+}
+
+inline uint32_t readUI32(std::span<const uint8_t> data, size_t pos) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= static_cast<uint32_t>(data[pos + i]) << (8 * i);
+    }
+    return value;
+}
@@ -0,0 +1,65 @@
+#include "DecoyProfile.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+ProfileData ProfileData::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open profile: " + path);
+    }
+
+    ProfileData profile;
+    std::string unit;
+    std::string text;
+    size_t lineNumber = 0;
+
+    while (std::getline(file, text)) {
+        lineNumber++;
+        text = text.substr(0, text.find('#'));
+
+        std::istringstream record(text);
+        std::string kind;
+        if (!(record >> kind)) continue;
+
+        if (kind == "unit") {
+            if (!(record >> unit)) {
+                throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": expected a unit name");
+            }
+            continue;
+        }
+
+        std::string key;
+        uint64_t count = 0;
+        if (!(record >> key >> count) || (kind != "line" && kind != "address")) {
+            throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": expected 'line <n> <count>' or 'address <addr> <count>'");
+        }
+
+        auto& target = kind == "line" ? profile.units[unit].lines : profile.units[unit].addresses;
+        target[std::stoull(key, nullptr, 0)] += count;
+    }
+
+    return profile;
+}
+
+std::vector<uint64_t> ProfileData::instructionCounts(const std::string& unitName, const std::vector<InstructionNode>& ast,
+    const std::vector<size_t>& sourceAddresses) const {
+    std::vector<uint64_t> counts(ast.size(), 0);
+
+    for (const auto& name : { std::string(), unitName }) {
+        auto it = units.find(name);
+        if (it == units.end()) continue;
+
+        const auto& unit = it->second;
+        for (size_t i = 0; i < ast.size(); i++) {
+            auto line = unit.lines.find(ast[i].instruction.line);
+            if (line != unit.lines.end()) counts[i] += line->second;
+
+            auto address = unit.addresses.find(sourceAddresses[i]);
+            if (address != unit.addresses.end()) counts[i] += address->second;
+        }
+    }
+
+    return counts;
+}
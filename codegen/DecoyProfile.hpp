@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../parser/DecoyParser.hpp"
+
+// Execution counts fed back into the compiler with --profile-use.
+//
+// File format (one record per line, '#' starts a comment):
+//   unit <name>              following records apply to <name>.dc only
+//   line <line> <count>      executions of the instruction(s) on a source line
+//   address <addr> <count>   executions of the instruction at a byte address
+//
+// Records before the first "unit" line apply to every unit. Addresses may be
+// decimal or 0x-prefixed hex and refer to the source-order layout, i.e. a
+// build made without --profile-use or --registers. Line records survive
+// relayout and are what DecoyRunner --profile-out writes whenever a line
+// table is available.
+class ProfileData {
+    public:
+    static ProfileData load(const std::string& path);
+
+    // Execution count of every instruction in ast, in ast order
+    std::vector<uint64_t> instructionCounts(const std::string& unitName, const std::vector<InstructionNode>& ast,
+        const std::vector<size_t>& sourceAddresses) const;
+
+    bool empty() const { return units.empty(); }
+
+    private:
+    struct UnitProfile {
+        std::unordered_map<uint64_t, uint64_t> lines;
+        std::unordered_map<uint64_t, uint64_t> addresses;
+    };
+
+    std::unordered_map<std::string, UnitProfile> units; // "" holds records for every unit
+};
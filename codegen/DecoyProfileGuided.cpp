@@ -0,0 +1,136 @@
+#include "DecoyProfileGuided.hpp"
+#include "DecoyHiddenNames.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+static const std::string EXIT_LABEL = hiddenName("pgo_exit");
+
+void ProfileGuidedOptimizer::layoutVariables(const std::vector<InstructionNode>& ast) {
+    std::unordered_map<std::string, uint64_t> heat;
+    std::vector<std::string> names;
+
+    for (size_t i = 0; i < ast.size(); i++) {
+        for (const auto& operand : ast[i].operands) {
+            if (operand.type != TokenType::IDENTIFIER || !symbols.isVariable(operand.value)) continue;
+            if (!heat.contains(operand.value)) names.push_back(operand.value);
+            heat[operand.value] += counts[i];
+        }
+    }
+
+    std::stable_sort(names.begin(), names.end(),
+        [&](const std::string& a, const std::string& b) { return heat[a] > heat[b]; });
+    names.erase(std::remove_if(names.begin(), names.end(),
+        [&](const std::string& name) { return heat[name] == 0; }), names.end());
+
+    symbols.relayoutVariables(names);
+}
+
+std::vector<InstructionNode> ProfileGuidedOptimizer::layoutBlocks(const std::vector<InstructionNode>& ast) {
+    if (ast.empty()) return ast;
+
+    ControlFlowGraph cfg(ast);
+    const auto& blocks = cfg.getBlocks();
+
+    std::vector<uint64_t> weights(blocks.size(), 0);
+    for (size_t b = 0; b < blocks.size(); b++) {
+        for (size_t i = blocks[b].begin; i < blocks[b].end; i++) {
+            weights[b] = std::max(weights[b], counts[i]);
+        }
+    }
+
+    if (std::all_of(weights.begin(), weights.end(), [](uint64_t w) { return w == 0; })) {
+        return ast;
+    }
+
+    std::vector<size_t> order = chainBlocks(cfg, weights);
+
+    std::vector<InstructionNode> result;
+    result.reserve(ast.size() + blocks.size());
+    bool needsExit = false;
+
+    for (size_t k = 0; k < order.size(); k++) {
+        const auto& block = blocks[order[k]];
+        size_t next = k + 1 < order.size() ? order[k + 1] : cfg.exitBlock();
+        const auto& last = ast[block.end - 1];
+
+        // A jump to the block that now follows is redundant
+        size_t end = block.end;
+        if (last.instruction.value == "jmp" && cfg.blockOfLabel(last.operands[0].value) == next) {
+            end--;
+        }
+        result.insert(result.end(), ast.begin() + block.begin, ast.begin() + end);
+
+        // Blocks whose fall-through successor moved away need an explicit jump
+        if (block.fallsThrough && block.successors[0] != next) {
+            size_t target = block.successors[0];
+            if (target == cfg.exitBlock()) {
+                result.push_back(makeJump(EXIT_LABEL, last.instruction.line));
+                needsExit = true;
+            } else {
+                // Fall-through only happens into a dfp, so the target always has a label
+                result.push_back(makeJump(ast[blocks[target].begin].operands[0].value, last.instruction.line));
+            }
+        }
+    }
+
+    if (needsExit) {
+        result.push_back(makeLabel(EXIT_LABEL, ast.back().instruction.line));
+    }
+
+    return result;
+}
+
+std::vector<size_t> ProfileGuidedOptimizer::chainBlocks(const ControlFlowGraph& cfg, const std::vector<uint64_t>& weights) {
+    const auto& blocks = cfg.getBlocks();
+    std::vector<bool> placed(blocks.size(), false);
+    std::vector<size_t> order;
+
+    // The entry block stays first; from each placed block follow its hottest unplaced successor
+    size_t current = 0;
+    while (true) {
+        placed[current] = true;
+        order.push_back(current);
+
+        size_t best = cfg.exitBlock();
+        uint64_t bestWeight = 0;
+        for (size_t successor : blocks[current].successors) {
+            if (successor == cfg.exitBlock() || placed[successor]) continue;
+
+            uint64_t edge = std::min(weights[current], weights[successor]);
+            bool preferFallthrough = edge == bestWeight && successor == current + 1;
+            if (edge > bestWeight || preferFallthrough) {
+                best = successor;
+                bestWeight = edge;
+            }
+        }
+
+        // Dead end: restart the chain at the hottest block not yet placed
+        if (best == cfg.exitBlock() || bestWeight == 0) {
+            best = cfg.exitBlock();
+            for (size_t b = 0; b < blocks.size(); b++) {
+                if (!placed[b] && weights[b] > 0 && (best == cfg.exitBlock() || weights[b] > weights[best])) {
+                    best = b;
+                }
+            }
+        }
+
+        if (best == cfg.exitBlock()) break;
+        current = best;
+    }
+
+    // Never-executed blocks go last, in source order
+    for (size_t b = 0; b < blocks.size(); b++) {
+        if (!placed[b]) order.push_back(b);
+    }
+
+    return order;
+}
+
+InstructionNode ProfileGuidedOptimizer::makeJump(const std::string& label, size_t line) {
+    return { { TokenType::INSTRUCTION, "jmp", line }, { { TokenType::IDENTIFIER, label, line } } };
+}
+
+InstructionNode ProfileGuidedOptimizer::makeLabel(const std::string& label, size_t line) {
+    return { { TokenType::INSTRUCTION, "dfp", line }, { { TokenType::IDENTIFIER, label, line } } };
+}
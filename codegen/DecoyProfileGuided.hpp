@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+
+#include "DecoySymbolTable.hpp"
+#include "DecoyControlFlow.hpp"
+
+// Uses per-instruction execution counts (see ProfileData) to lay out a program:
+// hot blocks are chained so the common successor falls through, never-executed
+// blocks move to the end, and the hottest variables get the lowest offsets.
+class ProfileGuidedOptimizer {
+    public:
+    ProfileGuidedOptimizer(SymbolTable& symbols, const std::vector<uint64_t>& counts)
+        : symbols(symbols), counts(counts) {}
+
+    // Counts are indexed by the original program, so lay out variables first
+    void layoutVariables(const std::vector<InstructionNode>& ast);
+    std::vector<InstructionNode> layoutBlocks(const std::vector<InstructionNode>& ast);
+
+    private:
+    SymbolTable& symbols;
+    const std::vector<uint64_t>& counts;
+
+    std::vector<size_t> chainBlocks(const ControlFlowGraph& cfg, const std::vector<uint64_t>& weights);
+
+    static InstructionNode makeJump(const std::string& label, size_t line);
+    static InstructionNode makeLabel(const std::string& label, size_t line);
+};
@@ -0,0 +1,127 @@
+#include "DecoyRegisterAllocator.hpp"
+#include "DecoyBytecode.hpp"
+#include "DecoyControlFlow.hpp"
+
+#include <algorithm>
+
+RegisterAllocator::RegisterAllocator(const SymbolTable& symbols, size_t registers)
+    : symbols(symbols), registerCount(std::min(registers, REGISTER_COUNT)) {}
+
+std::vector<InstructionNode> RegisterAllocator::allocate(const std::vector<InstructionNode>& ast, std::vector<uint64_t>* counts) {
+    registers.clear();
+    if (ast.empty() || registerCount == 0) return ast;
+
+    choose(ast, counts ? *counts : loopWeights(ast));
+    if (registers.empty()) return ast;
+
+    std::vector<InstructionNode> result;
+    std::vector<uint64_t> resultCounts;
+    result.reserve(ast.size() + registers.size());
+    auto push = [&](InstructionNode node, uint64_t count) {
+        result.push_back(std::move(node));
+        if (counts) resultCounts.push_back(count);
+    };
+
+    // Ahead of every label, so nothing can jump back to a fill and reload a stale variable
+    std::vector<const std::string*> pinned(registers.size());
+    for (const auto& [name, index] : registers) pinned[index] = &name;
+    for (const std::string* name : pinned) {
+        push(makeNode("fill", *name, ast.front().instruction), counts ? (*counts)[0] : 0);
+    }
+
+    for (size_t i = 0; i < ast.size(); i++) {
+        const auto& node = ast[i];
+        const std::string& inst = node.instruction.value;
+        uint64_t count = counts ? (*counts)[i] : 0;
+
+        if (inst == "p" || inst == "pl") {
+            std::vector<const std::string*> spilled;
+            for (const auto& operand : node.operands) {
+                if (!isPinned(operand)) continue;
+                if (std::any_of(spilled.begin(), spilled.end(), [&](const std::string* name) { return *name == operand.value; })) continue;
+                spilled.push_back(&operand.value);
+                push(makeNode("spill", operand.value, node.instruction), count);
+            }
+        } else if (inst == "ikd" && isPinned(node.operands[0])) {
+            push(makeNode("spill", node.operands[0].value, node.instruction), count);
+        }
+
+        push(node, count);
+
+        if (inst == "ikd" && isPinned(node.operands[1])) {
+            push(makeNode("fill", node.operands[1].value, node.instruction), count);
+        }
+    }
+
+    if (counts) *counts = std::move(resultCounts);
+    return result;
+}
+
+// LOOP_WEIGHT to the power of each instruction's loop depth
+std::vector<uint64_t> RegisterAllocator::loopWeights(const std::vector<InstructionNode>& ast) {
+    ControlFlowGraph cfg(ast);
+    const auto& blocks = cfg.getBlocks();
+
+    std::vector<size_t> depth(blocks.size(), 0);
+    for (const Loop& loop : cfg.findLoops()) {
+        for (size_t block : loop.blocks) depth[block]++;
+    }
+
+    std::vector<uint64_t> weights(ast.size(), 1);
+    for (size_t b = 0; b < blocks.size(); b++) {
+        uint64_t weight = 1;
+        for (size_t k = 0; k < std::min(depth[b], MAX_LOOP_DEPTH); k++) weight *= LOOP_WEIGHT;
+        std::fill(weights.begin() + blocks[b].begin, weights.begin() + blocks[b].end, weight);
+    }
+    return weights;
+}
+
+void RegisterAllocator::choose(const std::vector<InstructionNode>& ast, const std::vector<uint64_t>& weights) {
+    std::unordered_map<std::string, int64_t> benefit;
+    std::vector<std::string> names; // In order of first use, which breaks ties
+
+    auto add = [&](const Token& operand, int64_t amount) {
+        if (operand.type != TokenType::IDENTIFIER || !symbols.isVariable(operand.value)) return;
+        auto [it, inserted] = benefit.try_emplace(operand.value, 0);
+        if (inserted) names.push_back(operand.value);
+        it->second += amount;
+    };
+
+    for (size_t i = 0; i < ast.size(); i++) {
+        const auto& node = ast[i];
+        const std::string& inst = node.instruction.value;
+
+        // Counts can be huge; past this any variable that runs them is worth a register anyway
+        int64_t weight = static_cast<int64_t>(std::min<uint64_t>(weights[i], uint64_t(1) << 40));
+
+        if (inst == "cv" || inst == "dfp") continue;
+        if (inst == "p" || inst == "pl") {
+            for (size_t k = 0; k < node.operands.size(); k++) {
+                bool repeated = std::any_of(node.operands.begin(), node.operands.begin() + k,
+                    [&](const Token& earlier) { return earlier.type == TokenType::IDENTIFIER && earlier.value == node.operands[k].value; });
+                if (!repeated) add(node.operands[k], -SYNC_COST * weight);
+            }
+        } else if (inst == "ikd") {
+            add(node.operands[0], -SYNC_COST * weight);
+            add(node.operands[1], -SYNC_COST * weight);
+        } else {
+            for (const auto& operand : node.operands) add(operand, weight);
+        }
+    }
+
+    std::stable_sort(names.begin(), names.end(),
+        [&](const std::string& a, const std::string& b) { return benefit[a] > benefit[b]; });
+
+    for (const auto& name : names) {
+        if (registers.size() == registerCount || benefit[name] <= 0) break;
+        registers.emplace(name, static_cast<uint8_t>(registers.size()));
+    }
+}
+
+bool RegisterAllocator::isPinned(const Token& operand) const {
+    return operand.type == TokenType::IDENTIFIER && registers.contains(operand.value);
+}
+
+InstructionNode RegisterAllocator::makeNode(const std::string& instruction, const std::string& variable, const Token& at) {
+    return { { TokenType::INSTRUCTION, instruction, at.line, at.column }, { { TokenType::IDENTIFIER, variable, at.line, at.column } } };
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DecoySymbolTable.hpp"
+
+// Pins the hottest variables of a program to the VM's register file, so the instructions that
+// use them skip the typed memory access (see the register forms in DecoyBytecode.hpp).
+//
+// A pinned variable lives in its register for the whole program: it is filled once at the
+// start, before any label, and never moves, so no block boundary needs a spill. Only the
+// instructions that can read or write memory alone need one:
+// - p, pl and ikd read a spill of the variable made right before them
+// - ikd writes memory, and a fill right after it brings the result back
+//
+// Each variable is weighed by how often its uses run: execution counts when given, otherwise
+// LOOP_WEIGHT per enclosing loop. Every use a register serves adds its weight, every spill or
+// fill it forces costs SYNC_COST times its weight, and the variables with the largest positive
+// total get the registers.
+class RegisterAllocator {
+    public:
+    RegisterAllocator(const SymbolTable& symbols, size_t registers);
+
+    // counts, when given, are execution counts for ast (see ProfileData); they are replaced
+    // by counts for the returned program
+    std::vector<InstructionNode> allocate(const std::vector<InstructionNode>& ast, std::vector<uint64_t>* counts = nullptr);
+
+    // Register of every pinned variable, for CodeGenerator::setRegisters
+    const std::unordered_map<std::string, uint8_t>& assignments() const { return registers; }
+
+    private:
+    static constexpr uint64_t LOOP_WEIGHT = 8;
+    static constexpr size_t MAX_LOOP_DEPTH = 6; // Deeper nests weigh the same
+    static constexpr int64_t SYNC_COST = 4; // A spill or fill is a whole instruction; a register use saves one access
+
+    const SymbolTable& symbols;
+    size_t registerCount;
+    std::unordered_map<std::string, uint8_t> registers;
+
+    static std::vector<uint64_t> loopWeights(const std::vector<InstructionNode>& ast);
+    void choose(const std::vector<InstructionNode>& ast, const std::vector<uint64_t>& weights);
+
+    bool isPinned(const Token& operand) const;
+    static InstructionNode makeNode(const std::string& instruction, const std::string& variable, const Token& at);
+};
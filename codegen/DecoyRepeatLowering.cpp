@@ -0,0 +1,201 @@
+#include "DecoyRepeatLowering.hpp"
+#include "DecoyControlFlow.hpp"
+#include "DecoyHiddenNames.hpp"
+
+#include <algorithm>
+
+bool RepeatLowering::hasRepeats(const std::vector<InstructionNode>& ast) {
+    return std::any_of(ast.begin(), ast.end(), [](const InstructionNode& node) { return node.instruction.value == "rep"; });
+}
+
+std::vector<InstructionNode> RepeatLowering::lower(const std::vector<InstructionNode>& ast) {
+    ends.assign(ast.size(), 0);
+    std::vector<size_t> open;
+    for (size_t i = 0; i < ast.size(); i++) {
+        if (ast[i].instruction.value == "rep") {
+            open.push_back(i);
+        } else if (ast[i].instruction.value == "endrep") {
+            ends[open.back()] = i;
+            open.pop_back();
+        }
+    }
+
+    findReentered(ast);
+
+    std::vector<InstructionNode> body;
+    body.reserve(ast.size());
+    lowerRange(ast, 0, ast.size(), {}, true, body);
+
+    std::vector<InstructionNode> result = std::move(declarations);
+    declarations.clear();
+    result.insert(result.end(), std::make_move_iterator(body.begin()), std::make_move_iterator(body.end()));
+    return result;
+}
+
+// A counted loop whose block calls something that can get back into the block, through any
+// chain of calls and jumps, would have its counter reset or decremented by the inner pass.
+// The graph's successors include call targets but not returns, so a search from the targets
+// of the block's calls finds exactly what those calls can run before they come back.
+void RepeatLowering::findReentered(const std::vector<InstructionNode>& ast) {
+    reentered.assign(ast.size(), false);
+
+    std::vector<size_t> calling;
+    for (size_t i = 0; i < ast.size(); i++) {
+        if (ast[i].instruction.value != "rep") continue;
+        for (size_t k = i + 1; k < ends[i]; k++) {
+            if (ControlFlowGraph::isCall(ast[k])) {
+                calling.push_back(i);
+                break;
+            }
+        }
+    }
+    if (calling.empty()) return;
+
+    ControlFlowGraph cfg(ast);
+    const auto& blocks = cfg.getBlocks();
+    std::vector<char> visited;
+    std::vector<size_t> work;
+    for (size_t rep : calling) {
+        visited.assign(blocks.size(), false);
+        work.clear();
+        for (size_t k = rep + 1; k < ends[rep]; k++) {
+            if (ControlFlowGraph::isCall(ast[k])) work.push_back(cfg.blockOfLabel(ast[k].operands[0].value));
+        }
+
+        while (!work.empty() && !reentered[rep]) {
+            size_t b = work.back();
+            work.pop_back();
+            if (b == cfg.exitBlock() || visited[b]) continue;
+            visited[b] = true;
+
+            if (blocks[b].begin <= ends[rep] && blocks[b].end > rep) reentered[rep] = true;
+            work.insert(work.end(), blocks[b].successors.begin(), blocks[b].successors.end());
+        }
+    }
+}
+
+void RepeatLowering::lowerRange(const std::vector<InstructionNode>& ast, size_t begin, size_t end, const Renames& renames,
+    bool declare, std::vector<InstructionNode>& out) {
+    for (size_t i = begin; i < end; i++) {
+        const std::string& inst = ast[i].instruction.value;
+        if (inst == "rep") {
+            lowerRepeat(ast, i, renames, declare, out);
+            i = ends[i];
+            continue;
+        }
+
+        // A variable is declared once; later copies of its cv would only cost a dispatch
+        if (inst == "cv" && !declare) continue;
+
+        out.push_back(ast[i]);
+        if (!renames.empty()) rename(out.back(), renames);
+    }
+}
+
+void RepeatLowering::lowerRepeat(const std::vector<InstructionNode>& ast, size_t rep, const Renames& renames,
+    bool declare, std::vector<InstructionNode>& out) {
+    size_t count = std::stoul(ast[rep].operands[0].value);
+
+    // Nothing in the block runs, but variables declared in it exist for the code after it
+    if (count == 0) {
+        for (size_t i = rep + 1; declare && i < ends[rep]; i++) {
+            if (ast[i].instruction.value == "cv") out.push_back(ast[i]);
+        }
+        return;
+    }
+
+    size_t repLine = ast[rep].instruction.line;
+    size_t endLine = ast[ends[rep]].instruction.line;
+
+    // The first copy shows how large a copy is, nested blocks included
+    std::vector<InstructionNode> first;
+    lowerCopy(ast, rep, renames, declare, first);
+    size_t copySize = std::max<size_t>(1, first.size());
+
+    size_t factor = reentered[rep] ? count : std::min({ count, maxUnroll, std::max<size_t>(1, MAX_UNROLLED_SIZE / copySize) });
+    out.insert(out.end(), std::make_move_iterator(first.begin()), std::make_move_iterator(first.end()));
+
+    if (factor == count) {
+        for (size_t copy = 1; copy < count; copy++) {
+            lowerCopy(ast, rep, renames, false, out);
+        }
+        return;
+    }
+
+    // A loop that runs once is no loop: halve the factor so it runs twice instead
+    if (count / factor == 1) factor = count / 2;
+    size_t iterations = count / factor;
+    size_t remainder = count % factor;
+
+    std::string id = std::to_string(loops++);
+    std::string top = hiddenName("rep" + id + "_top"), exit = hiddenName("rep" + id + "_exit");
+    std::string index = hiddenVariable(hiddenName("rep_counter" + id), repLine);
+    std::string zero = hiddenVariable(hiddenName("rep_zero"), repLine);
+
+    // The first copy is already out; the loop starts ahead of it
+    auto bodyStart = out.end() - static_cast<std::ptrdiff_t>(first.size());
+    out.insert(bodyStart, {
+        makeNode("av", { { TokenType::IDENTIFIER, index, repLine }, { TokenType::LITERAL, std::to_string(iterations), repLine } }, repLine),
+        makeNode("dfp", { { TokenType::IDENTIFIER, top, repLine } }, repLine),
+    });
+
+    for (size_t copy = 1; copy < factor; copy++) {
+        lowerCopy(ast, rep, renames, false, out);
+    }
+
+    out.push_back(makeNode("dec", { { TokenType::IDENTIFIER, index, endLine } }, endLine));
+    out.push_back(makeNode("cgjmp", {
+        { TokenType::IDENTIFIER, index, endLine }, { TokenType::IDENTIFIER, zero, endLine },
+        { TokenType::IDENTIFIER, top, endLine }, { TokenType::IDENTIFIER, exit, endLine } }, endLine));
+    out.push_back(makeNode("dfp", { { TokenType::IDENTIFIER, exit, endLine } }, endLine));
+
+    for (size_t copy = 0; copy < remainder; copy++) {
+        lowerCopy(ast, rep, renames, false, out);
+    }
+}
+
+// One copy of the block body, with every label declared in it (nested blocks included) given
+// a name of its own
+void RepeatLowering::lowerCopy(const std::vector<InstructionNode>& ast, size_t rep, const Renames& renames,
+    bool declare, std::vector<InstructionNode>& out) {
+    Renames copyRenames = renames;
+    std::string suffix = hiddenSuffix("rep", copies++);
+
+    for (size_t i = rep + 1; i < ends[rep]; i++) {
+        if (ast[i].instruction.value != "dfp") continue;
+        const std::string& label = ast[i].operands[0].value;
+        auto outer = renames.find(label);
+        copyRenames[label] = (outer == renames.end() ? label : outer->second) + suffix;
+    }
+
+    lowerRange(ast, rep + 1, ends[rep], copyRenames, declare, out);
+}
+
+std::string RepeatLowering::hiddenVariable(const std::string& name, size_t line) {
+    if (!symbols.isVariable(name)) {
+        symbols.addVariable(name, Type::UI32);
+        declarations.push_back(makeNode("cv", { { TokenType::IDENTIFIER, name, line }, { TokenType::TYPE, "ui32", line } }, line));
+    }
+    return name;
+}
+
+void RepeatLowering::rename(InstructionNode& node, const Renames& renames) {
+    const std::string& inst = node.instruction.value;
+    size_t first;
+    if (inst == "dfp" || inst == "jmp" || inst == "call") {
+        first = 0;
+    } else if (ControlFlowGraph::isConditionalJump(node)) {
+        first = 2;
+    } else {
+        return;
+    }
+
+    for (size_t k = first; k < node.operands.size(); k++) {
+        auto it = renames.find(node.operands[k].value);
+        if (it != renames.end()) node.operands[k].value = it->second;
+    }
+}
+
+InstructionNode RepeatLowering::makeNode(const std::string& instruction, std::vector<Token> operands, size_t line) {
+    return { { TokenType::INSTRUCTION, instruction, line }, std::move(operands) };
+}
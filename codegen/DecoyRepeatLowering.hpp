@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DecoySymbolTable.hpp"
+
+// Lowers rep N ... endrep blocks (checked by SemanticAnalyzer::checkRepeatBlocks) into plain
+// instructions. Each block is unrolled by a factor bounded by maxUnroll and by the size of the
+// unrolled code:
+// - fully when all N copies fit, leaving no loop at all
+// - partially otherwise: a counted loop runs factor copies per iteration, and the remainder
+//   follows the loop
+// - into a plain counted loop when not even two copies fit, or maxUnroll is 1
+// Counted loops count a hidden ui32 down to zero, one per loop: a counter shared by loops at
+// the same depth would be reset by a loop in a subroutine called from another. A block with a
+// call that can lead back into the block, such as a recursive subroutine calling itself from
+// a rep, is always unrolled fully: its counter would be one variable shared by every active
+// call. Labels declared in a block are renamed in every copy, so jumps within a copy stay
+// within it.
+class RepeatLowering {
+    public:
+    static constexpr size_t DEFAULT_MAX_UNROLL = 8;
+
+    RepeatLowering(SymbolTable& symbols, size_t maxUnroll)
+        : symbols(symbols), maxUnroll(maxUnroll == 0 ? 1 : maxUnroll) {}
+
+    static bool hasRepeats(const std::vector<InstructionNode>& ast);
+
+    // Declares the hidden counters in the symbol table, with their cv at the start of the program
+    std::vector<InstructionNode> lower(const std::vector<InstructionNode>& ast);
+
+    private:
+    // Unrolling stops adding copies once the unrolled block would exceed this many instructions
+    static constexpr size_t MAX_UNROLLED_SIZE = 256;
+
+    // Source label name to its name in the copy being lowered
+    using Renames = std::unordered_map<std::string, std::string>;
+
+    SymbolTable& symbols;
+    size_t maxUnroll;
+    std::vector<size_t> ends; // Index of the matching endrep, for every rep
+    std::vector<char> reentered; // For every rep, whether a call inside its block can reach the block again
+    std::vector<InstructionNode> declarations;
+    size_t copies = 0;
+    size_t loops = 0;
+
+    void findReentered(const std::vector<InstructionNode>& ast);
+
+    void lowerRange(const std::vector<InstructionNode>& ast, size_t begin, size_t end, const Renames& renames,
+        bool declare, std::vector<InstructionNode>& out);
+    void lowerRepeat(const std::vector<InstructionNode>& ast, size_t rep, const Renames& renames,
+        bool declare, std::vector<InstructionNode>& out);
+    void lowerCopy(const std::vector<InstructionNode>& ast, size_t rep, const Renames& renames,
+        bool declare, std::vector<InstructionNode>& out);
+
+    std::string hiddenVariable(const std::string& name, size_t line);
+
+    static void rename(InstructionNode& node, const Renames& renames);
+    static InstructionNode makeNode(const std::string& instruction, std::vector<Token> operands, size_t line);
+};
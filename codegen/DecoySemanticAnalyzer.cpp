@@ -1,317 +1,466 @@
 #include "DecoySemanticAnalyzer.hpp"
+#include "DecoyWorkRanges.hpp"
+#include "DecoyControlFlow.hpp"
 
+#include <charconv>
+#include <cstdint>
 #include <sstream>
 
 void SemanticAnalyzer::analyze() {
-    firstPass();
-    secondPass();
+    Diagnostics errors;
+    if (!analyze(errors)) {
+        throw CompileError(errors.front().message, errors.front().line);
+    }
+}
+
+bool SemanticAnalyzer::analyze(Diagnostics& diagnostics) {
+    size_t reported = diagnostics.size();
+    firstPass(diagnostics);
+    secondPass(diagnostics);
+    checkRepeatBlocks(ast, diagnostics);
+    return diagnostics.size() == reported;
 }
 
-void SemanticAnalyzer::firstPass() {
+void SemanticAnalyzer::firstPass(Diagnostics& diagnostics) {
     for (const auto& node : ast) {
+        Status status;
         if (node.instruction.value == "cv") {
-            processCv(node);
+            status = processCv(node);
         } else if (node.instruction.value == "dfp") {
-            processDfp(node);
+            status = processDfp(node);
         }
+        report(diagnostics, node, status);
 
         currentAddress++;
     }
 }
 
-void SemanticAnalyzer::secondPass() {
-    for (const auto& node : ast) {
-        try {
-            if (node.instruction.value == "av") checkAv(node);
-            else if (node.instruction.value == "aav") checkAav(node);
-            else if (node.instruction.value == "sav") checkSav(node);
-            else if (node.instruction.value == "mav") checkMav(node);
-            else if (node.instruction.value == "dav") checkDav(node);
-            else if (node.instruction.value == "moav") checkMoav(node);
-            else if (node.instruction.value == "inc") checkInc(node);
-            else if (node.instruction.value == "dec") checkDec(node);
-            else if (node.instruction.value == "p") checkP(node);
-            else if (node.instruction.value == "pl") checkPl(node);
-            else if (node.instruction.value == "pk") checkPk(node);
-            else if (node.instruction.value == "rk") checkRk(node);
-            else if (node.instruction.value == "ikd") checkIkd(node);
-            else if (node.instruction.value == "mvm") checkMvm(node);
-            else if (node.instruction.value == "jmp") checkJmp(node);
-            else if (node.instruction.value == "cejmp") checkCejmp(node);
-            else if (node.instruction.value == "cgjmp") checkCgjmp(node);
-            else if (node.instruction.value == "cljmp") checkCljmp(node);
-            else if (node.instruction.value == "cegjmp") checkCegjmp(node);
-            else if (node.instruction.value == "celjmp") checkCeljmp(node);
-            else if (node.instruction.value == "dl") checkDl(node);
-        } catch (const std::exception& e) {
-            std::ostringstream ss;
-            ss << "At instruction " << node.instruction.value;
-            ss << " (line " << node.instruction.line << "): " << e.what();
-            throw std::runtime_error(ss.str());
+void SemanticAnalyzer::secondPass(Diagnostics& diagnostics) {
+    // Checks only read the symbol table; each range collects its own errors and the ranges
+    // are appended in order, so the errors come out in program order
+    WorkRanges ranges(ast.size(), threads, MIN_RANGE_SIZE);
+    std::vector<Diagnostics> found(ranges.size());
+    ranges.run([&](size_t range) {
+        for (size_t i = ranges.begin(range); i < ranges.end(range); i++) {
+            report(found[range], ast[i], checkInstruction(ast[i]));
         }
+    });
+
+    for (const auto& errors : found) {
+        diagnostics.append(errors);
     }
 }
 
-void SemanticAnalyzer::processCv(const InstructionNode& node) {
-    if (node.operands.size() != 2) throw error("cv requires 2 operands");
-    const auto& typeToken = node.operands[1];
-    if (typeToken.type != TokenType::TYPE) throw error("second operand must be a type");
+Status SemanticAnalyzer::checkInstruction(const InstructionNode& node) {
+    if (node.instruction.value == "av") return checkAv(node);
+    else if (node.instruction.value == "aav") return checkAav(node);
+    else if (node.instruction.value == "sav") return checkSav(node);
+    else if (node.instruction.value == "mav") return checkMav(node);
+    else if (node.instruction.value == "dav") return checkDav(node);
+    else if (node.instruction.value == "moav") return checkMoav(node);
+    else if (node.instruction.value == "inc") return checkInc(node);
+    else if (node.instruction.value == "dec") return checkDec(node);
+    else if (node.instruction.value == "p") return checkP(node);
+    else if (node.instruction.value == "pl") return checkPl(node);
+    else if (node.instruction.value == "pk") return checkPk(node);
+    else if (node.instruction.value == "rk") return checkRk(node);
+    else if (node.instruction.value == "ikd") return checkIkd(node);
+    else if (node.instruction.value == "mvm") return checkMvm(node);
+    else if (node.instruction.value == "jmp" || node.instruction.value == "call") return checkJmp(node);
+    else if (node.instruction.value == "cejmp") return checkCejmp(node);
+    else if (node.instruction.value == "cgjmp") return checkCgjmp(node);
+    else if (node.instruction.value == "cljmp") return checkCljmp(node);
+    else if (node.instruction.value == "cegjmp") return checkCegjmp(node);
+    else if (node.instruction.value == "celjmp") return checkCeljmp(node);
+    else if (node.instruction.value == "dl") return checkDl(node);
+    else if (node.instruction.value == "rep") return checkRep(node);
+    else if (node.instruction.value == "=") return checkAssignment(node);
+    return {};
+}
+
+void SemanticAnalyzer::checkRepeatBlocks(const std::vector<InstructionNode>& ast, Diagnostics& diagnostics) {
+    const size_t OUTSIDE = static_cast<size_t>(-1);
+
+    // Innermost block of every instruction (by the index of its rep) and each block's parent
+    std::vector<size_t> blockOf(ast.size(), OUTSIDE);
+    std::unordered_map<size_t, size_t> parents;
+    std::unordered_map<std::string, size_t> labelBlocks;
+    std::vector<size_t> open;
+    bool any = false;
+
+    for (size_t i = 0; i < ast.size(); i++) {
+        const std::string& inst = ast[i].instruction.value;
+        blockOf[i] = open.empty() ? OUTSIDE : open.back();
+
+        if (inst == "rep") {
+            parents[i] = blockOf[i];
+            open.push_back(i);
+            any = true;
+        } else if (inst == "endrep") {
+            if (open.empty()) {
+                report(diagnostics, ast[i], fail("endrep without a matching rep"));
+            } else {
+                open.pop_back();
+            }
+            any = true;
+        } else if (inst == "dfp") {
+            labelBlocks.emplace(ast[i].operands[0].value, blockOf[i]);
+        }
+    }
+    for (size_t rep : open) {
+        report(diagnostics, ast[rep], fail("rep without a matching endrep"));
+    }
+    if (!any) return;
+
+    auto encloses = [&](size_t block, size_t inner) {
+        for (; inner != OUTSIDE; inner = parents[inner]) {
+            if (inner == block) return true;
+        }
+        return block == OUTSIDE;
+    };
+
+    for (size_t i = 0; i < ast.size(); i++) {
+        if (!ControlFlowGraph::isJump(ast[i]) && !ControlFlowGraph::isCall(ast[i])) continue;
 
-    symbols.addVariable(node.operands[0].value, stringToType(typeToken.value));
+        size_t first = ControlFlowGraph::isConditionalJump(ast[i]) ? 2 : 0;
+        for (size_t k = first; k < ast[i].operands.size(); k++) {
+            auto label = labelBlocks.find(ast[i].operands[k].value);
+            if (label != labelBlocks.end() && !encloses(label->second, blockOf[i])) {
+                report(diagnostics, ast[i], fail("Label '" + label->first + "' is inside a rep block this jump is not in"));
+                break;
+            }
+        }
+    }
+}
+
+void SemanticAnalyzer::report(Diagnostics& diagnostics, const InstructionNode& node, const Status& status) {
+    if (status) return;
+
+    std::ostringstream ss;
+    ss << "At instruction " << node.instruction.value;
+    ss << " (line " << node.instruction.line << "): " << status.error();
+    diagnostics.error(node.instruction.line, ss.str());
+}
+
+Status SemanticAnalyzer::processCv(const InstructionNode& node) {
+    auto type = declaredType(node);
+    if (!type) return type.failure();
+    if (symbols.isVariable(node.operands[0].value)) return redeclaration(node);
+
+    symbols.addVariable(node.operands[0].value, *type);
+    return {};
 }
 
-void SemanticAnalyzer::processDfp(const InstructionNode& node) {
-    if (node.operands.size() != 1) throw error("dfp requires 1 operand");
+Status SemanticAnalyzer::processDfp(const InstructionNode& node) {
+    if (auto valid = checkLabelDeclaration(node); !valid) return valid;
+    if (symbols.isLabel(node.operands[0].value)) return redeclaration(node);
+
     symbols.addLabel(node.operands[0].value, currentAddress);
+    return {};
+}
+
+Expected<Type> SemanticAnalyzer::declaredType(const InstructionNode& cv) {
+    if (cv.operands.size() != 2) return fail("cv requires 2 operands");
+    const auto& typeToken = cv.operands[1];
+    if (typeToken.type != TokenType::TYPE) return fail("second operand must be a type");
+
+    return stringToType(typeToken.value);
+}
+
+Status SemanticAnalyzer::checkLabelDeclaration(const InstructionNode& dfp) {
+    if (dfp.operands.size() != 1) return fail("dfp requires 1 operand");
+    return {};
+}
+
+Failure SemanticAnalyzer::redeclaration(const InstructionNode& declaration) {
+    const char* kind = declaration.instruction.value == "cv" ? "variable" : "label";
+    return fail(std::string("Redeclaration of ") + kind + " '" + declaration.operands[0].value + "'");
 }
 
-void SemanticAnalyzer::checkAv(const InstructionNode& node) {
-    validateOperandCount(node, 2);
-    const auto& var = getVariable(node.operands[0]);
+Status SemanticAnalyzer::checkAv(const InstructionNode& node) {
+    if (auto count = validateOperandCount(node, 2); !count) return count;
+    auto var = getVariable(node.operands[0]);
+    if (!var) return var.failure();
     const auto& value = node.operands[1];
 
     if (value.type == TokenType::LITERAL) {
-        validateLiteral(value.value, var.type);
+        return validateLiteral(value.value, (*var)->type);
     } else if (value.type == TokenType::IDENTIFIER) {
-        const auto& srcVar = getVariable(value);
-        validateTypeMatch(var.type, srcVar.type);
-    } else {
-        throw error("Invalid operand type for av");
+        auto srcVar = getVariable(value);
+        if (!srcVar) return srcVar.failure();
+        return validateTypeMatch((*var)->type, (*srcVar)->type);
     }
+    return fail("Invalid operand type for av");
 }
 
-void SemanticAnalyzer::checkJmp(const InstructionNode& node) {
-    validateOperandCount(node, 1);
-    auto _ = symbols.getLabelAddress(node.operands[0].value);
+Status SemanticAnalyzer::checkJmp(const InstructionNode& node) {
+    if (auto count = validateOperandCount(node, 1); !count) return count;
+    return validateLabel(node.operands[0]);
 }
 
-void SemanticAnalyzer::checkAav(const InstructionNode& node) {
-    validateArithmeticOp(node, "AAV");
+Status SemanticAnalyzer::checkAav(const InstructionNode& node) {
+    return validateArithmeticOp(node, "AAV");
 }
 
-void SemanticAnalyzer::checkSav(const InstructionNode& node) {
-    validateArithmeticOp(node, "SAV");
+Status SemanticAnalyzer::checkSav(const InstructionNode& node) {
+    return validateArithmeticOp(node, "SAV");
 }
 
-void SemanticAnalyzer::checkMav(const InstructionNode& node) {
-    validateArithmeticOp(node, "MAV");
+Status SemanticAnalyzer::checkMav(const InstructionNode& node) {
+    return validateArithmeticOp(node, "MAV");
 }
 
-void SemanticAnalyzer::checkDav(const InstructionNode& node) {
-    validateArithmeticOp(node, "DAV");
+Status SemanticAnalyzer::checkDav(const InstructionNode& node) {
+    return validateArithmeticOp(node, "DAV");
 }
 
-void SemanticAnalyzer::checkMoav(const InstructionNode& node) {
-    validateArithmeticOp(node, "MOAV");
+Status SemanticAnalyzer::checkMoav(const InstructionNode& node) {
+    return validateArithmeticOp(node, "MOAV");
 }
 
-void SemanticAnalyzer::validateArithmeticOp(const InstructionNode& node, const std::string& op) {
-    validateOperandCount(node, 2);
-    const auto& varInfo = getVariable(node.operands[0]);
+Status SemanticAnalyzer::validateArithmeticOp(const InstructionNode& node, const std::string& op) {
+    if (auto count = validateOperandCount(node, 2); !count) return count;
+    auto varInfo = getVariable(node.operands[0]);
+    if (!varInfo) return varInfo.failure();
     const Token& operand = node.operands[1];
 
     if (operand.type == TokenType::LITERAL) {
-        validateLiteral(operand.value, varInfo.type);
+        return validateLiteral(operand.value, (*varInfo)->type);
     } else if (operand.type == TokenType::IDENTIFIER) {
-        const auto& srcVar = getVariable(operand);
-        validateTypeMatch(varInfo.type, srcVar.type);
-    } else {
-        throw error("Invalid operand type for " + op);
+        auto srcVar = getVariable(operand);
+        if (!srcVar) return srcVar.failure();
+        return validateTypeMatch((*varInfo)->type, (*srcVar)->type);
     }
+    return fail("Invalid operand type for " + op);
 }
 
-void SemanticAnalyzer::checkInc(const InstructionNode& node) {
-    validateIncDec(node);
+Status SemanticAnalyzer::checkInc(const InstructionNode& node) {
+    return validateIncDec(node);
 }
 
-void SemanticAnalyzer::checkDec(const InstructionNode& node) {
-    validateIncDec(node);
+Status SemanticAnalyzer::checkDec(const InstructionNode& node) {
+    return validateIncDec(node);
 }
 
-void SemanticAnalyzer::validateIncDec(const InstructionNode& node) {
-    validateOperandCount(node, 1);
-    getVariable(node.operands[0]);
+Status SemanticAnalyzer::validateIncDec(const InstructionNode& node) {
+    if (auto count = validateOperandCount(node, 1); !count) return count;
+    if (auto var = getVariable(node.operands[0]); !var) return var.failure();
+    return {};
 }
 
-void SemanticAnalyzer::checkP(const InstructionNode& node) {
-    validatePrint(node);
+Status SemanticAnalyzer::checkP(const InstructionNode& node) {
+    return validatePrint(node);
 }
 
-void SemanticAnalyzer::checkPl(const InstructionNode& node) {
-    validatePrint(node);
+Status SemanticAnalyzer::checkPl(const InstructionNode& node) {
+    return validatePrint(node);
 }
 
-void SemanticAnalyzer::validatePrint(const InstructionNode& node) {
+Status SemanticAnalyzer::validatePrint(const InstructionNode& node) {
+    if (node.operands.size() > 255) {
+        return fail("Print instruction takes at most 255 operands");
+    }
     for (const auto& operand : node.operands) {
         if (operand.type != TokenType::STRING && operand.type != TokenType::IDENTIFIER) {
-            throw error("Print operands must be string literals or variables");
+            return fail("Print operands must be string literals or variables");
         }
         if (operand.type == TokenType::IDENTIFIER) {
-            getVariable(operand);
+            if (auto var = getVariable(operand); !var) return var.failure();
         }
     }
+    return {};
 }
 
-void SemanticAnalyzer::checkPk(const InstructionNode& node) {
-    validateKeyOp(node);
+Status SemanticAnalyzer::checkPk(const InstructionNode& node) {
+    return validateKeyOp(node);
 }
 
-void SemanticAnalyzer::checkRk(const InstructionNode& node) {
-    validateKeyOp(node);
+Status SemanticAnalyzer::checkRk(const InstructionNode& node) {
+    return validateKeyOp(node);
 }
 
-void SemanticAnalyzer::validateKeyOp(const InstructionNode& node) {
-    validateOperandCount(node, 1);
+Status SemanticAnalyzer::validateKeyOp(const InstructionNode& node) {
+    if (auto count = validateOperandCount(node, 1); !count) return count;
     const Token& operand = node.operands[0];
 
     if (operand.type == TokenType::LITERAL) {
-        validateUI8(operand.value);
+        return validateLiteral(operand.value, Type::UI8);
     } else if (operand.type == TokenType::IDENTIFIER) {
-        const auto& var = getVariable(operand);
-        validateTypeMatch(var.type, var.type);
-    } else {
-        throw error("Key operation requires UI8 literal or variable");
+        if (auto var = getVariable(operand); !var) return var.failure();
+        return {};
     }
+    return fail("Key operation requires UI8 literal or variable");
 }
 
-void SemanticAnalyzer::checkIkd(const InstructionNode& node) {
-    validateOperandCount(node, 2);
-    getVariable(node.operands[0]);
-    const auto& resVar = getVariable(node.operands[1]);
-    validateTypeMatch(Type::UI8, resVar.type);
+Status SemanticAnalyzer::checkIkd(const InstructionNode& node) {
+    if (auto count = validateOperandCount(node, 2); !count) return count;
+    if (auto var = getVariable(node.operands[0]); !var) return var.failure();
+    auto resVar = getVariable(node.operands[1]);
+    if (!resVar) return resVar.failure();
+    return validateTypeMatch(Type::UI8, (*resVar)->type);
 }
 
-void SemanticAnalyzer::checkMvm(const InstructionNode& node) {
-    validateOperandCount(node, 2);
+Status SemanticAnalyzer::checkMvm(const InstructionNode& node) {
+    if (auto count = validateOperandCount(node, 2); !count) return count;
     for (const auto& operand : node.operands) {
+        Status status;
         if (operand.type == TokenType::LITERAL) {
-            validateI32(operand.value);
+            status = validateLiteral(operand.value, Type::I32);
         } else if (operand.type == TokenType::IDENTIFIER) {
-            const auto& var = getVariable(operand);
-            validateTypeMatch(Type::I32, var.type);
+            auto var = getVariable(operand);
+            if (!var) return var.failure();
+            status = validateTypeMatch(Type::I32, (*var)->type);
         } else {
-            throw error("mvm operands must be I32 literals or variables");
+            status = fail("mvm operands must be I32 literals or variables");
         }
+        if (!status) return status;
     }
+    return {};
 }
 
-void SemanticAnalyzer::checkCejmp(const InstructionNode& node) {
-    validateConditionalJump(node);
+Status SemanticAnalyzer::checkCejmp(const InstructionNode& node) {
+    return validateConditionalJump(node);
 }
 
-void SemanticAnalyzer::checkCgjmp(const InstructionNode& node) {
-    validateConditionalJump(node);
+Status SemanticAnalyzer::checkCgjmp(const InstructionNode& node) {
+    return validateConditionalJump(node);
 }
 
-void SemanticAnalyzer::checkCljmp(const InstructionNode& node) {
-    validateConditionalJump(node);
+Status SemanticAnalyzer::checkCljmp(const InstructionNode& node) {
+    return validateConditionalJump(node);
 }
 
-void SemanticAnalyzer::checkCegjmp(const InstructionNode& node) {
-    validateConditionalJump(node);
+Status SemanticAnalyzer::checkCegjmp(const InstructionNode& node) {
+    return validateConditionalJump(node);
 }
 
-void SemanticAnalyzer::checkCeljmp(const InstructionNode& node) {
-    validateConditionalJump(node);
+Status SemanticAnalyzer::checkCeljmp(const InstructionNode& node) {
+    return validateConditionalJump(node);
 }
 
-void SemanticAnalyzer::validateConditionalJump(const InstructionNode& node) {
-    validateOperandCount(node, 4);
-    getVariable(node.operands[0]);
-    getVariable(node.operands[1]);
-    auto _ = symbols.getLabelAddress(node.operands[2].value);
-    _ = symbols.getLabelAddress(node.operands[3].value);
+Status SemanticAnalyzer::validateConditionalJump(const InstructionNode& node) {
+    if (auto count = validateOperandCount(node, 4); !count) return count;
+    if (auto var = getVariable(node.operands[0]); !var) return var.failure();
+    if (auto var = getVariable(node.operands[1]); !var) return var.failure();
+    if (auto label = validateLabel(node.operands[2]); !label) return label;
+    return validateLabel(node.operands[3]);
 }
 
-void SemanticAnalyzer::checkDl(const InstructionNode& node) {
-    validateOperandCount(node, 1);
+Status SemanticAnalyzer::checkDl(const InstructionNode& node) {
+    if (auto count = validateOperandCount(node, 1); !count) return count;
     const Token& operand = node.operands[0];
 
     if (operand.type == TokenType::LITERAL) {
-        validateUI32(operand.value);
+        return validateLiteral(operand.value, Type::UI32);
     } else if (operand.type == TokenType::IDENTIFIER) {
-        const auto& var = getVariable(operand);
-        validateTypeMatch(Type::UI32, var.type);
-    } else {
-        throw error("dl requires UI32 literal or variable");
+        auto var = getVariable(operand);
+        if (!var) return var.failure();
+        return validateTypeMatch(Type::UI32, (*var)->type);
     }
+    return fail("dl requires UI32 literal or variable");
 }
 
-void SemanticAnalyzer::validateI16(const std::string& literal) {
-    int value = std::stoi(literal);
-    if (value < -32768 || value > 32767) throw std::out_of_range("");
-}
-
-void SemanticAnalyzer::validateUI16(const std::string& literal) {
-    unsigned long value = std::stoul(literal);
-    if (value > 65535) throw std::out_of_range("");
+Status SemanticAnalyzer::checkRep(const InstructionNode& node) {
+    if (auto count = validateOperandCount(node, 1); !count) return count;
+    return validateLiteral(node.operands[0].value, Type::UI32);
 }
 
-void SemanticAnalyzer::validateI32(const std::string& literal) {
-    long value = std::stol(literal);
-    if (value < -2147483648L || value > 2147483647L) throw std::out_of_range("");
-}
+// Every operand of an expression has the assigned variable's type, as with aav and the others,
+// so the whole expression computes in that type
+Status SemanticAnalyzer::checkAssignment(const InstructionNode& node) {
+    if (node.operands.size() < 2) return fail("Expected an expression");
+    auto var = getVariable(node.operands[0]);
+    if (!var) return var.failure();
+    Type type = (*var)->type;
+    if (type == Type::NT || type == Type::STR) return fail("Expressions need a numeric variable");
 
-void SemanticAnalyzer::validateUI32(const std::string& literal) {
-    unsigned long value = std::stoul(literal);
-    if (value > 4294967295UL) throw std::out_of_range("");
+    // Values on the postfix stack, so a malformed expression cannot reach the lowering
+    size_t depth = 0;
+    for (size_t i = 1; i < node.operands.size(); i++) {
+        const Token& operand = node.operands[i];
+        if (operand.type == TokenType::LITERAL) {
+            if (auto literal = validateLiteral(operand.value, type); !literal) return literal;
+            depth++;
+        } else if (operand.type == TokenType::IDENTIFIER) {
+            auto srcVar = getVariable(operand);
+            if (!srcVar) return srcVar.failure();
+            if (auto match = validateTypeMatch(type, (*srcVar)->type); !match) return match;
+            depth++;
+        } else if (operand.type == TokenType::OPERATOR && operand.value == "neg") {
+            if (depth < 1) return fail("Malformed expression");
+        } else if (operand.type == TokenType::OPERATOR) {
+            if (depth < 2) return fail("Malformed expression");
+            depth--;
+        } else {
+            return fail("Invalid operand in expression");
+        }
+    }
+    if (depth != 1) return fail("Malformed expression");
+    return {};
 }
 
-void SemanticAnalyzer::validateOperandCount(const InstructionNode& node, size_t expected) {
+Status SemanticAnalyzer::validateOperandCount(const InstructionNode& node, size_t expected) {
     if (node.operands.size() != expected) {
-        throw error("Expected " + std::to_string(expected) + " operands");
+        return fail("Expected " + std::to_string(expected) + " operands");
     }
+    return {};
 }
 
-void SemanticAnalyzer::validateTypeMatch(Type expected, Type actual) {
+Status SemanticAnalyzer::validateTypeMatch(Type expected, Type actual) {
     if (expected != actual) {
-        throw error("Type mismatch: expected " + typeToString(expected) + ", got " + typeToString(actual));
+        return fail("Type mismatch: expected " + typeToString(expected) + ", got " + typeToString(actual));
     }
+    return {};
 }
 
-void SemanticAnalyzer::validateLiteral(const std::string& literal, Type type) {
-    try {
-        switch (type) {
-            case Type::I8:  validateI8(literal); break;
-            case Type::UI8: validateUI8(literal); break;
-            case Type::I16: validateI16(literal); break;
-            case Type::UI16: validateUI16(literal); break;
-            case Type::I32: validateI32(literal); break;
-            case Type::UI32: validateUI32(literal); break;
-            case Type::F32: validateF32(literal); break;
-            default: throw error("Invalid type for literal assignment");
-        }
-    } catch (const std::exception&) {
-        throw error("Value " + literal + " out of range for type " + typeToString(type));
+Status SemanticAnalyzer::validateLabel(const Token& token) {
+    if (!symbols.isLabel(token.value)) {
+        return fail("Undefined label '" + token.value + "'");
     }
+    return {};
 }
 
-void SemanticAnalyzer::validateI8(const std::string& literal) {
-    int value = std::stoi(literal);
-    if (value < -128 || value > 127) throw std::out_of_range("");
-}
-
-void SemanticAnalyzer::validateUI8(const std::string& literal) {
-    unsigned long value = std::stoul(literal);
-    if (value > 255) throw std::out_of_range("");
-}
+Status SemanticAnalyzer::validateLiteral(const std::string& literal, Type type) {
+    const char* begin = literal.data();
+    const char* end = begin + literal.size();
 
-void SemanticAnalyzer::validateF32(const std::string& literal) {
-    auto _ = std::stof(literal); // Just check parsing
-}
+    bool valid = false;
+    if (type == Type::F32) {
+        float value;
+        auto [ptr, ec] = std::from_chars(begin, end, value);
+        valid = ec == std::errc() && ptr == end;
+    } else {
+        static const std::unordered_map<Type, std::pair<int64_t, int64_t>> ranges = {
+            {Type::I8, {INT8_MIN, INT8_MAX}}, {Type::UI8, {0, UINT8_MAX}},
+            {Type::I16, {INT16_MIN, INT16_MAX}}, {Type::UI16, {0, UINT16_MAX}},
+            {Type::I32, {INT32_MIN, INT32_MAX}}, {Type::UI32, {0, UINT32_MAX}},
+        };
+        auto range = ranges.find(type);
+        if (range == ranges.end()) return fail("Invalid type for literal assignment");
+
+        int64_t value;
+        auto [ptr, ec] = std::from_chars(begin, end, value);
+        valid = ec == std::errc() && ptr == end && value >= range->second.first && value <= range->second.second;
+    }
 
-std::runtime_error SemanticAnalyzer::error(const std::string& msg) {
-    return std::runtime_error(msg);
+    if (!valid) {
+        return fail("Value " + literal + " out of range for type " + typeToString(type));
+    }
+    return {};
 }
 
-const VariableInfo& SemanticAnalyzer::getVariable(const Token& token) {
+Expected<const VariableInfo*> SemanticAnalyzer::getVariable(const Token& token) {
     if (token.type != TokenType::IDENTIFIER) {
-        throw error("Expected variable identifier");
+        return fail("Expected variable identifier");
+    }
+    const VariableInfo* var = symbols.findVariable(token.value);
+    if (!var) {
+        return fail("Undefined variable '" + token.value + "'");
     }
-    return symbols.getVariable(token.value);
+    return var;
 }
 
-Type SemanticAnalyzer::stringToType(const std::string& str) {
+Expected<Type> SemanticAnalyzer::stringToType(const std::string& str) {
     static const std::unordered_map<std::string, Type> typeMap = {
         {"i8", Type::I8}, {"ui8", Type::UI8},
         {"i16", Type::I16}, {"ui16", Type::UI16},
@@ -319,7 +468,7 @@ Type SemanticAnalyzer::stringToType(const std::string& str) {
         {"f32", Type::F32}
     };
     auto it = typeMap.find(str);
-    if (it == typeMap.end()) throw std::runtime_error("Invalid type specifier");
+    if (it == typeMap.end()) return fail("Invalid type specifier");
     return it->second;
 }
 
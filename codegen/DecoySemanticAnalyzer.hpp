@@ -7,74 +7,99 @@ class SemanticAnalyzer {
     SemanticAnalyzer(SymbolTable& symbols, const std::vector<InstructionNode>& ast)
         : symbols(symbols), ast(ast) {}
 
+    // Throws a CompileError for the first error: declaration errors first, then instruction
+    // errors in program order
     void analyze();
 
+    // Reports every error, in the same order analyze() would consider them, instead of
+    // throwing. Returns false if anything was reported.
+    bool analyze(Diagnostics& diagnostics);
+
+    // Declarations are collected serially; the per-instruction checks then run across this many threads
+    void setThreads(size_t count) { threads = count; }
+
+    // One instruction at a time, for callers that keep the symbol table up to date themselves
+    // (ScriptDocument). declaredType and checkLabelDeclaration validate a cv or dfp without
+    // declaring anything; redeclaration is the error for a second declaration of the same name.
+    static Expected<Type> declaredType(const InstructionNode& cv);
+    static Status checkLabelDeclaration(const InstructionNode& dfp);
+    static Failure redeclaration(const InstructionNode& declaration);
+    Status checkInstruction(const InstructionNode& node);
+
+    // Reports an error with the instruction and line it was raised for
+    static void report(Diagnostics& diagnostics, const InstructionNode& node, const Status& status);
+
+    // rep/endrep pairing, and jumps to a label inside a rep block from outside that block,
+    // which has no meaning once the block is unrolled. Needs the whole program; analyze()
+    // runs it last.
+    static void checkRepeatBlocks(const std::vector<InstructionNode>& ast, Diagnostics& diagnostics);
+
     private:
+    // Ranges smaller than this are not worth a thread
+    static constexpr size_t MIN_RANGE_SIZE = 16384;
+
     SymbolTable& symbols;
     const std::vector<InstructionNode>& ast;
     size_t currentAddress = 0;
+    size_t threads = 1;
+
+    void firstPass(Diagnostics& diagnostics);
+    void secondPass(Diagnostics& diagnostics);
+
+    Status processCv(const InstructionNode& node);
+    Status processDfp(const InstructionNode& node);
 
-    void firstPass();
-    void secondPass();
+    Status checkAv(const InstructionNode& node);
+    Status checkJmp(const InstructionNode& node);
+    Status checkAav(const InstructionNode& node);
+    Status checkSav(const InstructionNode& node);
+    Status checkMav(const InstructionNode& node);
+    Status checkDav(const InstructionNode& node);
+    Status checkMoav(const InstructionNode& node);
 
-    void processCv(const InstructionNode& node);
-    void processDfp(const InstructionNode& node);
-    
-    void checkAv(const InstructionNode& node);
-    void checkJmp(const InstructionNode& node);
-    void checkAav(const InstructionNode& node);
-    void checkSav(const InstructionNode& node);
-    void checkMav(const InstructionNode& node);
-    void checkDav(const InstructionNode& node);
-    void checkMoav(const InstructionNode& node);
+    Status validateArithmeticOp(const InstructionNode& node, const std::string& op);
 
-    void validateArithmeticOp(const InstructionNode& node, const std::string& op);
+    Status checkInc(const InstructionNode& node);
+    Status checkDec(const InstructionNode& node);
 
-    void checkInc(const InstructionNode& node);
-    void checkDec(const InstructionNode& node);
+    Status validateIncDec(const InstructionNode& node);
 
-    void validateIncDec(const InstructionNode& node);
+    Status checkP(const InstructionNode& node);
+    Status checkPl(const InstructionNode& node);
 
-    void checkP(const InstructionNode& node);
-    void checkPl(const InstructionNode& node);
+    Status validatePrint(const InstructionNode& node);
 
-    void validatePrint(const InstructionNode& node);
+    Status checkPk(const InstructionNode& node);
+    Status checkRk(const InstructionNode& node);
 
-    void checkPk(const InstructionNode& node);
-    void checkRk(const InstructionNode& node);
+    Status validateKeyOp(const InstructionNode& node);
 
-    void validateKeyOp(const InstructionNode& node);
+    Status checkIkd(const InstructionNode& node);
 
-    void checkIkd(const InstructionNode& node);
+    Status checkMvm(const InstructionNode& node);
 
-    void checkMvm(const InstructionNode& node);
+    Status checkCejmp(const InstructionNode& node);
+    Status checkCgjmp(const InstructionNode& node);
+    Status checkCljmp(const InstructionNode& node);
+    Status checkCegjmp(const InstructionNode& node);
+    Status checkCeljmp(const InstructionNode& node);
 
-    void checkCejmp(const InstructionNode& node);
-    void checkCgjmp(const InstructionNode& node);
-    void checkCljmp(const InstructionNode& node);
-    void checkCegjmp(const InstructionNode& node);
-    void checkCeljmp(const InstructionNode& node);
+    Status validateConditionalJump(const InstructionNode& node);
 
-    void validateConditionalJump(const InstructionNode& node);
+    Status checkDl(const InstructionNode& node);
+    Status checkRep(const InstructionNode& node);
+    Status checkAssignment(const InstructionNode& node);
 
-    void checkDl(const InstructionNode& node);
-    
-    void validateOperandCount(const InstructionNode& node, size_t expected);
-    void validateTypeMatch(Type expected, Type actual);
-    void validateLiteral(const std::string& literal, Type type);
-    void validateI8(const std::string& literal);
-    void validateUI8(const std::string& literal);
-    void validateI16(const std::string& literal);
-    void validateUI16(const std::string& literal);
-    void validateI32(const std::string& literal);
-    void validateUI32(const std::string& literal);
-    void validateF32(const std::string& literal);
+    Status validateOperandCount(const InstructionNode& node, size_t expected);
+    Status validateTypeMatch(Type expected, Type actual);
+    Status validateLabel(const Token& token);
 
-    std::runtime_error error(const std::string& msg);
+    // Parses the whole literal with from_chars, so "1.5" or "-5" never pass as a ui32
+    static Status validateLiteral(const std::string& literal, Type type);
 
-    const VariableInfo& getVariable(const Token& token);
+    Expected<const VariableInfo*> getVariable(const Token& token);
 
-    static Type stringToType(const std::string& str);
+    static Expected<Type> stringToType(const std::string& str);
 
     static std::string typeToString(Type type);
-};
\ No newline at end of file
+};
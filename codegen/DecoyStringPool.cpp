@@ -0,0 +1,228 @@
+#include "DecoyStringPool.hpp"
+#include "DecoyBytecode.hpp"
+#include "DecoyLineTable.hpp"
+#include "DecoyLittleEndian.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+static const char POOL_MAGIC[4] = { 'D', 'S', 'P', '1' };
+
+std::vector<uint8_t> StringPool::encode() const {
+    std::vector<uint8_t> out(POOL_MAGIC, POOL_MAGIC + sizeof(POOL_MAGIC));
+    writeUI32(out, static_cast<uint32_t>(strings.size()));
+    for (const auto& text : strings) {
+        writeUI32(out, static_cast<uint32_t>(text.size()));
+        out.insert(out.end(), text.begin(), text.end());
+    }
+    return out;
+}
+
+StringPool StringPool::decode(std::span<const uint8_t> data) {
+    if (data.size() < 8 || !std::equal(POOL_MAGIC, POOL_MAGIC + sizeof(POOL_MAGIC), data.begin())) {
+        throw std::runtime_error("Not a string pool");
+    }
+
+    StringPool pool;
+    uint32_t count = readUI32(data, 4);
+    size_t pos = 8;
+    for (uint32_t i = 0; i < count; i++) {
+        if (data.size() - pos < 4) throw std::runtime_error("String pool is truncated");
+        uint32_t length = readUI32(data, pos);
+        pos += 4;
+        if (data.size() - pos < length) throw std::runtime_error("String pool is truncated");
+        pool.strings.emplace_back(reinterpret_cast<const char*>(data.data() + pos), length);
+        pos += length;
+    }
+    if (pos != data.size()) throw std::runtime_error("String pool has trailing bytes");
+
+    return pool;
+}
+
+namespace {
+    struct DecodedModule {
+        std::vector<DecodedInstruction> instructions;
+        std::vector<std::vector<OperandSlot>> slots; // Per instruction
+    };
+
+    bool isPrint(Instruction opcode) {
+        return opcode == Instruction::P || opcode == Instruction::PL;
+    }
+
+    // Re-encodes a module with pooled print strings replaced by their index. Everything else is
+    // copied byte for byte, a slot at a time, except jump targets, which move with the
+    // instructions they point at.
+    std::vector<uint8_t> rewriteModule(const std::vector<uint8_t>& bytecode, const DecodedModule& module,
+        const std::unordered_map<std::string, uint32_t>& pooled, std::vector<size_t>& newAddresses) {
+        const auto& instructions = module.instructions;
+
+        newAddresses.resize(instructions.size() + 1);
+        std::unordered_map<size_t, size_t> moved;
+        size_t address = 0;
+        for (size_t i = 0; i < instructions.size(); i++) {
+            newAddresses[i] = address;
+            moved[instructions[i].address] = address;
+
+            size_t size = instructions[i].size;
+            if (isPrint(instructions[i].opcode)) {
+                for (const auto& operand : instructions[i].operands) {
+                    if (operand.kind == OperandKind::STRING && pooled.contains(operand.text)) size -= operand.text.size();
+                }
+            }
+            address += size;
+        }
+        newAddresses[instructions.size()] = address;
+        moved[bytecode.size()] = address;
+
+        std::vector<uint8_t> out;
+        out.reserve(address);
+        for (size_t i = 0; i < instructions.size(); i++) {
+            const auto& instruction = instructions[i];
+            const InstructionInfo* info = findInstructionInfo(static_cast<uint8_t>(instruction.opcode));
+            size_t src = instruction.address;
+            auto copy = [&](size_t size) {
+                out.insert(out.end(), bytecode.begin() + src, bytecode.begin() + src + size);
+                src += size;
+            };
+
+            copy(1);
+            for (size_t s = 0; s < info->layout.size(); s++) {
+                const OperandSlot& slot = module.slots[i][s];
+                if (info->layout[s] == OperandLayout::LABEL) {
+                    auto target = moved.find(instruction.operands[slot.firstOperand].value);
+                    if (target == moved.end()) {
+                        throw std::runtime_error("Jump at offset " + std::to_string(instruction.address) + " does not land on an instruction");
+                    }
+                    writeUI32(out, static_cast<uint32_t>(target->second));
+                    src += slot.size;
+                } else if (info->layout[s] == OperandLayout::PRINT_LIST) {
+                    copy(1);
+                    for (size_t item = 0; item < slot.operandCount; item++) {
+                        const auto& decoded = instruction.operands[slot.firstOperand + item];
+                        auto index = decoded.kind == OperandKind::STRING ? pooled.find(decoded.text) : pooled.end();
+                        if (index == pooled.end()) {
+                            copy(decoded.size);
+                        } else {
+                            out.push_back(POOLED_STRING_TAG);
+                            writeUI32(out, index->second);
+                            src += decoded.size;
+                        }
+                    }
+                } else {
+                    copy(slot.size);
+                }
+            }
+        }
+
+        return out;
+    }
+
+    std::vector<uint8_t> moveLineTable(const std::vector<uint8_t>& encoded, const DecodedModule& module, const std::vector<size_t>& newAddresses) {
+        auto table = LineTable::decode(encoded);
+        const auto& instructions = module.instructions;
+
+        LineTable moved(table.hasColumns());
+        for (const auto& entry : table.getEntries()) {
+            // Entries sit on instruction starts; anything else keeps its distance into the instruction
+            auto it = std::upper_bound(instructions.begin(), instructions.end(), entry.address,
+                [](size_t address, const DecodedInstruction& instruction) { return address < instruction.address; });
+            size_t index = it == instructions.begin() ? 0 : static_cast<size_t>(it - instructions.begin()) - 1;
+            size_t address = newAddresses[index];
+            if (index < instructions.size()) {
+                address += std::min<size_t>(entry.address - instructions[index].address, newAddresses[index + 1] - newAddresses[index]);
+            }
+            moved.add(address, entry.line, entry.column);
+        }
+        return moved.encode();
+    }
+}
+
+StringPool poolSharedStrings(std::span<const PoolableModule> modules, size_t minModules, PoolingStats* stats) {
+    std::vector<DecodedModule> decoded(modules.size());
+
+    // Byte-identical modules are stored once in indexed archives (see writeIndexedArchive), so they count as one
+    // module here and are rewritten from the first copy's decoding
+    std::vector<size_t> copyOf(modules.size());
+    for (size_t m = 0; m < modules.size(); m++) {
+        copyOf[m] = m;
+        for (size_t other = 0; other < m && copyOf[m] == m; other++) {
+            if (copyOf[other] == other && *modules[other].bytecode == *modules[m].bytecode) copyOf[m] = other;
+        }
+    }
+
+    // Count the modules each print string appears in, and its occurrences overall
+    struct Usage {
+        size_t modules = 0;
+        size_t occurrences = 0;
+    };
+    std::unordered_map<std::string, Usage> usage;
+    std::vector<std::string> order;
+    for (size_t m = 0; m < modules.size(); m++) {
+        if (copyOf[m] != m) continue;
+
+        BytecodeReader reader(*modules[m].bytecode);
+        std::unordered_set<std::string> seen;
+        while (!reader.isAtEnd()) {
+            decoded[m].slots.emplace_back();
+            decoded[m].instructions.push_back(reader.next(&decoded[m].slots.back()));
+
+            const auto& instruction = decoded[m].instructions.back();
+            if (!isPrint(instruction.opcode)) continue;
+            for (const auto& operand : instruction.operands) {
+                if (operand.kind == OperandKind::POOLED_STRING) {
+                    throw std::runtime_error("Module already refers to a string pool");
+                }
+                if (operand.kind != OperandKind::STRING) continue;
+
+                auto [it, added] = usage.try_emplace(operand.text);
+                if (added) order.push_back(operand.text);
+                it->second.occurrences++;
+                if (seen.insert(operand.text).second) it->second.modules++;
+            }
+        }
+    }
+
+    // Inline copies cost their length beyond the pooled form; the pool pays length + 4 once
+    StringPool pool;
+    std::unordered_map<std::string, uint32_t> pooled;
+    size_t saved = 0;
+    for (const auto& text : order) {
+        const auto& use = usage[text];
+        if (use.modules < std::max<size_t>(minModules, 1) || use.occurrences * text.size() <= text.size() + 4) continue;
+
+        pooled[text] = static_cast<uint32_t>(pool.strings.size());
+        pool.strings.push_back(text);
+        saved += use.occurrences * text.size() - (text.size() + 4);
+    }
+
+    size_t rewritten = 0;
+    if (!pool.empty()) {
+        for (size_t m = 0; m < modules.size(); m++) {
+            const auto& source = decoded[copyOf[m]];
+            bool uses = false;
+            for (const auto& instruction : source.instructions) {
+                if (!isPrint(instruction.opcode)) continue;
+                for (const auto& operand : instruction.operands) {
+                    uses = uses || (operand.kind == OperandKind::STRING && pooled.contains(operand.text));
+                }
+            }
+            if (!uses) continue;
+
+            std::vector<size_t> newAddresses;
+            auto bytecode = rewriteModule(*modules[m].bytecode, source, pooled, newAddresses);
+            if (modules[m].lineTable && !modules[m].lineTable->empty()) {
+                *modules[m].lineTable = moveLineTable(*modules[m].lineTable, source, newAddresses);
+            }
+            *modules[m].bytecode = std::move(bytecode);
+            rewritten++;
+        }
+        saved = saved > 8 ? saved - 8 : 0; // Pool header
+    }
+
+    if (stats) {
+        *stats = { pool.strings.size(), rewritten, saved };
+    }
+    return pool;
+}
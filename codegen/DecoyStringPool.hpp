@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Archive-level pool of print strings shared by several modules. A pooled string is written
+// once, in the pool entry, and each print list that used it refers to it by index
+// ([POOLED_STRING_TAG][4-byte index]) instead of carrying its own copy.
+//
+// Encoding:
+//   [4-byte magic "DSP1"][4-byte count]
+//   per string: [4-byte length][bytes]
+class StringPool {
+    public:
+    static constexpr const char* ENTRY_NAME = "str";
+
+    std::vector<std::string> strings;
+
+    std::vector<uint8_t> encode() const;
+    static StringPool decode(std::span<const uint8_t> data);
+
+    bool empty() const { return strings.empty(); }
+};
+
+// A module taking part in pooling; lineTable may be null or empty when the module has none
+struct PoolableModule {
+    std::vector<uint8_t>* bytecode;
+    std::vector<uint8_t>* lineTable;
+};
+
+struct PoolingStats {
+    size_t pooledStrings = 0;
+    size_t rewrittenModules = 0;
+    size_t savedBytes = 0; // Bytecode bytes removed, minus the size of the pool entry
+};
+
+// Moves every print string that appears in at least minModules of the modules, and takes fewer
+// bytes pooled than inline, into the returned pool. Affected modules are re-encoded in place
+// with their jump targets and line table addresses moved to match.
+StringPool poolSharedStrings(std::span<const PoolableModule> modules, size_t minModules, PoolingStats* stats = nullptr);
@@ -1,5 +1,7 @@
 #include "DecoySymbolTable.hpp"
 
+#include <algorithm>
+
 void SymbolTable::addVariable(const std::string& name, Type type) {
     if (variables.count(name)) {
         throw std::runtime_error("Redeclaration of variable '" + name + "'");
@@ -11,9 +13,38 @@ void SymbolTable::addVariable(const std::string& name, Type type) {
         .size = size,
         .offset = currentOffset
     };
+    declarationOrder.push_back(name);
     currentOffset += size;
 }
 
+void SymbolTable::removeVariable(const std::string& name) {
+    if (variables.erase(name) == 0) return;
+
+    declarationOrder.erase(std::find(declarationOrder.begin(), declarationOrder.end(), name));
+    relayoutVariables({});
+}
+
+void SymbolTable::relayoutVariables(const std::vector<std::string>& first) {
+    std::vector<std::string> order;
+    std::unordered_map<std::string, bool> placed;
+    for (const auto& name : first) {
+        if (variables.contains(name) && !placed[name]) {
+            order.push_back(name);
+            placed[name] = true;
+        }
+    }
+    for (const auto& name : declarationOrder) {
+        if (!placed[name]) order.push_back(name);
+    }
+
+    currentOffset = 0;
+    for (const auto& name : order) {
+        auto& var = variables.at(name);
+        var.offset = currentOffset;
+        currentOffset += var.size;
+    }
+}
+
 const VariableInfo& SymbolTable::getVariable(const std::string& name) const {
     auto it = variables.find(name);
     if (it == variables.end()) {
@@ -29,6 +60,10 @@ void SymbolTable::addLabel(const std::string& name, size_t address) {
     labels[name] = {address};
 }
 
+void SymbolTable::removeLabel(const std::string& name) {
+    labels.erase(name);
+}
+
 size_t SymbolTable::getLabelAddress(const std::string& name) const {
     auto it = labels.find(name);
     if (it == labels.end()) {
@@ -37,6 +72,15 @@ size_t SymbolTable::getLabelAddress(const std::string& name) const {
     return it->second.instruction_address;
 }
 
+const VariableInfo* SymbolTable::findVariable(const std::string& name) const {
+    auto it = variables.find(name);
+    return it == variables.end() ? nullptr : &it->second;
+}
+
+bool SymbolTable::isLabel(const std::string& name) const {
+    return labels.contains(name);
+}
+
 bool SymbolTable::isVariable(const std::string& name) const {
     return variables.contains(name);
 }
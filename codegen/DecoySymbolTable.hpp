@@ -2,6 +2,7 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <stdexcept>
 
 #include "../parser/DecoyParser.hpp"
@@ -22,17 +23,27 @@ class SymbolTable {
 
     void addVariable(const std::string& name, Type);
     const VariableInfo& getVariable(const std::string& name) const;
+    const VariableInfo* findVariable(const std::string& name) const; // nullptr if undeclared
+
+    // Frees the variable's memory; the variables after it move down to close the gap
+    void removeVariable(const std::string& name);
 
     void addLabel(const std::string& name, size_t address);
+    void removeLabel(const std::string& name);
     size_t getLabelAddress(const std::string& name) const;
+    bool isLabel(const std::string& name) const;
 
     size_t getTotalMemorySize() const { return currentOffset; }
-    void reset() { variables.clear(); labels.clear(); currentOffset = 0; }
+    void reset() { variables.clear(); declarationOrder.clear(); labels.clear(); currentOffset = 0; }
+
+    // Reassigns offsets: the given variables first, in order, then the rest in declaration order
+    void relayoutVariables(const std::vector<std::string>& first);
 
     bool isVariable(const std::string& name) const;
 
     private:
     std::unordered_map<std::string, VariableInfo> variables;
+    std::vector<std::string> declarationOrder;
     std::unordered_map<std::string, LabelInfo> labels;
     size_t currentOffset = 0;
 
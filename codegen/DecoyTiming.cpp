@@ -0,0 +1,269 @@
+#include "DecoyTiming.hpp"
+#include "DecoyBytecode.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+// Worst case from some point in the program to the next event
+struct Reach {
+    double nanoseconds = 0;
+    size_t to = EventLatency::NO_EVENT;
+    bool variableDelay = false;
+    bool unbounded = false;
+    size_t loopBlock = 0;
+};
+
+Reach worse(const Reach& a, const Reach& b) {
+    if (a.unbounded || b.unbounded) return a.unbounded ? a : b;
+    return b.nanoseconds > a.nanoseconds ? b : a;
+}
+
+Reach after(double nanoseconds, bool variableDelay, Reach reach) {
+    reach.nanoseconds += nanoseconds;
+    reach.variableDelay = reach.variableDelay || variableDelay;
+    return reach;
+}
+
+bool isEvent(const InstructionNode& node) {
+    const std::string& inst = node.instruction.value;
+    return inst == "pk" || inst == "rk" || inst == "mvm";
+}
+
+class TimingAnalysis {
+    public:
+    TimingAnalysis(const std::vector<InstructionNode>& ast, const ControlFlowGraph& cfg, const CostModel& model)
+        : ast(ast), cfg(cfg), blocks(cfg.getBlocks()), model(model) {}
+
+    TimingReport run(double loopBudgetNanoseconds);
+
+    private:
+    const std::vector<InstructionNode>& ast;
+    const ControlFlowGraph& cfg;
+    const std::vector<BasicBlock>& blocks;
+    const CostModel& model;
+
+    std::vector<double> costs;       // Per instruction
+    std::vector<char> variableDelays; // Per instruction
+    std::vector<BlockTiming> timings;
+    std::vector<Reach> heads;        // Per block: from its start to its first event, or past it when it has none
+
+    void timeInstructions();
+    void reachEvents();
+    Reach enter(size_t block) const;
+    std::vector<EventLatency> eventLatencies() const;
+    std::vector<LoopTiming> loops(double budget) const;
+};
+
+void TimingAnalysis::timeInstructions() {
+    costs.resize(ast.size());
+    variableDelays.resize(ast.size());
+
+    for (size_t i = 0; i < ast.size(); i++) {
+        const InstructionNode& node = ast[i];
+        const InstructionInfo* info = findInstructionInfo(node.instruction.value);
+        costs[i] = info ? model.nanoseconds(info->opcode) : 0;
+
+        if (node.instruction.value == "dl") {
+            const Token& operand = node.operands[0];
+            if (operand.type == TokenType::LITERAL) {
+                costs[i] += std::strtod(operand.value.c_str(), nullptr) * 1e6;
+            } else {
+                variableDelays[i] = true;
+            }
+        }
+    }
+
+    timings.resize(blocks.size());
+    heads.resize(blocks.size());
+
+    for (size_t b = 0; b < blocks.size(); b++) {
+        bool sawEvent = false;
+        for (size_t i = blocks[b].begin; i < blocks[b].end; i++) {
+            if (!sawEvent && isEvent(ast[i])) {
+                heads[b] = { timings[b].nanoseconds, i, timings[b].variableDelay };
+                sawEvent = true;
+            }
+            timings[b].nanoseconds += costs[i];
+            timings[b].variableDelay = timings[b].variableDelay || variableDelays[i];
+        }
+    }
+}
+
+Reach TimingAnalysis::enter(size_t block) const {
+    return block == cfg.exitBlock() ? Reach{} : heads[block];
+}
+
+// Event-free blocks reach the next event through their successors. Strongly connected
+// components come out of Tarjan's algorithm successors first, so every successor outside a
+// block's own component is final by the time the block is; a component with a cycle can loop
+// forever without an event.
+void TimingAnalysis::reachEvents() {
+    const size_t UNVISITED = static_cast<size_t>(-1);
+
+    auto eventFree = [&](size_t block) { return block != cfg.exitBlock() && heads[block].to == EventLatency::NO_EVENT; };
+
+    std::vector<size_t> order(blocks.size(), UNVISITED);
+    std::vector<size_t> low(blocks.size(), 0);
+    std::vector<char> onStack(blocks.size(), false);
+    std::vector<size_t> stack;
+    std::vector<std::pair<size_t, size_t>> calls; // Block, next successor to visit
+    size_t visited = 0;
+
+    for (size_t root = 0; root < blocks.size(); root++) {
+        if (!eventFree(root) || order[root] != UNVISITED) continue;
+
+        calls.push_back({ root, 0 });
+        while (!calls.empty()) {
+            auto& [block, next] = calls.back();
+            if (next == 0) {
+                order[block] = low[block] = visited++;
+                stack.push_back(block);
+                onStack[block] = true;
+            }
+
+            const auto& successors = blocks[block].successors;
+            if (next < successors.size()) {
+                size_t successor = successors[next++];
+                if (!eventFree(successor)) continue;
+                if (order[successor] == UNVISITED) {
+                    calls.push_back({ successor, 0 });
+                } else if (onStack[successor]) {
+                    low[block] = std::min(low[block], order[successor]);
+                }
+                continue;
+            }
+
+            size_t finished = block;
+            calls.pop_back();
+            if (!calls.empty()) {
+                low[calls.back().first] = std::min(low[calls.back().first], low[finished]);
+            }
+            if (low[finished] != order[finished]) continue;
+
+            auto first = std::find(stack.begin(), stack.end(), finished);
+            std::vector<size_t> component(first, stack.end());
+            stack.erase(first, stack.end());
+            for (size_t member : component) onStack[member] = false;
+
+            const auto& own = blocks[finished].successors;
+            bool cyclic = component.size() > 1 || std::find(own.begin(), own.end(), finished) != own.end();
+
+            for (size_t member : component) {
+                Reach reach;
+                if (cyclic) {
+                    reach.unbounded = true;
+                    reach.loopBlock = finished;
+                } else {
+                    reach = enter(blocks[member].successors[0]);
+                    for (size_t successor : blocks[member].successors) {
+                        reach = worse(reach, enter(successor));
+                    }
+                    reach = after(timings[member].nanoseconds, timings[member].variableDelay, reach);
+                }
+                heads[member] = reach;
+            }
+        }
+    }
+}
+
+// Walks each block with events backwards from the worst way out of it, so a block of
+// thousands of key presses is still one pass
+std::vector<EventLatency> TimingAnalysis::eventLatencies() const {
+    std::vector<EventLatency> latencies;
+
+    Reach start = blocks.empty() ? Reach{} : enter(0);
+    latencies.push_back({ EventLatency::NO_EVENT, start.to, start.nanoseconds, start.variableDelay, start.unbounded, start.loopBlock });
+
+    for (size_t b = 0; b < blocks.size(); b++) {
+        if (heads[b].to == EventLatency::NO_EVENT || heads[b].unbounded) continue;
+
+        Reach reach = enter(blocks[b].successors[0]);
+        for (size_t successor : blocks[b].successors) {
+            reach = worse(reach, enter(successor));
+        }
+
+        size_t firstLatency = latencies.size();
+        for (size_t i = blocks[b].end; i-- > blocks[b].begin;) {
+            reach = after(costs[i], variableDelays[i], reach);
+            if (isEvent(ast[i])) {
+                latencies.push_back({ i, reach.to, reach.nanoseconds, reach.variableDelay, reach.unbounded, reach.loopBlock });
+                reach = { 0, i, false, false, 0 };
+            }
+        }
+        std::reverse(latencies.begin() + firstLatency, latencies.end());
+    }
+
+    return latencies;
+}
+
+// One iteration is the longest path from the header to a block jumping back to it, with the
+// back edges of nested loops left out: an inner loop counts as a single pass.
+std::vector<LoopTiming> TimingAnalysis::loops(double budget) const {
+    const size_t NOT_IN_BODY = static_cast<size_t>(-1);
+
+    std::vector<LoopTiming> result;
+    std::vector<size_t> position(blocks.size(), NOT_IN_BODY);
+    std::vector<double> longest(blocks.size(), -1);
+    std::vector<char> longestVariable(blocks.size(), false);
+
+    for (const Loop& body : cfg.findLoops()) {
+        for (size_t k = 0; k < body.blocks.size(); k++) position[body.blocks[k]] = k;
+
+        longest[body.header] = timings[body.header].nanoseconds;
+        longestVariable[body.header] = timings[body.header].variableDelay;
+        for (size_t block : body.blocks) {
+            if (longest[block] < 0) continue;
+            for (size_t successor : blocks[block].successors) {
+                if (successor == cfg.exitBlock() || position[successor] == NOT_IN_BODY) continue;
+                if (position[successor] <= position[block]) continue; // A back edge
+
+                double through = longest[block] + timings[successor].nanoseconds;
+                if (through > longest[successor]) {
+                    longest[successor] = through;
+                    longestVariable[successor] = longestVariable[block] || timings[successor].variableDelay;
+                }
+            }
+        }
+
+        LoopTiming loop;
+        loop.header = body.header;
+        for (size_t latch : body.latches) {
+            if (longest[latch] > loop.nanoseconds) {
+                loop.nanoseconds = longest[latch];
+                loop.variableDelay = longestVariable[latch];
+            }
+        }
+        loop.overBudget = budget > 0 && loop.nanoseconds > budget;
+
+        for (size_t block : body.blocks) {
+            position[block] = NOT_IN_BODY;
+            longest[block] = -1;
+            longestVariable[block] = false;
+        }
+        loop.blocks = body.blocks;
+        std::sort(loop.blocks.begin() + 1, loop.blocks.end());
+        result.push_back(std::move(loop));
+    }
+
+    return result;
+}
+
+TimingReport TimingAnalysis::run(double loopBudgetNanoseconds) {
+    timeInstructions();
+    reachEvents();
+
+    TimingReport report;
+    report.latencies = eventLatencies();
+    report.loops = loops(loopBudgetNanoseconds);
+    report.blocks = std::move(timings);
+    return report;
+}
+
+}
+
+TimingReport estimateTiming(const std::vector<InstructionNode>& ast, const ControlFlowGraph& cfg,
+    const CostModel& model, double loopBudgetNanoseconds) {
+    return TimingAnalysis(ast, cfg, model).run(loopBudgetNanoseconds);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "DecoyControlFlow.hpp"
+#include "DecoyCostModel.hpp"
+
+struct BlockTiming {
+    double nanoseconds = 0;     // One pass through the block, literal delays included
+    bool variableDelay = false; // Also waits on a dl whose operand is a variable, not counted
+};
+
+// The longest a run can go from one input event (pk, rk or mvm) to the next
+struct EventLatency {
+    static constexpr size_t NO_EVENT = static_cast<size_t>(-1);
+
+    size_t from = NO_EVENT;     // Instruction index of the event, or NO_EVENT for the start of the program
+    size_t to = NO_EVENT;       // The event the worst path reaches, or NO_EVENT when it ends the program
+    double nanoseconds = 0;     // From the start of one event to the start of the next
+    bool variableDelay = false; // The worst path also waits on variable delays
+    bool unbounded = false;     // A loop without events can run in between; nanoseconds is meaningless
+    size_t loopBlock = 0;       // A block of that loop, when unbounded
+};
+
+struct LoopTiming {
+    size_t header = 0;          // Block the back edges return to
+    std::vector<size_t> blocks; // The loop body, header first, then in source order
+    double nanoseconds = 0;     // Longest single iteration; nested loops counted as one pass
+    bool variableDelay = false;
+    bool overBudget = false;
+};
+
+struct TimingReport {
+    std::vector<BlockTiming> blocks;      // Indexed like ControlFlowGraph::getBlocks
+    std::vector<EventLatency> latencies;  // Program start first, then every event in source order
+    std::vector<LoopTiming> loops;        // By header, in source order
+};
+
+// Static execution time estimate of a checked program from a per-opcode cost model: the time
+// of every basic block, the worst-case gap between consecutive input events, and the cost of
+// one iteration of every loop, flagging those over loopBudgetNanoseconds (0 flags none).
+// Literal dl operands count as their delay; variable ones are only flagged.
+TimingReport estimateTiming(const std::vector<InstructionNode>& ast, const ControlFlowGraph& cfg,
+    const CostModel& model, double loopBudgetNanoseconds);
@@ -0,0 +1,211 @@
+#include "DecoyVerifier.hpp"
+#include "DecoyBytecode.hpp"
+#include "DecoyLittleEndian.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <unordered_map>
+
+static const char CERTIFICATE_MAGIC[4] = { 'D', 'X', 'V', '1' };
+static constexpr size_t CERTIFICATE_SIZE = 4 + 4 + 4 + 32;
+
+// Whether execution can continue with the next instruction; a call does once its ret comes back
+static bool fallsThrough(Instruction opcode) {
+    switch (memoryForm(opcode)) {
+        case Instruction::JMP:
+        case Instruction::RET:
+        case Instruction::CEJMP:
+        case Instruction::CGJMP:
+        case Instruction::CLJMP:
+        case Instruction::CEGJMP:
+        case Instruction::CELJMP:
+            return false;
+        default:
+            return true;
+    }
+}
+
+std::vector<uint8_t> ModuleCertificate::encode() const {
+    std::vector<uint8_t> out(CERTIFICATE_MAGIC, CERTIFICATE_MAGIC + sizeof(CERTIFICATE_MAGIC));
+    writeUI32(out, instructions);
+    writeUI32(out, memorySize);
+    out.insert(out.end(), hash.begin(), hash.end());
+    return out;
+}
+
+ModuleCertificate ModuleCertificate::decode(std::span<const uint8_t> data) {
+    if (data.size() != CERTIFICATE_SIZE || !std::equal(CERTIFICATE_MAGIC, CERTIFICATE_MAGIC + sizeof(CERTIFICATE_MAGIC), data.begin())) {
+        throw std::runtime_error("Not a module certificate");
+    }
+
+    ModuleCertificate certificate;
+    certificate.instructions = readUI32(data, 4);
+    certificate.memorySize = readUI32(data, 8);
+    std::copy(data.begin() + 12, data.end(), certificate.hash.begin());
+    return certificate;
+}
+
+bool ModuleCertificate::certifies(std::span<const uint8_t> bytecode) const {
+    Sha256 sha;
+    sha.update(bytecode.data(), bytecode.size());
+    return sha.finish() == hash;
+}
+
+VerificationResult verifyModule(std::span<const uint8_t> bytecode, size_t poolSize) {
+    VerificationResult result;
+    auto report = [&](size_t address, const std::string& message) {
+        result.problems.push_back("Offset " + std::to_string(address) + ": " + message);
+    };
+
+    std::vector<DecodedInstruction> decoded;
+    BytecodeReader reader(bytecode);
+    try {
+        while (!reader.isAtEnd()) {
+            decoded.push_back(reader.next());
+        }
+    } catch (const std::exception& e) {
+        result.problems.push_back(e.what());
+        return result;
+    }
+    if (decoded.size() > UINT32_MAX) {
+        report(0, "Module has more instructions than a certificate can count");
+        return result;
+    }
+
+    // Declarations first, since variables can be used before the cv that declares them
+    std::vector<char> boundary(bytecode.size() + 1, false);
+    boundary[bytecode.size()] = true;
+    std::unordered_map<uint32_t, Type> variables;
+    std::vector<std::pair<uint64_t, const DecodedInstruction*>> declarations; // Offset and cv of each
+    uint64_t memorySize = 0;
+    for (const auto& instruction : decoded) {
+        boundary[instruction.address] = true;
+        if (instruction.opcode != Instruction::CV) continue;
+
+        uint32_t offset = instruction.operands[2].value;
+        Type type = instruction.operands[1].type;
+        if (!variables.emplace(offset, type).second) {
+            report(instruction.address, "Variable at offset " + std::to_string(offset) + " is declared twice");
+            continue;
+        }
+        declarations.push_back({ offset, &instruction });
+        memorySize = std::max<uint64_t>(memorySize, uint64_t(offset) + literalSize(type));
+    }
+    std::sort(declarations.begin(), declarations.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (size_t i = 1; i < declarations.size(); i++) {
+        const auto& [previousOffset, previous] = declarations[i - 1];
+        if (previousOffset + literalSize(previous->operands[1].type) > declarations[i].first) {
+            report(declarations[i].second->address, "Variable at offset " + std::to_string(declarations[i].first)
+                + " overlaps the one at offset " + std::to_string(previousOffset));
+        }
+    }
+    if (memorySize > UINT32_MAX) {
+        report(0, "Variables take more than 4 GiB of memory");
+    }
+
+    // A register holds one variable for the whole module (see VirtualMachine::bindRegisters)
+    std::array<Type, REGISTER_COUNT> registerTypes{};
+    registerTypes.fill(Type::NT);
+    for (const auto& instruction : decoded) {
+        if (instruction.opcode != Instruction::FILL && instruction.opcode != Instruction::SPILL) continue;
+
+        uint32_t index = instruction.operands[0].value;
+        auto variable = variables.find(instruction.operands[1].value);
+        if (variable == variables.end()) continue; // Reported with the other references below
+        if (registerTypes[index] != Type::NT && registerTypes[index] != variable->second) {
+            report(instruction.address, "Register " + std::to_string(index) + " holds variables of different types");
+        }
+        registerTypes[index] = variable->second;
+    }
+
+    for (const auto& instruction : decoded) {
+        for (const auto& operand : instruction.operands) {
+            switch (operand.kind) {
+                case OperandKind::VARIABLE:
+                    if (!variables.contains(operand.value)) {
+                        report(instruction.address, "Reference to undeclared variable at offset " + std::to_string(operand.value));
+                    }
+                    break;
+                case OperandKind::REGISTER:
+                    if (registerTypes[operand.value] == Type::NT) {
+                        report(instruction.address, "Register " + std::to_string(operand.value) + " is never filled");
+                    }
+                    break;
+                case OperandKind::LABEL:
+                    if (operand.value > bytecode.size() || !boundary[operand.value]) {
+                        report(instruction.address, "Jump target " + std::to_string(operand.value) + " is not an instruction boundary");
+                    }
+                    break;
+                case OperandKind::POOLED_STRING:
+                    if (operand.value >= poolSize) {
+                        report(instruction.address, "String pool index " + std::to_string(operand.value) + " out of range");
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    // Registers filled on every path to each instruction, a bit each, by forward dataflow from
+    // the start of the module. Fills only add, so the code after a call keeps what was filled
+    // before it; a ret ends its path there. Unreachable instructions keep every bit.
+    constexpr uint32_t ALL_REGISTERS = (uint32_t(1) << REGISTER_COUNT) - 1;
+    std::vector<uint32_t> filled(decoded.size(), ALL_REGISTERS);
+    std::vector<char> queued(decoded.size(), false);
+    std::vector<size_t> work;
+    auto flow = [&](size_t to, uint32_t state) {
+        if (to >= decoded.size() || (filled[to] & state) == filled[to]) return;
+        filled[to] &= state;
+        if (!queued[to]) {
+            queued[to] = true;
+            work.push_back(to);
+        }
+    };
+    auto indexAt = [&](uint32_t address) {
+        auto it = std::lower_bound(decoded.begin(), decoded.end(), address,
+            [](const DecodedInstruction& instruction, uint32_t target) { return instruction.address < target; });
+        return it != decoded.end() && it->address == address ? static_cast<size_t>(it - decoded.begin()) : decoded.size();
+    };
+
+    if (!decoded.empty()) {
+        filled[0] = 0;
+        queued[0] = true;
+        work.push_back(0);
+    }
+    while (!work.empty()) {
+        size_t i = work.back();
+        work.pop_back();
+        queued[i] = false;
+
+        const auto& instruction = decoded[i];
+        uint32_t state = filled[i];
+        if (instruction.opcode == Instruction::FILL) state |= uint32_t(1) << instruction.operands[0].value;
+
+        for (const auto& operand : instruction.operands) {
+            if (operand.kind == OperandKind::LABEL) flow(indexAt(operand.value), state);
+        }
+        if (fallsThrough(instruction.opcode)) flow(i + 1, state);
+    }
+
+    for (size_t i = 0; i < decoded.size(); i++) {
+        const auto& instruction = decoded[i];
+        for (size_t k = instruction.opcode == Instruction::FILL ? 1 : 0; k < instruction.operands.size(); k++) {
+            const auto& operand = instruction.operands[k];
+            if (operand.kind == OperandKind::REGISTER && !(filled[i] & (uint32_t(1) << operand.value))) {
+                report(instruction.address, "Register " + std::to_string(operand.value) + " can be used before it is filled");
+            }
+        }
+    }
+
+    if (result.passed()) {
+        result.certificate.instructions = static_cast<uint32_t>(decoded.size());
+        result.certificate.memorySize = static_cast<uint32_t>(memorySize);
+        Sha256 sha;
+        sha.update(bytecode.data(), bytecode.size());
+        result.certificate.hash = sha.finish();
+    }
+    return result;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "../cache/DecoyHash.hpp"
+
+// What verifyModule proved about one module, stored next to it as its own archive entry
+// (<unit>.xexv) so the bytecode format stays as it is. A VM given a certificate that matches the
+// module's bytes skips the checks of its load pass (see VirtualMachine::load). It is a checksum,
+// not a signature: it catches corrupt and stale modules, not forged ones.
+//
+// Encoding:
+//   [4-byte magic "DXV1"][4-byte instruction count][4-byte memory size][32-byte SHA-256 of the module]
+struct ModuleCertificate {
+    uint32_t instructions = 0;
+    uint32_t memorySize = 0; // End of the last variable, which is all the memory the module uses
+    Sha256::Digest hash{};
+
+    std::vector<uint8_t> encode() const;
+    static ModuleCertificate decode(std::span<const uint8_t> data);
+
+    // Whether the certificate was issued for exactly these bytes; hashes them, so a caller that
+    // already checked the module against a known hash should compare that instead
+    bool certifies(std::span<const uint8_t> bytecode) const;
+};
+
+struct VerificationResult {
+    std::vector<std::string> problems; // "Offset N: ..." each
+    ModuleCertificate certificate;     // Only meaningful without problems
+
+    bool passed() const { return problems.empty(); }
+};
+
+// Checks everything VirtualMachine::load checks, and a little more, without loading the module:
+// - it decodes: known opcodes, valid type tags, registers below REGISTER_COUNT, nothing truncated
+// - every jump and call target is an instruction boundary or the end of the module
+// - declarations neither repeat nor overlap, and every variable reference names the start of
+//   one, so offset plus type size stays inside the memory the declarations lay out
+// - each register is filled and spilled from variables of a single type, and filled on every
+//   path that reaches an instruction using it
+// - pooled print strings index into a pool of poolSize strings
+// A module that does not decode reports only that.
+VerificationResult verifyModule(std::span<const uint8_t> bytecode, size_t poolSize);
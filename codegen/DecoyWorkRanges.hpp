@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// Splits [0, count) into contiguous ranges of at least minRangeSize items, at most one per thread.
+// run() calls body(range) for every range on its own thread and waits for all of them. If ranges
+// throw, the exception of the lowest range is rethrown, which is the error a serial loop over the
+// same items would have hit first as long as each range stops at its own first error.
+class WorkRanges {
+    public:
+    WorkRanges(size_t count, size_t threads, size_t minRangeSize)
+        : count(count), ranges(std::max<size_t>(1, std::min(threads, count / std::max<size_t>(1, minRangeSize)))) {}
+
+    size_t size() const { return ranges; }
+    size_t begin(size_t range) const { return count * range / ranges; }
+    size_t end(size_t range) const { return count * (range + 1) / ranges; }
+
+    template <typename Body>
+    void run(Body&& body) const {
+        if (ranges == 1) {
+            body(0);
+            return;
+        }
+
+        std::vector<std::exception_ptr> errors(ranges);
+        std::vector<std::thread> workers;
+        for (size_t range = 0; range < ranges; range++) {
+            workers.emplace_back([&, range] {
+                try {
+                    body(range);
+                } catch (...) {
+                    errors[range] = std::current_exception();
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+
+        for (const auto& error : errors) {
+            if (error) std::rethrow_exception(error);
+        }
+    }
+
+    private:
+    size_t count;
+    size_t ranges;
+};
@@ -1,23 +1,45 @@
 #include "DecoyLexer.hpp"
 
+#include <string_view>
+
 std::vector<Token> Lexer::tokenize() {
     std::vector<Token> tokens;
+    tokenize(tokens);
+    return tokens;
+}
+
+void Lexer::tokenize(std::vector<Token>& tokens) {
+    size_t firstToken = tokens.size();
     bool lineHasTokens = false;
-    
+
+    // Only lines with an '=' are expressions; elsewhere '-' keeps starting a literal, as in mvm 5 -5
+    size_t lineFirstToken = tokens.size();
+    bool expressionLine = false;
+
     while (pos < source.length()) {
         char current = peek();
 
         if (current == '\n') {
             consume();
             if (lineHasTokens) {
-                tokens.push_back({ TokenType::END_OF_LINE, "EOL", line });
+                tokens.push_back({ TokenType::END_OF_LINE, "EOL", line, pos - lineStart });
                 lineHasTokens = false;
             }
             line++;
+            lineStart = pos;
+            lineFirstToken = tokens.size();
+            expressionLine = false;
         } else if (std::isspace(current)) {
             consume();
         } else {
-            if (std::isdigit(current) || current == '-') {
+            size_t column = pos - lineStart + 1;
+            size_t tokenCount = tokens.size();
+
+            if (current == '-' && expressionLine
+                && (isBinaryMinus(tokens, lineFirstToken) || !std::isdigit(static_cast<unsigned char>(peekNext())))) {
+                consume();
+                tokens.push_back({ TokenType::OPERATOR, "-", line });
+            } else if (std::isdigit(current) || current == '-') {
                 tokens.push_back(readNumber());
             } else if (std::isalpha(current) || current == '_') {
                 tokens.push_back(readIdentifier());
@@ -26,6 +48,10 @@ std::vector<Token> Lexer::tokenize() {
             } else if (current == ',') {
                 consume();
                 tokens.push_back({ TokenType::COMMA, ",", line });
+            } else if (std::string_view("=+*/%()").find(current) != std::string_view::npos) {
+                consume();
+                tokens.push_back({ TokenType::OPERATOR, std::string(1, current), line });
+                expressionLine = expressionLine || current == '=';
             } else if (current == '\n') {
                 consume();
                 tokens.push_back({ TokenType::END_OF_LINE, "EOL", line });
@@ -34,25 +60,37 @@ std::vector<Token> Lexer::tokenize() {
                 consume();
             }
 
+            if (tokens.size() != tokenCount) {
+                tokens.back().column = column;
+            }
             lineHasTokens = true;
         }
     }
 
-    if (!tokens.empty() && tokens.back().type != TokenType::END_OF_LINE) {
-        tokens.push_back({ TokenType::END_OF_LINE, "EOL", line });
+    if (tokens.size() != firstToken && tokens.back().type != TokenType::END_OF_LINE) {
+        tokens.push_back({ TokenType::END_OF_LINE, "EOL", line, pos - lineStart + 1 });
     }
-    
-    return tokens;
 }
 
 char Lexer::peek() {
     return (pos < source.length()) ? source[pos] : '\0';
 }
 
+char Lexer::peekNext() {
+    return (pos + 1 < source.length()) ? source[pos + 1] : '\0';
+}
+
 void Lexer::consume() {
     pos++;
 }
 
+bool Lexer::isBinaryMinus(const std::vector<Token>& tokens, size_t lineFirstToken) {
+    if (tokens.size() == lineFirstToken) return false;
+    const Token& previous = tokens.back();
+    return previous.type == TokenType::IDENTIFIER || previous.type == TokenType::LITERAL
+        || (previous.type == TokenType::OPERATOR && previous.value == ")");
+}
+
 Token Lexer::readNumber() {
     size_t start = pos;
     bool isFloat = false;
@@ -76,6 +114,8 @@ Token Lexer::readNumber() {
 
 Token Lexer::readIdentifier() {
     size_t start = pos;
+    // A leading '_' is always taken, so a stray underscore cannot stall the lexer
+    consume();
     while (std::isalnum(peek())) consume();
     std::string id = source.substr(start, pos - start);
 
@@ -95,3 +135,53 @@ Token Lexer::readString() {
     if (peek() == '"') consume();
     return { TokenType::STRING, str, line };
 }
+
+bool TokenStream::next(std::vector<Token>& tokens) {
+    size_t before = tokens.size();
+    while (tokens.size() == before) {
+        size_t end = findLineEnd();
+        while (end == std::string_view::npos && readMore()) {
+            end = findLineEnd();
+        }
+        if (end == std::string_view::npos) end = text.size(); // The last line has no newline
+        if (end == 0) return false;
+
+        Lexer lexer(std::string(text.substr(0, end)), line);
+        lexer.tokenize(tokens);
+        line = lexer.getLine();
+
+        text.remove_prefix(end);
+        scanned = 0;
+        inString = false;
+    }
+    return true;
+}
+
+// Offset just past the newline that ends the first line of text, or npos if text holds no
+// complete line yet. Strings end as Lexer::readString ends them: at a quote, or at a '\0'.
+size_t TokenStream::findLineEnd() {
+    for (; scanned < text.size(); scanned++) {
+        char c = text[scanned];
+        if (inString) {
+            inString = c != '"' && c != '\0';
+        } else if (c == '"') {
+            inString = true;
+        } else if (c == '\n') {
+            return ++scanned;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// Drops what has been lexed and appends up to READ_SIZE bytes; text stays the unlexed rest
+bool TokenStream::readMore() {
+    if (!input || !*input) return false;
+
+    buffer.erase(0, buffer.size() - text.size());
+    size_t kept = buffer.size();
+    buffer.resize(kept + READ_SIZE);
+    input->read(buffer.data() + kept, READ_SIZE);
+    buffer.resize(kept + static_cast<size_t>(input->gcount()));
+    text = buffer;
+    return buffer.size() > kept;
+}
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <istream>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 
 enum class TokenType {
     INSTRUCTION,
@@ -12,6 +15,7 @@ enum class TokenType {
     LABEL,
     STRING,
     COMMA,
+    OPERATOR, // = + - * / % ( ) of an expression assignment
     END_OF_LINE
 };
 
@@ -19,20 +23,30 @@ struct Token {
     TokenType type;
     std::string value;
     size_t line;
+    size_t column = 0;
 };
 
 class Lexer {
     public:
-    explicit Lexer(const std::string& source) : source(source), pos(0), line(1) {}
+    // firstLine numbers the source's first line, for sources that are one piece of a larger one
+    explicit Lexer(std::string source, size_t firstLine = 1) : source(std::move(source)), pos(0), line(firstLine), lineStart(0) {}
 
     std::vector<Token> tokenize();
 
+    // Appends the token stream to tokens, reusing its capacity
+    void tokenize(std::vector<Token>& tokens);
+
+    // Current line; after tokenize() this is 1 + the newlines seen outside string literals
+    size_t getLine() const { return line; }
+
     private:
     const std::string source;
     size_t pos;
     size_t line;
+    size_t lineStart;
 
-    const std::unordered_map<std::string, TokenType> keywords = {
+    // Shared by every lexer, so lexing many chunks or units does not rebuild it
+    static inline const std::unordered_map<std::string, TokenType> keywords = {
         // ===== INSTRUCTIONS =====
         {"cv", TokenType::INSTRUCTION},
         {"av", TokenType::INSTRUCTION},
@@ -58,6 +72,10 @@ class Lexer {
         {"celjmp", TokenType::INSTRUCTION},
         {"dl", TokenType::INSTRUCTION},
         {"nop", TokenType::INSTRUCTION},
+        {"rep", TokenType::INSTRUCTION},
+        {"endrep", TokenType::INSTRUCTION},
+        {"call", TokenType::INSTRUCTION},
+        {"ret", TokenType::INSTRUCTION},
 
         // ===== TYPES =====
         {"nt", TokenType::TYPE},
@@ -72,9 +90,50 @@ class Lexer {
     };
 
     char peek();
+    char peekNext();
     void consume();
 
+    // Whether a '-' on an expression line subtracts, rather than starting a negative literal
+    static bool isBinaryMinus(const std::vector<Token>& tokens, size_t lineFirstToken);
+
     Token readNumber();
     Token readIdentifier();
     Token readString();
-};
\ No newline at end of file
+};
+
+// Tokens pulled one line at a time, for sources too large to tokenize whole. Each line is lexed
+// exactly as Lexer::tokenize lexes it in place, so the stream adds up to the same tokens.
+//
+// A line ends at a newline outside a string literal; a string that spans lines comes out with
+// the lines around it as one. A source read from a stream goes through a buffer that holds the
+// line being lexed plus at most READ_SIZE bytes of what follows, so memory depends on the length
+// of the longest line rather than on the size of the source.
+class TokenStream {
+    public:
+    explicit TokenStream(std::istream& input) : input(&input) {}
+
+    // Lexes text in place; text must outlive the stream
+    explicit TokenStream(std::string_view text) : text(text) {}
+
+    // Appends the tokens of the next line that has any, END_OF_LINE included. Returns false,
+    // appending nothing, at the end of the source.
+    bool next(std::vector<Token>& tokens);
+
+    // Line the next line starts on, as Lexer::getLine counts them
+    size_t getLine() const { return line; }
+
+    private:
+    static constexpr size_t READ_SIZE = 64 * 1024;
+
+    std::istream* input = nullptr;
+    std::string buffer;    // Unlexed input read from the stream
+    std::string_view text; // The rest of the source, in the buffer or the caller's text
+    size_t line = 1;
+
+    // Where the scan for the current line's end stopped, so long lines are scanned once
+    size_t scanned = 0;
+    bool inString = false;
+
+    size_t findLineEnd();
+    bool readMore();
+};
@@ -0,0 +1,458 @@
+#include "DecoyDocument.hpp"
+
+#include "../lexer/DecoyLexer.hpp"
+#include "../parser/DecoyParser.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <stdexcept>
+
+ScriptDocument::ScriptDocument() : analyzer(symbols, noProgram) {
+    lines.push_back(std::make_unique<Line>());
+}
+
+ScriptDocument::ScriptDocument(std::string_view text) : ScriptDocument() {
+    setText(text);
+}
+
+DocumentEditStats ScriptDocument::setText(std::string_view text) {
+    lines.clear();
+    lines.push_back(std::make_unique<Line>());
+    variableDeclarations.clear();
+    labelDeclarations.clear();
+    uses.clear();
+    symbols.reset();
+    return replaceLines(0, 1, text);
+}
+
+DocumentEditStats ScriptDocument::edit(size_t startLine, size_t startColumn, size_t endLine, size_t endColumn, std::string_view text) {
+    if (startLine > endLine || endLine >= lines.size()
+        || startColumn > lines[startLine]->text.size() || endColumn > lines[endLine]->text.size()
+        || (startLine == endLine && startColumn > endColumn)) {
+        throw std::out_of_range("Edit range is outside the document");
+    }
+
+    std::string replacement = lines[startLine]->text.substr(0, startColumn);
+    replacement += text;
+    replacement += std::string_view(lines[endLine]->text).substr(endColumn);
+    return replaceLines(startLine, endLine - startLine + 1, replacement);
+}
+
+std::string ScriptDocument::text() const {
+    std::string joined;
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (i > 0) joined += '\n';
+        joined += lines[i]->text;
+    }
+    return joined;
+}
+
+std::vector<Diagnostic> ScriptDocument::diagnostics() const {
+    auto numbering = compilerLines();
+    auto report = [&](Diagnostics& diagnostics, size_t line, const Entry& entry, const Status& status) {
+        if (status) return;
+        InstructionNode at;
+        at.instruction = entry.node.instruction;
+        at.instruction.line = numbering[line];
+        SemanticAnalyzer::report(diagnostics, at, status);
+    };
+
+    // Collected the way CompilerContext::check does: syntax errors, then declaration errors,
+    // then instruction errors, with errors on the same line kept in that order
+    Diagnostics syntax, declarations, checks;
+    bool repeats = false;
+    for (size_t i = 0; i < lines.size(); i++) {
+        const Line& line = *lines[i];
+        if (line.error) {
+            size_t at = numbering[i + line.error->first];
+            syntax.error(at, Parser::formatError(at, line.error->second));
+        }
+        if (line.entry) {
+            report(declarations, i, *line.entry, line.entry->declaration);
+            report(checks, i, *line.entry, line.entry->check);
+
+            const std::string& inst = line.entry->node.instruction.value;
+            repeats = repeats || inst == "rep" || inst == "endrep";
+        }
+    }
+
+    // Block pairing depends on the whole program; rare enough to recheck from scratch
+    if (repeats) {
+        SemanticAnalyzer::checkRepeatBlocks(program(), checks);
+    }
+
+    syntax.append(declarations);
+    syntax.append(checks);
+    syntax.sortByLine();
+    return syntax.all();
+}
+
+std::vector<InstructionNode> ScriptDocument::program() const {
+    auto numbering = compilerLines();
+
+    std::vector<InstructionNode> nodes;
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (!lines[i]->entry) continue;
+
+        nodes.push_back(lines[i]->entry->node);
+        auto& node = nodes.back();
+        node.instruction.line = numbering[i + node.instruction.line];
+        for (auto& operand : node.operands) {
+            operand.line = numbering[i + operand.line];
+        }
+    }
+    return nodes;
+}
+
+// The compiler's number for each editor line: line breaks inside strings do not count
+std::vector<size_t> ScriptDocument::compilerLines() const {
+    std::vector<size_t> numbering(lines.size());
+    size_t line = 0;
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (!lines[i]->continued) line++;
+        numbering[i] = line;
+    }
+    return numbering;
+}
+
+DocumentEditStats ScriptDocument::replaceLines(size_t first, size_t count, std::string_view text) {
+    DocumentEditStats stats;
+
+    std::vector<std::string> replacement;
+    for (size_t begin = 0;;) {
+        size_t end = text.find('\n', begin);
+        replacement.emplace_back(text.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin));
+        if (end == std::string_view::npos) break;
+        begin = end + 1;
+    }
+
+    // Found before the lines change, from the old lexing and parse
+    size_t group = first;
+    while (lines[group]->continued) group--;
+    size_t from = firstAffectedLine(group);
+
+    std::vector<std::unique_ptr<Entry>> removed;
+    for (size_t i = first; i < first + count; i++) {
+        clearLine(*lines[i], removed);
+    }
+
+    // Replaced lines are reused in place, so an edit that keeps the line count moves nothing
+    if (replacement.size() < count) {
+        lines.erase(lines.begin() + first + replacement.size(), lines.begin() + first + count);
+    } else if (replacement.size() > count) {
+        std::vector<std::unique_ptr<Line>> inserted(replacement.size() - count);
+        for (auto& line : inserted) {
+            line = std::make_unique<Line>();
+        }
+        lines.insert(lines.begin() + first + count, std::make_move_iterator(inserted.begin()), std::make_move_iterator(inserted.end()));
+    }
+    for (size_t i = 0; i < replacement.size(); i++) {
+        lines[first + i]->text = std::move(replacement[i]);
+    }
+
+    shiftDeclarations(first + count, static_cast<long long>(replacement.size()) - static_cast<long long>(count));
+    size_t after = first + replacement.size();
+
+    size_t unchanged = relex(group, after, stats);
+
+    std::vector<Entry*> added;
+    reparse(from, unchanged, removed, added, stats);
+    updateSymbols(removed, added, stats);
+    return stats;
+}
+
+// Lexes the lines from line from, a line outside any string, until a line at or after line
+// after (the first one past the edit) that was outside any string before the edit as well:
+// from there on, everything lexes as it did. Returns that line.
+size_t ScriptDocument::relex(size_t from, size_t after, DocumentEditStats& stats) {
+    size_t i = from;
+    while (i < lines.size() && (i < after || lines[i]->continued)) {
+        size_t last = i;
+        bool inString = endsInString(lines[i]->text, false);
+        while (inString && last + 1 < lines.size()) {
+            last++;
+            inString = endsInString(lines[last]->text, true);
+        }
+
+        lexGroup(i, last);
+        stats.linesLexed += last - i + 1;
+        i = last + 1;
+    }
+    return i;
+}
+
+// Lexes line first with the lines a string on it runs on to, up to line last. The whole-text
+// lexer ends a line that has only skipped characters with an end of line token, unless it is
+// the last line; that token then fails to parse as an instruction. The token is kept here and
+// dropped for the last line when the window is built.
+void ScriptDocument::lexGroup(size_t first, size_t last) {
+    Line& head = *lines[first];
+    head.continued = false;
+    head.tokens.clear();
+
+    if (first == last) {
+        Lexer(head.text).tokenize(head.tokens);
+    } else {
+        std::string joined = head.text;
+        for (size_t i = first + 1; i <= last; i++) {
+            joined += '\n';
+            joined += lines[i]->text;
+            lines[i]->continued = true;
+            lines[i]->tokens.clear();
+            lines[i]->junk = false;
+        }
+        Lexer(joined).tokenize(head.tokens);
+    }
+
+    head.junk = head.tokens.empty()
+        && std::any_of(head.text.begin(), head.text.end(), [](char c) { return !std::isspace(static_cast<unsigned char>(c)); });
+    if (head.junk) {
+        head.tokens.push_back({ TokenType::END_OF_LINE, "EOL", 1, head.text.size() + 1 });
+    }
+}
+
+// Whether a string is still open at the end of text, following the lexer: a string ends at a
+// quote or a NUL character
+bool ScriptDocument::endsInString(const std::string& text, bool inString) {
+    for (char c : text) {
+        if (inString) {
+            inString = c != '"' && c != '\0';
+        } else {
+            inString = c == '"';
+        }
+    }
+    return inString;
+}
+
+// The first line whose parse an edit starting at line can change: the start of an instruction
+// that looked at line or beyond, or line itself
+size_t ScriptDocument::firstAffectedLine(size_t line) const {
+    for (size_t i = line; i-- > 0;) {
+        if (!lines[i]->starts) continue;
+        bool reaches = lines[i]->span == TO_END || i + lines[i]->span >= line;
+        return reaches ? i : line;
+    }
+    return line;
+}
+
+void ScriptDocument::shiftDeclarations(size_t first, long long delta) {
+    if (delta == 0) return;
+
+    for (auto* declarations : { &variableDeclarations, &labelDeclarations }) {
+        for (auto& [name, entries] : *declarations) {
+            for (Entry* entry : entries) {
+                if (entry->line >= first) entry->line += delta;
+            }
+        }
+    }
+}
+
+// Parses from line from until an instruction starts where the old parse also started one, at
+// or after syncFrom (the first line that lexes as it did before the edit), or until the end. The parser runs over a
+// window of lines that grows when an instruction fails at its end, since its operands may
+// continue past it.
+void ScriptDocument::reparse(size_t from, size_t syncFrom, std::vector<std::unique_ptr<Entry>>& removed,
+    std::vector<Entry*>& added, DocumentEditStats& stats) {
+    std::vector<Token> window;
+    Diagnostics errors;
+    size_t windowLines = FIRST_WINDOW_LINES;
+    size_t next = from;    // First line of the next window
+    size_t cleared = from; // Lines before this hold the new parse
+
+    while (next < lines.size()) {
+        size_t end = std::min(lines.size(), next + windowLines);
+        fillWindow(next, end, window);
+        Parser parser(window);
+
+        bool grow = false;
+        while (!parser.isAtEnd()) {
+            size_t start = window[parser.position()].line - 1;
+            if (start >= syncFrom && lines[start]->starts) {
+                for (; cleared < start; cleared++) clearLine(*lines[cleared], removed);
+                return;
+            }
+
+            InstructionNode node;
+            errors.clear();
+            bool parsed = parser.parseNext(node, errors);
+            if (!parsed && parser.isAtEnd() && end < lines.size()) {
+                grow = true;
+                next = start;
+                break;
+            }
+            stats.instructionsParsed++;
+
+            size_t following = parser.isAtEnd() ? end : window[parser.position()].line - 1;
+            for (; cleared < following; cleared++) clearLine(*lines[cleared], removed);
+
+            Line& line = *lines[start];
+            line.starts = true;
+            if (parsed) {
+                line.span = window[parser.position() - 1].line - 1 - start;
+                node.instruction.line -= start + 1;
+                for (auto& operand : node.operands) {
+                    operand.line -= start + 1;
+                }
+                line.entry = std::make_unique<Entry>();
+                line.entry->node = std::move(node);
+                line.entry->line = start;
+                added.push_back(line.entry.get());
+            } else {
+                size_t errorLine = errors.front().line;
+                std::string message = errors.front().message.substr(Parser::formatError(errorLine, "").size());
+                line.span = parser.isAtEnd() ? TO_END : errorLine - 1 - start;
+                line.error.emplace(errorLine - 1 - start, std::move(message));
+            }
+        }
+
+        if (grow) {
+            windowLines *= 2;
+        } else {
+            next = end;
+        }
+    }
+
+    for (; cleared < lines.size(); cleared++) clearLine(*lines[cleared], removed);
+}
+
+void ScriptDocument::fillWindow(size_t from, size_t to, std::vector<Token>& window) const {
+    window.clear();
+    for (size_t i = from; i < to; i++) {
+        if (lines[i]->junk && i + 1 == lines.size()) continue;
+
+        for (const auto& token : lines[i]->tokens) {
+            window.push_back(token);
+            window.back().line = i + 1;
+        }
+    }
+}
+
+void ScriptDocument::clearLine(Line& line, std::vector<std::unique_ptr<Entry>>& removed) {
+    if (line.entry) removed.push_back(std::move(line.entry));
+    line.starts = false;
+    line.span = 0;
+    line.error.reset();
+}
+
+void ScriptDocument::updateSymbols(const std::vector<std::unique_ptr<Entry>>& removed, const std::vector<Entry*>& added,
+    DocumentEditStats& stats) {
+    std::unordered_set<std::string> variables, labels;
+    for (const auto& entry : removed) unindex(entry.get(), variables, labels);
+    for (Entry* entry : added) index(entry, variables, labels);
+
+    std::unordered_set<Entry*> recheck(added.begin(), added.end());
+    for (const auto& name : variables) redeclareVariable(name, recheck);
+    for (const auto& name : labels) redeclareLabel(name, recheck);
+
+    for (Entry* entry : recheck) {
+        entry->check = analyzer.checkInstruction(entry->node);
+    }
+    stats.instructionsChecked = recheck.size();
+}
+
+void ScriptDocument::index(Entry* entry, std::unordered_set<std::string>& variables, std::unordered_set<std::string>& labels) {
+    const auto& node = entry->node;
+    bool isCv = node.instruction.value == "cv";
+    size_t firstUse = 0;
+
+    if ((isCv || node.instruction.value == "dfp") && !node.operands.empty()) {
+        const auto& name = node.operands[0].value;
+        auto& declarations = isCv ? variableDeclarations[name] : labelDeclarations[name];
+        auto at = std::upper_bound(declarations.begin(), declarations.end(), entry->line,
+            [](size_t line, const Entry* other) { return line < other->line; });
+        declarations.insert(at, entry);
+        (isCv ? variables : labels).insert(name);
+        firstUse = 1;
+    }
+
+    for (size_t i = firstUse; i < node.operands.size(); i++) {
+        if (node.operands[i].type == TokenType::IDENTIFIER) uses[node.operands[i].value].insert(entry);
+    }
+}
+
+void ScriptDocument::unindex(Entry* entry, std::unordered_set<std::string>& variables, std::unordered_set<std::string>& labels) {
+    const auto& node = entry->node;
+    bool isCv = node.instruction.value == "cv";
+    size_t firstUse = 0;
+
+    if ((isCv || node.instruction.value == "dfp") && !node.operands.empty()) {
+        const auto& name = node.operands[0].value;
+        auto& declarations = isCv ? variableDeclarations[name] : labelDeclarations[name];
+        declarations.erase(std::find(declarations.begin(), declarations.end(), entry));
+        (isCv ? variables : labels).insert(name);
+        firstUse = 1;
+    }
+
+    for (size_t i = firstUse; i < node.operands.size(); i++) {
+        if (node.operands[i].type != TokenType::IDENTIFIER) continue;
+
+        // An instruction may name the same thing twice
+        auto users = uses.find(node.operands[i].value);
+        if (users == uses.end()) continue;
+        users->second.erase(entry);
+        if (users->second.empty()) uses.erase(users);
+    }
+}
+
+// Settles which cv declares name, as the first pass of SemanticAnalyzer would, and rechecks
+// the instructions naming it if that changed its type or whether it exists
+void ScriptDocument::redeclareVariable(const std::string& name, std::unordered_set<Entry*>& recheck) {
+    std::optional<Type> type;
+    auto declarations = variableDeclarations.find(name);
+    if (declarations != variableDeclarations.end()) {
+        for (Entry* entry : declarations->second) {
+            auto declared = SemanticAnalyzer::declaredType(entry->node);
+            if (!declared) {
+                entry->declaration = declared.failure();
+            } else if (type) {
+                entry->declaration = SemanticAnalyzer::redeclaration(entry->node);
+            } else {
+                entry->declaration = {};
+                type = *declared;
+            }
+        }
+        if (declarations->second.empty()) variableDeclarations.erase(declarations);
+    }
+
+    const VariableInfo* current = symbols.findVariable(name);
+    if (current ? type && current->type == *type : !type) return;
+
+    symbols.removeVariable(name);
+    if (type) symbols.addVariable(name, *type);
+
+    if (auto users = uses.find(name); users != uses.end()) {
+        recheck.insert(users->second.begin(), users->second.end());
+    }
+}
+
+void ScriptDocument::redeclareLabel(const std::string& name, std::unordered_set<Entry*>& recheck) {
+    bool defined = false;
+    auto declarations = labelDeclarations.find(name);
+    if (declarations != labelDeclarations.end()) {
+        for (Entry* entry : declarations->second) {
+            auto valid = SemanticAnalyzer::checkLabelDeclaration(entry->node);
+            if (!valid) {
+                entry->declaration = valid;
+            } else if (defined) {
+                entry->declaration = SemanticAnalyzer::redeclaration(entry->node);
+            } else {
+                entry->declaration = {};
+                defined = true;
+            }
+        }
+        if (declarations->second.empty()) labelDeclarations.erase(declarations);
+    }
+
+    if (symbols.isLabel(name) == defined) return;
+
+    if (defined) {
+        symbols.addLabel(name, 0);
+    } else {
+        symbols.removeLabel(name);
+    }
+
+    if (auto users = uses.find(name); users != uses.end()) {
+        recheck.insert(users->second.begin(), users->second.end());
+    }
+}
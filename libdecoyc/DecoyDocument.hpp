@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../codegen/DecoySemanticAnalyzer.hpp"
+
+// What one edit cost
+struct DocumentEditStats {
+    size_t linesLexed = 0;
+    size_t instructionsParsed = 0;  // Including ones that failed to parse
+    size_t instructionsChecked = 0;
+};
+
+// A script being edited, kept checked between edits for editor feedback.
+//
+// Each line is lexed on its own (with the lines a string literal runs on to) and nearly every
+// instruction is one line, so an edit re-lexes only the lines it replaced. Parsing restarts at
+// the instruction the edit reaches into and stops as soon as it is back in step with the old
+// parse, at an instruction start after the edit. Declarations and name uses are indexed: when a
+// variable's type or a label's existence changes, only the instructions naming it are checked
+// again. Opening or closing a string changes how everything after it lexes, so that edit
+// re-lexes up to the next string boundary.
+//
+// diagnostics() and program() always match what CompilerContext::check reports for text(),
+// line numbers included: like the lexer, they do not count line breaks inside strings. Edits
+// are in editor lines, which do.
+class ScriptDocument {
+    public:
+    ScriptDocument();
+    explicit ScriptDocument(std::string_view text);
+
+    ScriptDocument(const ScriptDocument&) = delete;
+    ScriptDocument& operator=(const ScriptDocument&) = delete;
+
+    DocumentEditStats setText(std::string_view text);
+
+    // Replaces the text from (startLine, startColumn) up to (endLine, endColumn), zero-based with
+    // columns in bytes, the way editors describe a change. Throws std::out_of_range for a range
+    // outside the document.
+    DocumentEditStats edit(size_t startLine, size_t startColumn, size_t endLine, size_t endColumn, std::string_view text);
+
+    std::string text() const;
+    size_t lineCount() const { return lines.size(); }
+
+    // Every error, in source order
+    std::vector<Diagnostic> diagnostics() const;
+
+    // The instructions that parsed, in source order
+    std::vector<InstructionNode> program() const;
+
+    // Declared variables and their types, and labels. Variable offsets follow the order of
+    // declaring rather than the source and labels have no address; compile for a layout.
+    const SymbolTable& symbolTable() const { return symbols; }
+
+    private:
+    static constexpr size_t TO_END = static_cast<size_t>(-1);
+    static constexpr size_t FIRST_WINDOW_LINES = 64;
+
+    // An instruction that parsed. Its token lines count editor lines down from the line it
+    // starts on, so nothing changes when lines above it are added or removed.
+    struct Entry {
+        InstructionNode node;
+        size_t line = 0;    // Editor line; kept current only for cv and dfp, which are ordered by it
+        Status declaration; // cv and dfp
+        Status check;       // Everything else
+    };
+
+    struct Line {
+        std::string text;
+        std::vector<Token> tokens; // Of this line and its continued lines, with line numbers of 1
+        bool junk = false;         // Only characters the lexer skips; see lexGroup
+        bool continued = false;    // Inside a string from an earlier line; has no tokens of its own
+
+        // The parse of the instruction starting at this line, if one does
+        bool starts = false;
+        size_t span = 0;           // Lines after this one the parse looked at, or TO_END
+        std::optional<std::pair<size_t, std::string>> error; // Lines down, message
+        std::unique_ptr<Entry> entry;
+    };
+
+    std::vector<std::unique_ptr<Line>> lines; // Boxed, so adding a line moves pointers rather than lines
+
+    SymbolTable symbols;
+    std::vector<InstructionNode> noProgram;
+    SemanticAnalyzer analyzer;
+
+    // Declarations of each name in source order, and the instructions naming it
+    std::unordered_map<std::string, std::vector<Entry*>> variableDeclarations;
+    std::unordered_map<std::string, std::vector<Entry*>> labelDeclarations;
+    std::unordered_map<std::string, std::unordered_set<Entry*>> uses;
+
+    DocumentEditStats replaceLines(size_t first, size_t count, std::string_view text);
+
+    size_t relex(size_t from, size_t after, DocumentEditStats& stats);
+    void lexGroup(size_t first, size_t last);
+    static bool endsInString(const std::string& text, bool inString);
+    std::vector<size_t> compilerLines() const;
+
+    size_t firstAffectedLine(size_t line) const;
+    void shiftDeclarations(size_t first, long long delta);
+
+    void reparse(size_t from, size_t syncFrom, std::vector<std::unique_ptr<Entry>>& removed,
+        std::vector<Entry*>& added, DocumentEditStats& stats);
+    void fillWindow(size_t from, size_t to, std::vector<Token>& window) const;
+    static void clearLine(Line& line, std::vector<std::unique_ptr<Entry>>& removed);
+
+    void updateSymbols(const std::vector<std::unique_ptr<Entry>>& removed, const std::vector<Entry*>& added, DocumentEditStats& stats);
+    void index(Entry* entry, std::unordered_set<std::string>& variables, std::unordered_set<std::string>& labels);
+    void unindex(Entry* entry, std::unordered_set<std::string>& variables, std::unordered_set<std::string>& labels);
+    void redeclareVariable(const std::string& name, std::unordered_set<Entry*>& recheck);
+    void redeclareLabel(const std::string& name, std::unordered_set<Entry*>& recheck);
+};
@@ -0,0 +1,202 @@
+#include "DecoyLibrary.hpp"
+
+#include "../lexer/DecoyLexer.hpp"
+#include "../parser/DecoyParser.hpp"
+#include "../parser/DecoyParallelParser.hpp"
+#include "../codegen/DecoySemanticAnalyzer.hpp"
+#include "../codegen/DecoyExpressions.hpp"
+#include "../codegen/DecoyProfileGuided.hpp"
+#include "../codegen/DecoyInliner.hpp"
+#include "../codegen/DecoyRegisterAllocator.hpp"
+#include "../codegen/DecoyLineTable.hpp"
+
+CompileResult CompilerContext::compile(std::string_view source, const CompilerSettings& settings) {
+    CompileResult result;
+    compile(source, settings, result);
+    return result;
+}
+
+void CompilerContext::compile(std::string_view source, const CompilerSettings& settings, CompileResult& result) {
+    reset();
+    text.assign(source);
+    compileFrom(nullptr, settings, result);
+}
+
+void CompilerContext::compile(std::istream& source, const CompilerSettings& settings, CompileResult& result) {
+    reset();
+    compileFrom(&source, settings, result);
+}
+
+void CompilerContext::compileFrom(std::istream* input, const CompilerSettings& settings, CompileResult& result) {
+    result.success = false;
+    result.bytecode.clear();
+    result.lineTable.clear();
+    result.diagnostics.clear();
+
+    try {
+        build(input, settings, result);
+        result.success = true;
+    } catch (const CompileError& e) {
+        result.diagnostics.push_back({ e.getLine(), e.what() });
+    } catch (const std::exception& e) {
+        result.diagnostics.push_back({ 0, e.what() });
+    }
+
+    if (!result.success) {
+        result.bytecode.clear();
+        result.lineTable.clear();
+    }
+}
+
+CompileResult CompilerContext::check(std::string_view source, const CompilerSettings& settings) {
+    CompileResult result;
+    check(source, settings, result);
+    return result;
+}
+
+void CompilerContext::check(std::string_view source, const CompilerSettings& settings, CompileResult& result) {
+    reset();
+    result.bytecode.clear();
+    result.lineTable.clear();
+    result.diagnostics.clear();
+
+    // An instruction that fails to parse is left out of the program, so a cv or dfp with a
+    // syntax error also shows up as undefined wherever its name is used
+    Diagnostics diagnostics;
+    TokenStream stream(source);
+    Parser parser(stream);
+    parser.parse(ast, diagnostics);
+
+    SemanticAnalyzer analyzer(symbols, ast);
+    analyzer.setThreads(settings.threads);
+    analyzer.analyze(diagnostics);
+
+    diagnostics.sortByLine();
+    result.diagnostics = diagnostics.all();
+    result.success = diagnostics.empty();
+}
+
+void CompilerContext::build(std::istream* input, const CompilerSettings& settings, CompileResult& result) {
+    if (settings.keepTokens) {
+        if (input) {
+            TokenStream stream(*input);
+            while (stream.next(tokenBuffer)) {}
+        } else {
+            Lexer(text).tokenize(tokenBuffer);
+        }
+
+        Parser parser(tokenBuffer);
+        parser.parse(ast);
+    } else if (input) {
+        TokenStream stream(*input);
+        Parser parser(stream);
+        parser.parse(ast);
+    } else {
+        ast = ParallelParser(text, settings.threads).parse();
+    }
+
+    SemanticAnalyzer analyzer(symbols, ast);
+    analyzer.setThreads(settings.threads);
+    analyzer.analyze();
+
+    if (ExpressionLowering::hasExpressions(ast)) {
+        ast = ExpressionLowering(symbols).lower(ast);
+    }
+    if (RepeatLowering::hasRepeats(ast)) {
+        ast = RepeatLowering(symbols, settings.maxUnroll).lower(ast);
+    }
+    if (Inliner::hasCalls(ast)) {
+        ast = Inliner().inlineCalls(ast);
+    }
+
+    generator.setThreads(settings.threads);
+    generator.setInputBatching(settings.batchInput);
+    RegisterAllocator allocator(symbols, settings.registers);
+    const std::vector<InstructionNode>* emitted = &ast;
+    if (settings.profile && !settings.profile->empty()) {
+        auto counts = settings.profile->instructionCounts(settings.unitName, ast, generator.computeAddresses(ast));
+
+        // Profiles come from builds without --profile-use, which the lines above reproduce;
+        // the counts then show which remaining calls are hot
+        if (Inliner::hasCalls(ast)) {
+            ast = Inliner().inlineCalls(ast, &counts);
+        }
+
+        // Fills and spills join the program before layout, which keeps them next to their uses
+        const std::vector<InstructionNode>* program = &ast;
+        if (settings.registers > 0) {
+            layout = allocator.allocate(ast, &counts);
+            program = &layout;
+        }
+
+        ProfileGuidedOptimizer optimizer(symbols, counts);
+        optimizer.layoutVariables(*program);
+        layout = optimizer.layoutBlocks(*program);
+        emitted = &layout;
+    } else if (settings.registers > 0) {
+        layout = allocator.allocate(ast);
+        emitted = &layout;
+    }
+
+    LineTable lineTable(settings.debugColumns);
+    generator.setLineTable(settings.debugLines ? &lineTable : nullptr);
+    generator.setRegisters(settings.registers > 0 ? &allocator.assignments() : nullptr);
+    generator.generate(*emitted, result.bytecode);
+    generator.setLineTable(nullptr);
+    generator.setRegisters(nullptr);
+
+    if (settings.debugLines) {
+        result.lineTable = lineTable.encode();
+    }
+
+    if (result.bytecode.empty()) {
+        throw std::runtime_error("Generated bytecode is empty");
+    }
+}
+
+void CompilerContext::reset() {
+    text.clear();
+    tokenBuffer.clear();
+    ast.clear();
+    layout.clear();
+    symbols.reset();
+    generator.reset();
+}
+
+CompilerPool::Lease CompilerPool::acquire() {
+    std::unique_ptr<CompilerContext> context;
+    {
+        std::lock_guard lock(mutex);
+        if (!idle.empty()) {
+            context = std::move(idle.back());
+            idle.pop_back();
+        }
+    }
+    if (!context) {
+        context = std::make_unique<CompilerContext>();
+    }
+    return Lease(context.release(), Release{ this });
+}
+
+CompileResult CompilerPool::compile(std::string_view source, const CompilerSettings& settings) {
+    auto context = acquire();
+    return context->compile(source, settings);
+}
+
+size_t CompilerPool::idleCount() const {
+    std::lock_guard lock(mutex);
+    return idle.size();
+}
+
+void CompilerPool::release(CompilerContext* context) {
+    std::unique_ptr<CompilerContext> owned(context);
+    owned->reset();
+
+    std::lock_guard lock(mutex);
+    idle.push_back(std::move(owned));
+}
+
+CompileResult compileSource(std::string_view source, const CompilerSettings& settings) {
+    static CompilerPool pool;
+    return pool.compile(source, settings);
+}
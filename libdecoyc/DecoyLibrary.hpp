@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../codegen/DecoySymbolTable.hpp"
+#include "../codegen/DecoyCodeGenerator.hpp"
+#include "../codegen/DecoyProfile.hpp"
+#include "../codegen/DecoyRepeatLowering.hpp"
+
+// libdecoyc: the compiler as an in-memory library.
+//
+// Sources go in as text or streams and bytecode comes out; nothing here opens, writes or stats
+// a file, and errors come back as diagnostics rather than exceptions. A CompilerContext keeps
+// its symbol table, code generator and token/instruction buffers between compiles, so compiling
+// many sources on one context stops allocating once it has seen the largest of them.
+//
+// A context is used by one thread at a time. Contexts share no mutable state, so any number
+// of threads may each compile on their own context; CompilerPool hands recycled contexts out
+// to whichever thread asks.
+
+struct CompilerSettings {
+    bool debugLines = false;   // Also build a line table
+    bool debugColumns = false; // Line table records columns too
+    bool keepTokens = false;   // Lex serially and keep the token stream for tokens()
+    bool batchInput = false;   // Emit runs of literal pk/rk/mvm/dl as pkb, rkb and tl (see CodeGenerator)
+    size_t threads = 1;        // Frontend and backend threads (output is identical)
+    size_t maxUnroll = RepeatLowering::DEFAULT_MAX_UNROLL; // Most copies of a rep block body (see RepeatLowering)
+    size_t registers = 0;      // Variables to keep in VM registers, up to REGISTER_COUNT (see RegisterAllocator)
+    const ProfileData* profile = nullptr; // Optional; records are looked up by unitName
+    std::string unitName;
+};
+
+struct CompileResult {
+    bool success = false;
+    std::vector<uint8_t> bytecode;
+    std::vector<uint8_t> lineTable; // Empty unless built with debugLines
+    std::vector<Diagnostic> diagnostics;
+};
+
+class CompilerContext {
+    public:
+    CompilerContext() : generator(symbols) {}
+
+    CompilerContext(const CompilerContext&) = delete;
+    CompilerContext& operator=(const CompilerContext&) = delete;
+
+    CompileResult compile(std::string_view source, const CompilerSettings& settings = {});
+
+    // Overwrites result, reusing the capacity of its buffers
+    void compile(std::string_view source, const CompilerSettings& settings, CompileResult& result);
+
+    // Reads the source as it parses, through a TokenStream, so only the program is ever held
+    // whole rather than the text and its tokens too. The front end runs on one thread.
+    void compile(std::istream& source, const CompilerSettings& settings, CompileResult& result);
+
+    // Lexes, parses and analyzes without generating code and reports every error, in source
+    // order, instead of stopping at the first. Nothing is thrown for a bad script; the result
+    // never has bytecode.
+    CompileResult check(std::string_view source, const CompilerSettings& settings = {});
+    void check(std::string_view source, const CompilerSettings& settings, CompileResult& result);
+
+    // Forgets the last program but keeps every allocation for the next compile
+    void reset();
+
+    // State of the last compile, valid until the next compile or reset
+    const std::vector<Token>& tokens() const { return tokenBuffer; }
+    // After a compile, the program with its rep blocks lowered and calls inlined; after
+    // check(), as written
+    const std::vector<InstructionNode>& program() const { return ast; }
+    const SymbolTable& symbolTable() const { return symbols; }
+
+    private:
+    std::string text;
+    std::vector<Token> tokenBuffer;
+    std::vector<InstructionNode> ast;
+    std::vector<InstructionNode> layout; // Profile-guided block order
+    SymbolTable symbols;
+    CodeGenerator generator;
+
+    void compileFrom(std::istream* input, const CompilerSettings& settings, CompileResult& result);
+    void build(std::istream* input, const CompilerSettings& settings, CompileResult& result);
+};
+
+// Thread-safe free list of contexts. A lease returns its context, reset, when destroyed.
+class CompilerPool {
+    public:
+    struct Release {
+        CompilerPool* pool;
+        void operator()(CompilerContext* context) const { pool->release(context); }
+    };
+    using Lease = std::unique_ptr<CompilerContext, Release>;
+
+    Lease acquire();
+
+    CompileResult compile(std::string_view source, const CompilerSettings& settings = {});
+
+    size_t idleCount() const;
+
+    private:
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<CompilerContext>> idle;
+
+    void release(CompilerContext* context);
+};
+
+// Compiles on a context from a process-wide pool; safe to call from any thread
+CompileResult compileSource(std::string_view source, const CompilerSettings& settings = {});
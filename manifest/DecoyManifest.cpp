@@ -0,0 +1,86 @@
+#include "DecoyManifest.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+BuildManifest BuildManifest::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open manifest: " + path);
+    }
+
+    fs::path base = fs::path(path).parent_path();
+    auto location = [&](size_t lineNumber) { return path + ":" + std::to_string(lineNumber) + ": "; };
+
+    BuildManifest manifest;
+    std::unordered_map<std::string, size_t> sourceIndex; // Canonical path -> index into sources
+    std::set<std::string> outputs;
+    std::string text;
+    size_t lineNumber = 0;
+
+    while (std::getline(file, text)) {
+        lineNumber++;
+        text = text.substr(0, text.find('#'));
+
+        std::istringstream record(text);
+        std::string kind, value;
+        if (!(record >> kind)) continue;
+        std::getline(record >> std::ws, value);
+        value.erase(value.find_last_not_of(" \t\r") + 1);
+
+        if (value.empty()) {
+            throw std::runtime_error(location(lineNumber) + "expected a path after '" + kind + "'");
+        }
+        std::string resolved = (base / value).lexically_normal().string();
+
+        if (kind == "archive") {
+            if (!outputs.insert(fs::weakly_canonical(resolved).string()).second) {
+                throw std::runtime_error(location(lineNumber) + "archive " + value + " is listed twice");
+            }
+            manifest.archives.push_back({ resolved, {} });
+        } else if (kind == "input") {
+            if (manifest.archives.empty()) {
+                throw std::runtime_error(location(lineNumber) + "input before the first archive");
+            }
+
+            auto [it, added] = sourceIndex.emplace(fs::weakly_canonical(resolved).string(), manifest.sources.size());
+            if (added) {
+                manifest.sources.push_back(resolved);
+            }
+
+            auto& archive = manifest.archives.back();
+            if (std::find(archive.sources.begin(), archive.sources.end(), it->second) != archive.sources.end()) {
+                throw std::runtime_error(location(lineNumber) + "input " + value + " is listed twice for " + archive.output);
+            }
+            archive.sources.push_back(it->second);
+        } else {
+            throw std::runtime_error(location(lineNumber) + "expected 'archive <path>' or 'input <path>'");
+        }
+    }
+
+    for (const auto& archive : manifest.archives) {
+        if (archive.sources.empty()) {
+            throw std::runtime_error(path + ": archive " + archive.output + " has no inputs");
+        }
+    }
+    if (manifest.archives.empty()) {
+        throw std::runtime_error(path + ": no archives");
+    }
+
+    return manifest;
+}
+
+size_t BuildManifest::inputCount() const {
+    size_t count = 0;
+    for (const auto& archive : archives) {
+        count += archive.sources.size();
+    }
+    return count;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct ManifestArchive {
+    std::string output;
+    std::vector<size_t> sources; // Indices into BuildManifest::getSources()
+};
+
+// Many output archives and their inputs, built by one --manifest run.
+//
+// File format (one record per line, '#' starts a comment):
+//   archive <path>   starts a new output archive
+//   input <path>     adds a script to the archive above
+//
+// Paths run to the end of the line and are relative to the manifest's directory.
+// A script listed by several archives (under any spelling of its path) is one source,
+// so the build compiles it once and every archive shares the result.
+class BuildManifest {
+    public:
+    static BuildManifest load(const std::string& path);
+
+    const std::vector<ManifestArchive>& getArchives() const { return archives; }
+    const std::vector<std::string>& getSources() const { return sources; }
+
+    // Number of inputs over all archives, counting shared scripts once per archive
+    size_t inputCount() const;
+
+    private:
+    std::vector<ManifestArchive> archives;
+    std::vector<std::string> sources;
+};
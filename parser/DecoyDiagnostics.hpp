@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct Diagnostic {
+    size_t line; // 0 when the error has no source position
+    std::string message;
+};
+
+// Collects errors instead of throwing them, so a single pass can report all of them
+class Diagnostics {
+    public:
+    void error(size_t line, std::string message) { list.push_back({ line, std::move(message) }); }
+
+    void append(const Diagnostics& other) { list.insert(list.end(), other.list.begin(), other.list.end()); }
+
+    // Source order; errors on the same line keep the order they were reported in
+    void sortByLine() {
+        std::stable_sort(list.begin(), list.end(), [](const Diagnostic& a, const Diagnostic& b) { return a.line < b.line; });
+    }
+
+    bool empty() const { return list.empty(); }
+    size_t size() const { return list.size(); }
+    const Diagnostic& front() const { return list.front(); }
+    const std::vector<Diagnostic>& all() const { return list; }
+
+    void clear() { list.clear(); }
+
+    private:
+    std::vector<Diagnostic> list;
+};
+
+// Why a check failed; converts to any Expected or Status
+struct Failure {
+    std::string message;
+};
+
+inline Failure fail(std::string message) {
+    return { std::move(message) };
+}
+
+// A value, or the reason there is none
+template <typename T>
+class Expected {
+    public:
+    Expected(T value) : result(std::move(value)) {}
+    Expected(Failure failure) : message(std::move(failure.message)) {}
+
+    explicit operator bool() const { return result.has_value(); }
+    const T& operator*() const { return *result; }
+    const T* operator->() const { return &*result; }
+
+    const std::string& error() const { return message; }
+    Failure failure() const { return { message }; }
+
+    private:
+    std::optional<T> result;
+    std::string message;
+};
+
+// Expected without a value: success, or the reason for failing
+class Status {
+    public:
+    Status() = default;
+    Status(Failure failure) : failed(true), message(std::move(failure.message)) {}
+
+    explicit operator bool() const { return !failed; }
+
+    const std::string& error() const { return message; }
+
+    private:
+    bool failed = false;
+    std::string message;
+};
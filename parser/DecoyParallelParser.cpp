@@ -0,0 +1,109 @@
+#include "DecoyParallelParser.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <thread>
+
+std::vector<InstructionNode> ParallelParser::parse() {
+    // readString stops at '\0' as if it were the end of the source, which breaks quote pairing
+    size_t chunks = std::min(threads, source.size() / MIN_CHUNK_SIZE);
+    if (chunks < 2 || source.find('\0') != std::string::npos) {
+        return parseSerial();
+    }
+
+    auto cuts = findCuts(chunks);
+    std::vector<Chunk> results(cuts.size() - 1);
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < results.size(); i++) {
+        workers.emplace_back([&, i] {
+            parseChunk(std::string_view(source).substr(cuts[i], cuts[i + 1] - cuts[i]), results[i]);
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    workers.clear();
+
+    if (std::any_of(results.begin(), results.end(), [](const Chunk& chunk) { return chunk.failed; })) {
+        return parseSerial();
+    }
+
+    // Each chunk was lexed from line 1; place it after the lines of the chunks before it
+    std::vector<size_t> lineOffsets(results.size(), 0), programOffsets(results.size(), 0);
+    for (size_t i = 1; i < results.size(); i++) {
+        lineOffsets[i] = lineOffsets[i - 1] + results[i - 1].lines;
+        programOffsets[i] = programOffsets[i - 1] + results[i - 1].program.size();
+    }
+
+    std::vector<InstructionNode> program(programOffsets.back() + results.back().program.size());
+    for (size_t i = 0; i < results.size(); i++) {
+        workers.emplace_back([&, i] {
+            auto& chunk = results[i].program;
+            for (size_t n = 0; n < chunk.size(); n++) {
+                shiftLines(chunk[n], lineOffsets[i]);
+                program[programOffsets[i] + n] = std::move(chunk[n]);
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    return program;
+}
+
+std::vector<size_t> ParallelParser::findCuts(size_t chunks) const {
+    std::vector<size_t> cuts = { 0 };
+
+    // Every '"' outside a string opens one and the next '"' closes it, so quote parity
+    // tells whether a newline is inside a string literal
+    size_t scanned = 0;
+    bool inString = false;
+
+    for (size_t i = 1; i < chunks; i++) {
+        size_t cut = std::max(source.size() * i / chunks, cuts.back());
+        while ((cut = source.find('\n', cut)) != std::string::npos) {
+            inString ^= std::count(source.begin() + scanned, source.begin() + cut, '"') % 2 != 0;
+            scanned = cut;
+            cut++;
+
+            // Operands may continue on the next line, so only cut in front of an instruction
+            if (!inString && startsInstruction(cut)) break;
+        }
+
+        if (cut == std::string::npos || cut >= source.size()) break;
+        cuts.push_back(cut);
+    }
+
+    cuts.push_back(source.size());
+    return cuts;
+}
+
+bool ParallelParser::startsInstruction(size_t offset) const {
+    while (offset < source.size() && std::isspace(static_cast<unsigned char>(source[offset]))) offset++;
+
+    Lexer lexer(source.substr(offset, source.find('\n', offset) - offset));
+    auto tokens = lexer.tokenize();
+    return !tokens.empty() && tokens.front().type == TokenType::INSTRUCTION;
+}
+
+std::vector<InstructionNode> ParallelParser::parseSerial() const {
+    TokenStream stream(source);
+    Parser parser(stream);
+    return parser.parse();
+}
+
+void ParallelParser::parseChunk(std::string_view text, Chunk& chunk) {
+    try {
+        TokenStream stream(text);
+        Parser parser(stream);
+        chunk.program = parser.parse();
+        chunk.lines = stream.getLine() - 1;
+    } catch (const std::exception&) {
+        chunk.failed = true;
+    }
+}
+
+void ParallelParser::shiftLines(InstructionNode& node, size_t offset) {
+    node.instruction.line += offset;
+    for (auto& operand : node.operands) {
+        operand.line += offset;
+    }
+}
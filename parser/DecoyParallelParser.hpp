@@ -0,0 +1,40 @@
+#pragma once
+
+#include "DecoyParser.hpp"
+
+// Lexes and parses a single source on several threads.
+//
+// The source is cut at newlines that are not inside a string literal. No other token
+// spans a newline and every instruction ends at END_OF_LINE, so each chunk is lexed and
+// parsed on its own and the programs are concatenated with their line numbers shifted.
+// Chunks are parsed from a TokenStream, so their tokens are never all held at once.
+// If any chunk fails to parse (an instruction continued across a cut, or a real error)
+// the whole source is parsed again serially, so programs and diagnostics always match
+// the serial Lexer/Parser path.
+class ParallelParser {
+    public:
+    // Sources are only split into chunks of at least this many bytes
+    static constexpr size_t MIN_CHUNK_SIZE = 64 * 1024;
+
+    ParallelParser(const std::string& source, size_t threads)
+        : source(source), threads(threads) {}
+
+    std::vector<InstructionNode> parse();
+
+    private:
+    struct Chunk {
+        std::vector<InstructionNode> program;
+        size_t lines = 0; // Newlines outside strings, i.e. how far the next chunk's lines shift
+        bool failed = false;
+    };
+
+    const std::string& source;
+    size_t threads;
+
+    std::vector<size_t> findCuts(size_t chunks) const;
+    bool startsInstruction(size_t offset) const;
+    std::vector<InstructionNode> parseSerial() const;
+
+    static void parseChunk(std::string_view text, Chunk& chunk);
+    static void shiftLines(InstructionNode& node, size_t offset);
+};
@@ -1,27 +1,71 @@
 #include "DecoyParser.hpp"
 std::vector<InstructionNode> Parser::parse() {
     std::vector<InstructionNode> program;
-    
-    while (!isAtEnd()) {
-        program.push_back(parseInstruction());
-    }
-    
+    parse(program);
     return program;
 }
 
-bool Parser::isAtEnd() const {
-    return pos >= tokens.size();
+void Parser::parse(std::vector<InstructionNode>& program) {
+    Diagnostics errors;
+    if (!parse(program, errors)) {
+        throw CompileError(errors.front().message, errors.front().line);
+    }
+}
+
+bool Parser::parse(std::vector<InstructionNode>& program, Diagnostics& diagnostics) {
+    this->diagnostics = &diagnostics;
+    size_t reported = diagnostics.size();
+
+    while (true) {
+        discardParsed();
+        if (isAtEnd()) break;
+
+        InstructionNode node;
+        if (parseInstruction(node)) {
+            program.push_back(std::move(node));
+        } else {
+            skipToNextLine();
+        }
+    }
+
+    this->diagnostics = nullptr;
+    return diagnostics.size() == reported;
+}
+
+bool Parser::parseNext(InstructionNode& node, Diagnostics& diagnostics) {
+    this->diagnostics = &diagnostics;
+    bool parsed = parseInstruction(node);
+    if (!parsed) {
+        skipToNextLine();
+    }
+    this->diagnostics = nullptr;
+    return parsed;
+}
+
+bool Parser::isAtEnd() {
+    // Every streamed line ends with END_OF_LINE, so only a check for the end can run past it
+    if (pos >= tokens->size() && stream) {
+        stream->next(window);
+    }
+    return pos >= tokens->size();
+}
+
+// Between instructions nothing looks back, so a streamed parser drops what it has parsed
+void Parser::discardParsed() {
+    if (!stream) return;
+    window.erase(window.begin(), window.begin() + pos);
+    pos = 0;
 }
 
 const Token& Parser::peek() const {
-    return tokens[pos];
+    return (*tokens)[pos];
 }
 
 const Token& Parser::advance() {
-    return tokens[pos++];
+    return (*tokens)[pos++];
 }
 
-void Parser::consume(TokenType expected, const std::string& error) {
+bool Parser::consume(TokenType expected, const std::string& error) {
     if (expected != TokenType::END_OF_LINE) {
         while (!isAtEnd() && peek().type == TokenType::END_OF_LINE) {
             advance();
@@ -29,143 +73,260 @@ void Parser::consume(TokenType expected, const std::string& error) {
     }
 
     if (isAtEnd() || peek().type != expected) {
-        throw parseError(error);
+        return parseError(error);
     }
 
     advance();
+    return true;
+}
+
+bool Parser::parseError(const std::string& message) {
+    size_t line = isAtEnd() ? tokens->back().line : peek().line;
+    diagnostics->error(line, formatError(line, message));
+    return false;
 }
 
-std::runtime_error Parser::parseError(const std::string& message) {
-    size_t line = isAtEnd() ? tokens.back().line : peek().line;
-    return std::runtime_error("Line " + std::to_string(line) + ": " + message);
+std::string Parser::formatError(size_t line, const std::string& message) {
+    return "Line " + std::to_string(line) + ": " + message;
+}
+
+// Resumes after a failed instruction. Operands may continue on later lines, so the error can
+// sit at the first token of a line; parsing resumes right there rather than skipping that line.
+void Parser::skipToNextLine() {
+    while (!isAtEnd() && (*tokens)[pos - 1].type != TokenType::END_OF_LINE) {
+        advance();
+    }
 }
 
-InstructionNode Parser::parseInstruction() {
-    InstructionNode node;
+bool Parser::parseInstruction(InstructionNode& node) {
     node.instruction = advance();
 
     const std::string& inst = node.instruction.value;
 
-    if (inst == "cv") {
-        parseCv(node);
+    bool parsed;
+    if (node.instruction.type == TokenType::IDENTIFIER && !isAtEnd()
+        && peek().type == TokenType::OPERATOR && peek().value == "=") {
+        parsed = parseAssignment(node);
+    } else if (inst == "cv") {
+        parsed = parseCv(node);
     } else if (inst == "av") {
-        parseAv(node);
+        parsed = parseAv(node);
     } else if (inst == "aav" || inst == "sav" || inst == "mav" || inst == "dav" || inst == "moav") {
-        parseMathAssignment(node);
+        parsed = parseMathAssignment(node);
     } else if (inst == "inc" || inst == "dec") {
-        parseIncDec(node);
+        parsed = parseIncDec(node);
     } else if (inst == "p" || inst == "pl") {
-        parsePrint(node);
+        parsed = parsePrint(node);
     } else if (inst == "pk" || inst == "rk") {
-        parseKeyOperation(node);
+        parsed = parseKeyOperation(node);
     } else if (inst == "ikd") {
-        parseIkd(node);
+        parsed = parseIkd(node);
     } else if (inst == "mvm") {
-        parseMvm(node);
+        parsed = parseMvm(node);
     } else if (inst == "dfp") {
-        parseDfp(node);
+        parsed = parseDfp(node);
     } else if (inst == "jmp") {
-        parseJmp(node);
+        parsed = parseJmp(node);
     } else if (inst == "cejmp" || inst == "cgjmp" || inst == "cljmp" || inst == "cegjmp" || inst == "celjmp") {
-        parseConditionalJmp(node);
+        parsed = parseConditionalJmp(node);
     } else if (inst == "dl") {
-        parseDl(node);
+        parsed = parseDl(node);
     } else if (inst == "nop") {
-        parseNop(node);
+        parsed = parseNop(node);
+    } else if (inst == "rep") {
+        parsed = parseRep(node);
+    } else if (inst == "endrep") {
+        parsed = parseEndrep(node);
+    } else if (inst == "call") {
+        parsed = parseCall(node);
+    } else if (inst == "ret") {
+        parsed = parseRet(node);
     } else {
-        throw parseError("Unknown instruction " + inst);
+        return parseError("Unknown instruction " + inst);
     }
 
-    consume(TokenType::END_OF_LINE, "Expected end of line after instruction");
-    return node;
+    return parsed && consume(TokenType::END_OF_LINE, "Expected end of line after instruction");
 }
 
-void Parser::parseCv(InstructionNode& node) {
-    node.operands.push_back(consumeIdentifier("Expected a variable name"));
-    node.operands.push_back(consumeType("Expected a variable type (e.g., ui8, i32, etc"));
+bool Parser::parseCv(InstructionNode& node) {
+    return consumeIdentifier(node, "Expected a variable name")
+        && consumeType(node, "Expected a variable type (e.g., ui8, i32, etc");
 }
 
-void Parser::parseAv(InstructionNode& node) {
-    node.operands.push_back(consumeIdentifier("Expected a variable name"));
-    consumeValueOperand(node);
+bool Parser::parseAv(InstructionNode& node) {
+    return consumeIdentifier(node, "Expected a variable name") && consumeValueOperand(node);
 }
 
-void Parser::parseMathAssignment(InstructionNode& node) {
-    node.operands.push_back(consumeIdentifier("Expected a variable name"));
-    consumeValueOperand(node);
+bool Parser::parseMathAssignment(InstructionNode& node) {
+    return consumeIdentifier(node, "Expected a variable name") && consumeValueOperand(node);
 }
 
-void Parser::parseIncDec(InstructionNode& node) {
-    node.operands.push_back(consumeIdentifier("Expected a variable name"));
+bool Parser::parseIncDec(InstructionNode& node) {
+    return consumeIdentifier(node, "Expected a variable name");
 }
 
-void Parser::parsePrint(InstructionNode& node) {
+bool Parser::parsePrint(InstructionNode& node) {
     while (peek().type == TokenType::STRING || peek().type == TokenType::IDENTIFIER) {
         node.operands.push_back(advance());
     }
 
     if (node.operands.empty()) {
-        throw parseError("Print instruction requires at least one operand");
+        return parseError("Print instruction requires at least one operand");
     }
+    return true;
 }
 
-void Parser::parseKeyOperation(InstructionNode& node) {
+bool Parser::parseKeyOperation(InstructionNode& node) {
     if (peek().type == TokenType::LITERAL || peek().type == TokenType::IDENTIFIER) {
         node.operands.push_back(advance());
-    } else {
-        throw parseError("Key operation requires literal or variable");
+        return true;
     }
+    return parseError("Key operation requires literal or variable");
+}
+
+bool Parser::parseIkd(InstructionNode& node) {
+    return consumeIdentifier(node, "Expected a variable name")
+        && consumeIdentifier(node, "Expected result variable");
+}
+
+bool Parser::parseMvm(InstructionNode& node) {
+    return consumeValueOperand(node) && consumeValueOperand(node);
+}
+
+bool Parser::parseDfp(InstructionNode& node) {
+    return consumeIdentifier(node, "Expected a label name");
 }
 
-void Parser::parseIkd(InstructionNode& node) {
-    node.operands.push_back(consumeIdentifier("Expected a variable name"));
-    node.operands.push_back(consumeIdentifier("Expected result variable"));
+bool Parser::parseJmp(InstructionNode& node) {
+    return consumeIdentifier(node, "Expected a label name");
 }
 
-void Parser::parseMvm(InstructionNode& node) {
-    consumeValueOperand(node);
-    consumeValueOperand(node);
+bool Parser::parseConditionalJmp(InstructionNode& node) {
+    return consumeIdentifier(node, "Expected first operand variable")
+        && consumeIdentifier(node, "Expected second operand variable")
+        && consumeIdentifier(node, "Expected true label")
+        && consumeIdentifier(node, "Expected false label");
 }
 
-void Parser::parseDfp(InstructionNode& node) {
-    node.operands.push_back(consumeIdentifier("Expected a label name"));
+bool Parser::parseDl(InstructionNode& node) {
+    return consumeValueOperand(node);
 }
 
-void Parser::parseJmp(InstructionNode& node) {
-    node.operands.push_back(consumeIdentifier("Expected a label name"));
+bool Parser::parseNop(InstructionNode& node) {
+    if (peek().type != TokenType::END_OF_LINE) {
+        return parseError("NOP instruction takes no operands");
+    }
+    return true;
+}
+
+bool Parser::parseRep(InstructionNode& node) {
+    if (peek().type == TokenType::LITERAL) {
+        node.operands.push_back(advance());
+        return true;
+    }
+    return parseError("Expected a literal repeat count");
 }
 
-void Parser::parseConditionalJmp(InstructionNode& node) {
-    node.operands.push_back(consumeIdentifier("Expected first operand variable"));
-    node.operands.push_back(consumeIdentifier("Expected second operand variable"));
-    node.operands.push_back(consumeIdentifier("Expected true label"));
-    node.operands.push_back(consumeIdentifier("Expected false label"));
+bool Parser::parseEndrep(InstructionNode& node) {
+    if (peek().type != TokenType::END_OF_LINE) {
+        return parseError("endrep takes no operands");
+    }
+    return true;
 }
 
-void Parser::parseDl(InstructionNode& node) {
-    consumeValueOperand(node);
+bool Parser::parseCall(InstructionNode& node) {
+    return consumeIdentifier(node, "Expected a label name");
 }
 
-void Parser::parseNop(InstructionNode& node) {
+bool Parser::parseRet(InstructionNode& node) {
     if (peek().type != TokenType::END_OF_LINE) {
-        throw parseError("NOP instruction takes no operands");
+        return parseError("ret takes no operands");
     }
+    return true;
 }
 
-Token Parser::consumeIdentifier(const std::string& error) {
-    consume(TokenType::IDENTIFIER, error);
-    return tokens[pos - 1];
+// x = expression. The node is an "=" instruction whose operands are the assigned variable and
+// then the expression in postfix order, with "neg" for a unary minus; ExpressionLowering turns
+// it into plain instructions. The expression ends with its line.
+bool Parser::parseAssignment(InstructionNode& node) {
+    Token destination = node.instruction;
+    node.instruction = advance();
+    node.instruction.type = TokenType::INSTRUCTION;
+    node.instruction.column = destination.column;
+    node.operands.push_back(std::move(destination));
+    return parseExpression(node, 0, 0);
 }
 
-Token Parser::consumeType(const std::string& error) {
-    consume(TokenType::TYPE, error);
-    return tokens[pos - 1];
+// Precedence climbing: operands bind to the operator of at least minPrecedence on their left
+bool Parser::parseExpression(InstructionNode& node, int minPrecedence, size_t depth) {
+    if (!parseUnary(node, depth)) return false;
+
+    while (!isAtEnd() && peek().type == TokenType::OPERATOR) {
+        int precedence = binaryPrecedence(peek().value);
+        if (precedence < minPrecedence) break;
+
+        Token op = advance();
+        if (!parseExpression(node, precedence + 1, depth)) return false;
+        node.operands.push_back(std::move(op));
+    }
+    return true;
 }
 
-void Parser::consumeValueOperand(InstructionNode& node) {
+bool Parser::parseUnary(InstructionNode& node, size_t depth) {
+    if (depth == MAX_EXPRESSION_DEPTH) {
+        return parseError("Expression is nested too deeply");
+    }
+    if (isAtEnd()) {
+        return parseError("Expected a variable, literal or '(' in expression");
+    }
+
+    const Token& token = peek();
+    if (token.type == TokenType::IDENTIFIER || token.type == TokenType::LITERAL) {
+        node.operands.push_back(advance());
+        return true;
+    }
+    if (token.type == TokenType::OPERATOR && token.value == "-") {
+        Token neg = advance();
+        neg.value = "neg";
+        if (!parseUnary(node, depth + 1)) return false;
+        node.operands.push_back(std::move(neg));
+        return true;
+    }
+    if (token.type == TokenType::OPERATOR && token.value == "(") {
+        advance();
+        if (!parseExpression(node, 0, depth + 1)) return false;
+        if (isAtEnd() || peek().type != TokenType::OPERATOR || peek().value != ")") {
+            return parseError("Expected ')' in expression");
+        }
+        advance();
+        return true;
+    }
+    return parseError("Expected a variable, literal or '(' in expression");
+}
+
+// -1 for anything that does not continue an expression
+int Parser::binaryPrecedence(const std::string& op) {
+    if (op == "+" || op == "-") return 1;
+    if (op == "*" || op == "/" || op == "%") return 2;
+    return -1;
+}
+
+bool Parser::consumeIdentifier(InstructionNode& node, const std::string& error) {
+    if (!consume(TokenType::IDENTIFIER, error)) return false;
+    node.operands.push_back((*tokens)[pos - 1]);
+    return true;
+}
+
+bool Parser::consumeType(InstructionNode& node, const std::string& error) {
+    if (!consume(TokenType::TYPE, error)) return false;
+    node.operands.push_back((*tokens)[pos - 1]);
+    return true;
+}
+
+bool Parser::consumeValueOperand(InstructionNode& node) {
     if (peek().type == TokenType::LITERAL || peek().type == TokenType::IDENTIFIER) {
         node.operands.push_back(advance());
-    } else {
-        throw parseError("Expected literal value or variable");
+        return true;
     }
+    return parseError("Expected literal value or variable");
 }
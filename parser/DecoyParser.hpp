@@ -1,5 +1,6 @@
 #pragma once
 #include "../lexer/DecoyLexer.hpp"
+#include "DecoyDiagnostics.hpp"
 
 #include <stdexcept>
 
@@ -27,6 +28,26 @@ enum class Instruction : uint8_t {
     CEGJMP = 20, // Conditional Greater Than or Equal To Jump (Jump to 1st provided jump position if condition is true, else jump to 2nd) (ex: cegjmp var var2 tag tag2)
     CELJMP = 21, // Conditional Less Than or Equal To Jump (Jump to 1st provided jump position if condition is true, else jump to 2nd) (ex: celjmp var var2 tag tag2)
     DL = 22, // Delay the program by the given milliseconds (ex: dl 5000) (ex: dl var)
+    PKB = 23, // Press a batch of keys; emitted by the code generator for consecutive literal pk
+    RKB = 24, // Release a batch of keys; emitted by the code generator for consecutive literal rk
+    TL = 25, // Play a timeline of (delay, pk/rk/mvm) records; emitted for literal input sequences with dl
+    CALL = 26, // Call the subroutine at the given position, returning after the call on ret (ex: call tag)
+    RET = 27, // Return from the innermost call (ex: ret)
+    FILL = 28, // Load a variable into its VM register; emitted by the register allocator
+    SPILL = 29, // Store a VM register back to its variable; emitted by the register allocator
+    AVR = 30, // Register forms of av..dec: the assigned variable is held in a VM register
+    AAVR = 31,
+    SAVR = 32,
+    MAVR = 33,
+    DAVR = 34,
+    MOAVR = 35,
+    INCR = 36,
+    DECR = 37,
+    CEJMPR = 38, // Register forms of the conditional jumps: either operand may be held in a VM register
+    CGJMPR = 39,
+    CLJMPR = 40,
+    CEGJMPR = 41,
+    CELJMPR = 42,
     NOP = 255, // No Operation (Do nothing) (ex: nop)
 };
 
@@ -42,6 +63,18 @@ enum class Type : uint8_t {
     STR = 8, // String
 };
 
+// An error that points at a source line; line is 0 when there is no position to report
+class CompileError : public std::runtime_error {
+    public:
+    CompileError(const std::string& message, size_t line)
+        : std::runtime_error(message), line(line) {}
+
+    size_t getLine() const { return line; }
+
+    private:
+    size_t line;
+};
+
 struct InstructionNode {
     Token instruction;
     std::vector<Token> operands;
@@ -49,40 +82,80 @@ struct InstructionNode {
 
 class Parser {
     public:
-    Parser(const std::vector<Token>& tokens) : tokens(tokens), pos(0) {}
+    Parser(const std::vector<Token>& tokens) : tokens(&tokens), pos(0) {}
+
+    // Pulls tokens from stream as it goes and keeps only those of the instruction being parsed
+    explicit Parser(TokenStream& stream) : tokens(&window), stream(&stream), pos(0) {}
 
+    // Throws a CompileError for the first syntax error
     std::vector<InstructionNode> parse();
 
+    // Appends the parsed instructions to program, reusing its capacity
+    void parse(std::vector<InstructionNode>& program);
+
+    // Reports every syntax error instead of throwing: an instruction that fails to parse is
+    // reported, left out of program, and parsing resumes at the next line. Returns false if
+    // anything was reported.
+    bool parse(std::vector<InstructionNode>& program, Diagnostics& diagnostics);
+
+    // Parses only the next instruction, for callers that parse a stretch of lines at a time
+    // (ScriptDocument). Same recovery as above: on an error, reports it, skips to the next
+    // line and returns false.
+    bool parseNext(InstructionNode& node, Diagnostics& diagnostics);
+
+    bool isAtEnd();
+    size_t position() const { return pos; } // Into the token vector; streamed parsers restart at each instruction
+
+    // The text of a syntax error reported at line
+    static std::string formatError(size_t line, const std::string& message);
+
     private:
-    const std::vector<Token>& tokens;
+    // Parentheses and unary minuses deeper than this are an error rather than a stack overflow
+    static constexpr size_t MAX_EXPRESSION_DEPTH = 256;
+
+    const std::vector<Token>* tokens;
+    TokenStream* stream = nullptr;
+    std::vector<Token> window; // Streamed tokens from the start of the current instruction
     size_t pos;
+    Diagnostics* diagnostics = nullptr;
 
-    bool isAtEnd() const;
     const Token& peek() const;
     const Token& advance();
 
-    void consume(TokenType expected, const std::string& error);
+    bool consume(TokenType expected, const std::string& error);
+
+    // Reports message at the current token; always returns false so callers can return it
+    bool parseError(const std::string& message);
 
-    std::runtime_error parseError(const std::string& message);
+    bool parseInstruction(InstructionNode& node);
+    void skipToNextLine();
+    void discardParsed();
 
-    InstructionNode parseInstruction();
+    bool parseCv(InstructionNode& node);
+    bool parseAv(InstructionNode& node);
+    bool parseMathAssignment(InstructionNode& node);
+    bool parseIncDec(InstructionNode& node);
+    bool parsePrint(InstructionNode& node);
+    bool parseKeyOperation(InstructionNode& node);
+    bool parseIkd(InstructionNode& node);
+    bool parseMvm(InstructionNode& node);
+    bool parseDfp(InstructionNode& node);
+    bool parseJmp(InstructionNode& node);
+    bool parseConditionalJmp(InstructionNode& node);
+    bool parseDl(InstructionNode& node);
+    bool parseNop(InstructionNode& node);
+    bool parseRep(InstructionNode& node);
+    bool parseEndrep(InstructionNode& node);
+    bool parseCall(InstructionNode& node);
+    bool parseRet(InstructionNode& node);
 
-    void parseCv(InstructionNode& node);
-    void parseAv(InstructionNode& node);
-    void parseMathAssignment(InstructionNode& node);
-    void parseIncDec(InstructionNode& node);
-    void parsePrint(InstructionNode& node);
-    void parseKeyOperation(InstructionNode& node);
-    void parseIkd(InstructionNode& node);
-    void parseMvm(InstructionNode& node);
-    void parseDfp(InstructionNode& node);
-    void parseJmp(InstructionNode& node);
-    void parseConditionalJmp(InstructionNode& node);
-    void parseDl(InstructionNode& node);
-    void parseNop(InstructionNode& node);
+    bool parseAssignment(InstructionNode& node);
+    bool parseExpression(InstructionNode& node, int minPrecedence, size_t depth);
+    bool parseUnary(InstructionNode& node, size_t depth);
+    static int binaryPrecedence(const std::string& op);
 
-    Token consumeIdentifier(const std::string& error);
-    Token consumeType(const std::string& error);
+    bool consumeIdentifier(InstructionNode& node, const std::string& error);
+    bool consumeType(InstructionNode& node, const std::string& error);
     
-    void consumeValueOperand(InstructionNode& node);
+    bool consumeValueOperand(InstructionNode& node);
 };
\ No newline at end of file
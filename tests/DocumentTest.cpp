@@ -0,0 +1,142 @@
+// Applies seeded random edits to a ScriptDocument and checks after each one that its diagnostics
+// and program match what CompilerContext::check reports for the same text from scratch. Edits
+// are cut from script fragments, including half instructions, line breaks and lone quotes, so
+// they split, join and reopen instructions and strings. Exits non-zero at the first mismatch.
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "libdecoyc/DecoyDocument.hpp"
+#include "libdecoyc/DecoyLibrary.hpp"
+
+static const char* const START =
+    "cv n ui32\n"
+    "cv zero ui32\n"
+    "cv ratio f32\n"
+    "av n 3\n"
+    "dfp top\n"
+    "rep 2\n"
+    "inc n\n"
+    "p \"tick \" n\n"
+    "endrep\n"
+    "call sub\n"
+    "dec n\n"
+    "cgjmp n zero top done\n"
+    "dfp done\n"
+    "pl \"two\nlines\" n\n"
+    "jmp end\n"
+    "dfp sub\n"
+    "ratio = ratio * 2 + 1.5\n"
+    "ret\n"
+    "dfp end\n";
+
+static const char* const FRAGMENTS[] = {
+    "", "\n", "\n\n", " ", "\"", "\"\n", "n", "zero", "ratio", "top", "done", "missing", "5", "-5", "1.5", "ui8",
+    "cv ", "av ", "inc ", "dec ", "pl ", "p ", "jmp ", "dfp ", "call ", "ret", "rep ", "endrep",
+    "cv n ui8\n", "cv total ui32\n", "cv ratio ui32\n", "av total 7\n", "inc total\n", "dfp top\n",
+    "dfp missing\n", "jmp missing\n", "rep 3\n", "endrep\n", "pl \"hello\" n\n", "pl \"open\n",
+    "n = (n + 1) * 2\n", "n = \n", "bogus n\n",
+};
+
+static std::vector<std::string> splitLines(const std::string& text) {
+    std::vector<std::string> lines(1);
+    for (char c : text) {
+        if (c == '\n') lines.emplace_back();
+        else lines.back() += c;
+    }
+    return lines;
+}
+
+static bool sameTokens(const Token& a, const Token& b) {
+    return a.type == b.type && a.value == b.value && a.line == b.line;
+}
+
+// Empty when the document matches a fresh check of its text, otherwise the first difference
+static std::string compare(const ScriptDocument& document, CompilerContext& context) {
+    std::string text = document.text();
+    CompileResult expected = context.check(text);
+    std::vector<Diagnostic> diagnostics = document.diagnostics();
+
+    for (size_t i = 0; i < std::max(diagnostics.size(), expected.diagnostics.size()); i++) {
+        if (i >= diagnostics.size()) return "missing diagnostic: " + expected.diagnostics[i].message;
+        if (i >= expected.diagnostics.size()) return "extra diagnostic: " + diagnostics[i].message;
+        if (diagnostics[i].line != expected.diagnostics[i].line || diagnostics[i].message != expected.diagnostics[i].message) {
+            return "diagnostic " + std::to_string(i) + ": " + std::to_string(diagnostics[i].line) + ": " + diagnostics[i].message
+                + ", expected " + std::to_string(expected.diagnostics[i].line) + ": " + expected.diagnostics[i].message;
+        }
+    }
+
+    std::vector<InstructionNode> program = document.program();
+    const std::vector<InstructionNode>& ast = context.program();
+    if (program.size() != ast.size()) {
+        return std::to_string(program.size()) + " instructions, expected " + std::to_string(ast.size());
+    }
+    for (size_t i = 0; i < program.size(); i++) {
+        bool same = sameTokens(program[i].instruction, ast[i].instruction) && program[i].operands.size() == ast[i].operands.size();
+        for (size_t j = 0; same && j < program[i].operands.size(); j++) {
+            same = sameTokens(program[i].operands[j], ast[i].operands[j]);
+        }
+        if (!same) {
+            return "instruction " + std::to_string(i) + " (" + program[i].instruction.value + ") differs from "
+                + ast[i].instruction.value + " at line " + std::to_string(ast[i].instruction.line);
+        }
+    }
+    return "";
+}
+
+int main() {
+    constexpr uint32_t SEEDS = 20;
+    constexpr int EDITS = 200;
+    constexpr size_t FRAGMENT_COUNT = sizeof(FRAGMENTS) / sizeof(FRAGMENTS[0]);
+
+    CompilerContext context;
+    std::vector<std::string> startLines = splitLines(START);
+    for (uint32_t seed = 1; seed <= SEEDS; seed++) {
+        std::mt19937 random(seed);
+        auto below = [&](size_t n) { return std::uniform_int_distribution<size_t>(0, n - 1)(random); };
+
+        ScriptDocument document(START);
+        std::string difference = compare(document, context);
+        if (!difference.empty()) {
+            std::cerr << "opening: " << difference << '\n';
+            return 1;
+        }
+        for (int step = 0; step < EDITS; step++) {
+            std::vector<std::string> lines = splitLines(document.text());
+
+            // Half the time a whole line of the opening script, so the document keeps growing
+            // instructions to break; otherwise mostly insertions, like typing, or a replacement
+            // within a line or, now and then, across the next
+            size_t startLine = below(lines.size()), startColumn = 0;
+            size_t endLine = startLine, endColumn = 0;
+            std::string inserted;
+            if (below(2) == 0) {
+                inserted = startLines[below(startLines.size() - 1)] + "\n";
+            } else {
+                startColumn = endColumn = below(lines[startLine].size() + 1);
+                if (below(3) == 0) {
+                    endLine = std::min(lines.size() - 1, startLine + (below(6) == 0 ? 1 : 0));
+                    endColumn = below(lines[endLine].size() + 1);
+                    if (endLine == startLine) endColumn = std::max(endColumn, startColumn);
+                }
+                inserted = FRAGMENTS[below(FRAGMENT_COUNT)];
+                if (below(4) == 0) inserted += FRAGMENTS[below(FRAGMENT_COUNT)];
+            }
+
+            document.edit(startLine, startColumn, endLine, endColumn, inserted);
+            difference = compare(document, context);
+            if (!difference.empty()) {
+                std::cerr << "seed " << seed << ", edit " << step << " (" << startLine << ':' << startColumn << " to "
+                          << endLine << ':' << endColumn << " with \"" << inserted << "\"): " << difference
+                          << "\n--- text\n" << document.text() << '\n';
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+# Builds SCRIPTS into two archives with -g against the same fresh build cache, checks that the
+# second build wrote the same bytes as the first, and compares what each build reports about the
+# cache with EXPECTED. Run with DECOY_UPDATE_EXPECTED set in the environment to rewrite EXPECTED
+# instead.
+
+string(REPLACE "|" ";" SCRIPTS "${SCRIPTS}")
+
+file(REMOVE_RECURSE ${CACHE})
+set(output "")
+function(run_build archive)
+    file(REMOVE ${archive})
+    execute_process(COMMAND ${COMPILER} --cache ${CACHE} -g -i ${SCRIPTS} -o ${archive}
+        RESULT_VARIABLE result OUTPUT_VARIABLE log ERROR_VARIABLE log)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Building ${archive} failed:\n${log}")
+    endif()
+    string(REGEX MATCH "Build cache: [^\n]*\n" cache "${log}")
+    set(output "${output}${cache}" PARENT_SCOPE)
+endfunction()
+
+run_build(${ARCHIVE}.first)
+run_build(${ARCHIVE})
+
+file(SHA256 ${ARCHIVE}.first first)
+file(SHA256 ${ARCHIVE} second)
+if(NOT first STREQUAL second)
+    message(FATAL_ERROR "Building from the cache changed the archive")
+endif()
+
+if(DEFINED ENV{DECOY_UPDATE_EXPECTED})
+    file(WRITE ${EXPECTED} "${output}")
+    return()
+endif()
+
+file(READ ${EXPECTED} expected)
+string(REPLACE "\r" "" expected "${expected}")
+string(REPLACE "\r" "" output "${output}")
+if(NOT output STREQUAL expected)
+    message(FATAL_ERROR "Output differs from ${EXPECTED}\n--- expected\n${expected}\n--- actual\n${output}")
+endif()
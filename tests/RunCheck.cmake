@@ -0,0 +1,24 @@
+# Runs --check on SCRIPTS from the directory they live in, so diagnostics name them by their
+# relative paths, and compares every diagnostic printed with EXPECTED. The check must fail. Run
+# with DECOY_UPDATE_EXPECTED set in the environment to rewrite EXPECTED instead.
+
+string(REPLACE "|" ";" SCRIPTS "${SCRIPTS}")
+
+execute_process(COMMAND ${COMPILER} --check -i ${SCRIPTS}
+    WORKING_DIRECTORY ${SOURCE_DIR}
+    RESULT_VARIABLE result OUTPUT_VARIABLE log ERROR_VARIABLE output)
+if(result EQUAL 0)
+    message(FATAL_ERROR "Checking succeeded but should have reported errors:\n${log}")
+endif()
+
+if(DEFINED ENV{DECOY_UPDATE_EXPECTED})
+    file(WRITE ${EXPECTED} "${output}")
+    return()
+endif()
+
+file(READ ${EXPECTED} expected)
+string(REPLACE "\r" "" expected "${expected}")
+string(REPLACE "\r" "" output "${output}")
+if(NOT output STREQUAL expected)
+    message(FATAL_ERROR "Output differs from ${EXPECTED}\n--- expected\n${expected}\n--- actual\n${output}")
+endif()
@@ -0,0 +1,38 @@
+# Compiles SCRIPTS with OPTIONS into ARCHIVE, runs it with RUN_OPTIONS in virtual time and compares the input
+# events it recorded, prints included, with EXPECTED. Lists are passed joined with '|'. Run
+# with DECOY_UPDATE_EXPECTED set in the environment to rewrite EXPECTED instead.
+
+string(REPLACE "|" ";" SCRIPTS "${SCRIPTS}")
+string(REPLACE "|" ";" OPTIONS "${OPTIONS}")
+string(REPLACE "|" ";" RUN_OPTIONS "${RUN_OPTIONS}")
+
+execute_process(COMMAND ${COMPILER} ${OPTIONS} -i ${SCRIPTS} -o ${ARCHIVE}
+    RESULT_VARIABLE result OUTPUT_VARIABLE output ERROR_VARIABLE output)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Compiling failed:\n${output}")
+endif()
+
+execute_process(COMMAND ${RUNNER} --virtual-time --events --quiet --max-steps 100000 ${RUN_OPTIONS} -i ${ARCHIVE}
+    RESULT_VARIABLE result OUTPUT_VARIABLE output ERROR_VARIABLE output)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Running failed:\n${output}")
+endif()
+
+# Drop the banner and the execution stats, which hold the version and wall times; a run cut off
+# by --max-steps still differs in its events
+string(REPLACE "\r" "" output "${output}")
+string(FIND "${output}" "\n\n" banner)
+math(EXPR banner "${banner} + 2")
+string(SUBSTRING "${output}" ${banner} -1 output)
+string(REGEX REPLACE "Execution Stats:\n-+\n[^-]*-+\n" "" output "${output}")
+
+if(DEFINED ENV{DECOY_UPDATE_EXPECTED})
+    file(WRITE ${EXPECTED} "${output}")
+    return()
+endif()
+
+file(READ ${EXPECTED} expected)
+string(REPLACE "\r" "" expected "${expected}")
+if(NOT output STREQUAL expected)
+    message(FATAL_ERROR "Output differs from ${EXPECTED}\n--- expected\n${expected}\n--- actual\n${output}")
+endif()
@@ -0,0 +1,42 @@
+# Builds SCRIPTS into a fresh ARCHIVE with --update -g, updates it again unchanged, then once more
+# from the first script alone without -g, and compares what each update reports plus the entries
+# left in the archive with EXPECTED. Run with DECOY_UPDATE_EXPECTED set in the environment to
+# rewrite EXPECTED instead.
+
+string(REPLACE "|" ";" SCRIPTS "${SCRIPTS}")
+list(GET SCRIPTS 0 FIRST_SCRIPT)
+
+file(REMOVE ${ARCHIVE})
+set(output "")
+function(run_update)
+    execute_process(COMMAND ${COMPILER} --update ${ARGN} -o ${ARCHIVE}
+        RESULT_VARIABLE result OUTPUT_VARIABLE log ERROR_VARIABLE log)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Updating failed:\n${log}")
+    endif()
+    string(REGEX MATCH "Archive update: [^\n]*\n" update "${log}")
+    set(output "${output}${update}" PARENT_SCOPE)
+endfunction()
+
+run_update(-g -i ${SCRIPTS})
+run_update(-g -i ${SCRIPTS})
+run_update(-i ${FIRST_SCRIPT})
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E tar tf ${ARCHIVE}
+    RESULT_VARIABLE result OUTPUT_VARIABLE entries ERROR_VARIABLE entries)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Listing ${ARCHIVE} failed:\n${entries}")
+endif()
+string(APPEND output "${entries}")
+
+if(DEFINED ENV{DECOY_UPDATE_EXPECTED})
+    file(WRITE ${EXPECTED} "${output}")
+    return()
+endif()
+
+file(READ ${EXPECTED} expected)
+string(REPLACE "\r" "" expected "${expected}")
+string(REPLACE "\r" "" output "${output}")
+if(NOT output STREQUAL expected)
+    message(FATAL_ERROR "Output differs from ${EXPECTED}\n--- expected\n${expected}\n--- actual\n${output}")
+endif()
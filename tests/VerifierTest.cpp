@@ -0,0 +1,117 @@
+// Modules the verifier must reject, assembled by hand since the compiler never emits them.
+// Each case checks that verification fails with the expected problem; exits non-zero otherwise.
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "codegen/DecoyBytecode.hpp"
+#include "codegen/DecoyLittleEndian.hpp"
+#include "codegen/DecoyVerifier.hpp"
+
+struct Assembler {
+    std::vector<uint8_t> bytes;
+
+    size_t here() const { return bytes.size(); }
+
+    void byte(uint8_t value) { bytes.push_back(value); }
+
+    void ui32(uint32_t value) { writeUI32(bytes, value); }
+
+    void op(Instruction opcode) { byte(static_cast<uint8_t>(opcode)); }
+
+    void cv(const std::string& name, Type type, uint32_t offset) {
+        op(Instruction::CV);
+        ui32(static_cast<uint32_t>(name.size()));
+        bytes.insert(bytes.end(), name.begin(), name.end());
+        byte(static_cast<uint8_t>(type));
+        ui32(offset);
+    }
+
+    // Emits a label operand to be filled in by patch
+    size_t label() {
+        size_t at = here();
+        ui32(0);
+        return at;
+    }
+
+    void patch(size_t at, uint32_t address) {
+        for (int i = 0; i < 4; i++) bytes[at + i] = (address >> (8 * i)) & 0xFF;
+    }
+};
+
+static int failures = 0;
+
+static void expectRejected(const std::string& name, const std::vector<uint8_t>& module, size_t poolSize, const std::string& problem) {
+    auto result = verifyModule(module, poolSize);
+    for (const auto& reported : result.problems) {
+        if (reported.find(problem) != std::string::npos) return;
+    }
+
+    std::cerr << name << ": expected \"" << problem << "\", got";
+    if (result.passed()) std::cerr << " a pass";
+    for (const auto& reported : result.problems) std::cerr << "\n  " << reported;
+    std::cerr << '\n';
+    failures++;
+}
+
+int main() {
+    {
+        // The same module with the fill on every path passes, so the cases below fail for their own reason
+        Assembler a;
+        a.cv("x", Type::UI32, 0);
+        a.op(Instruction::FILL); a.byte(0); a.ui32(0);
+        a.op(Instruction::INCR); a.byte(0);
+        a.op(Instruction::SPILL); a.byte(0); a.ui32(0);
+        auto result = verifyModule(a.bytes, 0);
+        if (!result.passed()) {
+            std::cerr << "baseline: expected a pass, got " << result.problems.front() << '\n';
+            failures++;
+        }
+    }
+
+    {
+        // cejmp x x fill use / fill: fill r0 x / use: incr r0; the false branch skips the fill
+        Assembler a;
+        a.cv("x", Type::UI32, 0);
+        a.op(Instruction::CEJMP); a.ui32(0); a.ui32(0);
+        size_t toFill = a.label(), toUse = a.label();
+        a.patch(toFill, static_cast<uint32_t>(a.here()));
+        a.op(Instruction::FILL); a.byte(0); a.ui32(0);
+        a.patch(toUse, static_cast<uint32_t>(a.here()));
+        a.op(Instruction::INCR); a.byte(0);
+        a.op(Instruction::SPILL); a.byte(0); a.ui32(0);
+        expectRejected("fill on one path", a.bytes, 0, "Register 0 can be used before it is filled");
+    }
+
+    {
+        // A jump into the middle of the cv
+        Assembler a;
+        a.cv("x", Type::UI8, 0);
+        a.op(Instruction::JMP); a.ui32(1);
+        expectRejected("label inside an instruction", a.bytes, 0, "Jump target 1 is not an instruction boundary");
+    }
+
+    {
+        // p with one pooled string, index 3 of a pool of 2
+        Assembler a;
+        a.op(Instruction::P); a.byte(1); a.byte(POOLED_STRING_TAG); a.ui32(3);
+        expectRejected("pool index out of range", a.bytes, 2, "String pool index 3 out of range");
+    }
+
+    {
+        // A ui32 at offset 0 and a ui8 at offset 2, inside it
+        Assembler a;
+        a.cv("wide", Type::UI32, 0);
+        a.cv("narrow", Type::UI8, 2);
+        a.op(Instruction::INC); a.ui32(2);
+        expectRejected("overlapping declarations", a.bytes, 0, "Variable at offset 2 overlaps the one at offset 0");
+    }
+
+    if (failures != 0) {
+        std::cerr << failures << " verifier case(s) failed\n";
+        return 1;
+    }
+    return 0;
+}
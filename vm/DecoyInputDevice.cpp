@@ -0,0 +1,108 @@
+#include "DecoyInputDevice.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <utility>
+
+void InputDevice::pressKeys(std::span<const uint8_t> keys) {
+    for (uint8_t key : keys) {
+        pressKey(key);
+    }
+}
+
+void InputDevice::releaseKeys(std::span<const uint8_t> keys) {
+    for (uint8_t key : keys) {
+        releaseKey(key);
+    }
+}
+
+void InputDevice::playTimeline(std::span<const TimelineEvent> timeline) {
+    for (const auto& event : timeline) {
+        if (event.delay != 0) delay(event.delay);
+
+        switch (event.kind) {
+            case InputEventKind::PRESS_KEY:   pressKey(static_cast<uint8_t>(event.x)); break;
+            case InputEventKind::RELEASE_KEY: releaseKey(static_cast<uint8_t>(event.x)); break;
+            case InputEventKind::MOVE_MOUSE:  moveMouse(event.x, event.y); break;
+            default: break;
+        }
+    }
+}
+
+void RecordingInputDevice::pressKey(uint8_t key) {
+    keysDown[key] = true;
+    record({ now, InputEventKind::PRESS_KEY, key, 0, "" });
+}
+
+void RecordingInputDevice::releaseKey(uint8_t key) {
+    keysDown[key] = false;
+    record({ now, InputEventKind::RELEASE_KEY, key, 0, "" });
+}
+
+bool RecordingInputDevice::isKeyDown(uint8_t key) {
+    record({ now, InputEventKind::IS_KEY_DOWN, key, keysDown[key], "" });
+    return keysDown[key];
+}
+
+void RecordingInputDevice::moveMouse(int32_t x, int32_t y) {
+    record({ now, InputEventKind::MOVE_MOUSE, x, y, "" });
+}
+
+void RecordingInputDevice::print(const std::string& text) {
+    if (echoPrints) {
+        std::cout << text;
+    }
+    record({ now, InputEventKind::PRINT, 0, 0, text });
+}
+
+void RecordingInputDevice::delay(uint32_t milliseconds) {
+    record({ now, InputEventKind::DELAY, static_cast<int32_t>(milliseconds), 0, "" });
+    if (!virtualTime) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+    }
+    now += milliseconds;
+}
+
+void RecordingInputDevice::playTimeline(std::span<const TimelineEvent> timeline) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t elapsed = 0;
+
+    for (const auto& event : timeline) {
+        if (event.delay != 0) {
+            record({ now, InputEventKind::DELAY, static_cast<int32_t>(event.delay), 0, "" });
+            elapsed += event.delay;
+            if (!virtualTime) {
+                std::this_thread::sleep_until(start + std::chrono::milliseconds(elapsed));
+            }
+            now += event.delay;
+        }
+
+        switch (event.kind) {
+            case InputEventKind::PRESS_KEY:   pressKey(static_cast<uint8_t>(event.x)); break;
+            case InputEventKind::RELEASE_KEY: releaseKey(static_cast<uint8_t>(event.x)); break;
+            case InputEventKind::MOVE_MOUSE:  moveMouse(event.x, event.y); break;
+            default: break;
+        }
+    }
+}
+
+void RecordingInputDevice::record(InputEvent event) {
+    if (events.size() < eventLimit) {
+        events.push_back(std::move(event));
+    } else {
+        droppedEvents++;
+    }
+}
+
+const char* RecordingInputDevice::eventKindName(InputEventKind kind) {
+    switch (kind) {
+        case InputEventKind::PRESS_KEY:   return "pk";
+        case InputEventKind::RELEASE_KEY: return "rk";
+        case InputEventKind::IS_KEY_DOWN: return "ikd";
+        case InputEventKind::MOVE_MOUSE:  return "mvm";
+        case InputEventKind::PRINT:       return "p";
+        case InputEventKind::DELAY:       return "dl";
+        default:                          return "?";
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+enum class InputEventKind {
+    PRESS_KEY,
+    RELEASE_KEY,
+    IS_KEY_DOWN,
+    MOVE_MOUSE,
+    PRINT,
+    DELAY
+};
+
+// One record of a tl timeline: wait delay milliseconds, then do the event
+struct TimelineEvent {
+    uint32_t delay;
+    InputEventKind kind; // PRESS_KEY, RELEASE_KEY, MOVE_MOUSE, or DELAY for a wait with no event
+    int32_t x;           // Key, or mouse x
+    int32_t y;
+};
+
+// Everything a script can do to the outside world goes through an InputDevice
+class InputDevice {
+    public:
+    virtual ~InputDevice() = default;
+
+    virtual void pressKey(uint8_t key) = 0;
+    virtual void releaseKey(uint8_t key) = 0;
+    virtual bool isKeyDown(uint8_t key) = 0;
+    virtual void moveMouse(int32_t x, int32_t y) = 0;
+    virtual void print(const std::string& text) = 0;
+    virtual void delay(uint32_t milliseconds) = 0;
+
+    // Batches from pkb, rkb and tl. By default they go through the calls above one at a time;
+    // a device that can send several keys in one report, or schedule events itself, overrides them.
+    virtual void pressKeys(std::span<const uint8_t> keys);
+    virtual void releaseKeys(std::span<const uint8_t> keys);
+    virtual void playTimeline(std::span<const TimelineEvent> timeline);
+};
+
+struct InputEvent {
+    uint64_t time; // Milliseconds since the device was created (virtual or real)
+    InputEventKind kind;
+    int32_t x;
+    int32_t y;
+    std::string text;
+};
+
+// Headless device that records events instead of touching real hardware.
+// In virtual time mode delays advance a counter instead of sleeping.
+// Only the first eventLimit events are kept, so a long run does not grow without bound; the
+// rest are counted.
+class RecordingInputDevice : public InputDevice {
+    public:
+    static constexpr size_t DEFAULT_EVENT_LIMIT = 1000000;
+
+    RecordingInputDevice(bool virtualTime, bool echoPrints, size_t eventLimit = DEFAULT_EVENT_LIMIT)
+        : virtualTime(virtualTime), echoPrints(echoPrints), eventLimit(eventLimit) {}
+
+    void pressKey(uint8_t key) override;
+    void releaseKey(uint8_t key) override;
+    bool isKeyDown(uint8_t key) override;
+    void moveMouse(int32_t x, int32_t y) override;
+    void print(const std::string& text) override;
+    void delay(uint32_t milliseconds) override;
+
+    // Waits for each record's deadline counted from the start of the timeline, so time slept
+    // past one deadline comes off the next wait instead of adding up
+    void playTimeline(std::span<const TimelineEvent> timeline) override;
+
+    const std::vector<InputEvent>& getEvents() const { return events; }
+    uint64_t getDroppedEvents() const { return droppedEvents; }
+    uint64_t getTime() const { return now; }
+
+    static const char* eventKindName(InputEventKind kind);
+
+    private:
+    bool virtualTime;
+    bool echoPrints;
+    uint64_t now = 0;
+    std::array<bool, 256> keysDown{};
+    size_t eventLimit;
+    uint64_t droppedEvents = 0;
+    std::vector<InputEvent> events;
+
+    void record(InputEvent event);
+};
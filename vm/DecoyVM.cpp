@@ -0,0 +1,679 @@
+#include "DecoyVM.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+void VirtualMachine::load(std::span<const uint8_t> bytecode, std::span<const std::string> stringPool,
+    const ModuleCertificate* certificate) {
+    code.clear();
+    printLists.clear();
+    keyBatches.clear();
+    timelines.clear();
+    returnStack.clear();
+    pc = 0;
+    verified = certificate != nullptr;
+
+    // First pass: decode everything and lay out memory from cv declarations. Instructions are
+    // decoded in address order, so decoded doubles as the index of instruction boundaries.
+    std::vector<DecodedInstruction> decoded;
+    size_t memorySize = 0;
+    if (verified) {
+        decoded.reserve(certificate->instructions);
+        memorySize = certificate->memorySize;
+    }
+
+    BytecodeReader reader(bytecode);
+    while (!reader.isAtEnd()) {
+        decoded.push_back(reader.next());
+
+        const auto& instruction = decoded.back();
+        if (!verified && instruction.opcode == Instruction::CV) {
+            size_t end = instruction.operands[2].value + literalSize(instruction.operands[1].type);
+            memorySize = std::max(memorySize, end);
+        }
+    }
+
+    memory.assign(memorySize, 0);
+    slotTypes.assign(memorySize, Type::NT);
+    for (const auto& instruction : decoded) {
+        if (instruction.opcode == Instruction::CV) {
+            slotTypes[instruction.operands[2].value] = instruction.operands[1].type;
+        }
+    }
+    bindRegisters(decoded);
+
+    // Second pass: resolve operands against the memory layout and jump targets against instruction indices
+    code.reserve(decoded.size());
+    for (const auto& instruction : decoded) {
+        try {
+            Op op{ .handler = handlerFor(instruction.opcode), .opcode = instruction.opcode, .address = instruction.address };
+            const auto& operands = instruction.operands;
+
+            switch (instruction.opcode) {
+                case Instruction::P:
+                case Instruction::PL: {
+                    std::vector<PrintItem> items;
+                    for (const auto& operand : operands) {
+                        if (operand.kind == OperandKind::STRING) {
+                            items.push_back({ true, operand.text, {} });
+                        } else if (operand.kind == OperandKind::POOLED_STRING) {
+                            // The pool is an entry of its own, which the certificate does not cover
+                            if (operand.value >= stringPool.size()) {
+                                throw std::runtime_error("String pool index " + std::to_string(operand.value) + " out of range");
+                            }
+                            items.push_back({ true, stringPool[operand.value], {} });
+                        } else {
+                            items.push_back({ false, "", resolveVariable(operand.value) });
+                        }
+                    }
+                    op.printIndex = printLists.size();
+                    printLists.push_back(std::move(items));
+                    break;
+                }
+                case Instruction::PKB:
+                case Instruction::RKB: {
+                    std::vector<uint8_t> keys;
+                    for (const auto& operand : operands) {
+                        keys.push_back(static_cast<uint8_t>(operand.value));
+                    }
+                    op.batchIndex = keyBatches.size();
+                    keyBatches.push_back(std::move(keys));
+                    break;
+                }
+                case Instruction::TL: {
+                    Timeline timeline;
+                    for (size_t i = 0; i < operands.size(); i++) {
+                        uint32_t delay = operands[i].value;
+                        timeline.delayMilliseconds += delay;
+                        switch (operands[i].event) {
+                            case Instruction::PK:
+                                timeline.events.push_back({ delay, InputEventKind::PRESS_KEY, static_cast<int32_t>(operands[++i].value), 0 });
+                                break;
+                            case Instruction::RK:
+                                timeline.events.push_back({ delay, InputEventKind::RELEASE_KEY, static_cast<int32_t>(operands[++i].value), 0 });
+                                break;
+                            case Instruction::MVM: {
+                                int32_t x = static_cast<int32_t>(operands[++i].value);
+                                int32_t y = static_cast<int32_t>(operands[++i].value);
+                                timeline.events.push_back({ delay, InputEventKind::MOVE_MOUSE, x, y });
+                                break;
+                            }
+                            default:
+                                timeline.events.push_back({ delay, InputEventKind::DELAY, 0, 0 });
+                                break;
+                        }
+                    }
+                    op.batchIndex = timelines.size();
+                    timelines.push_back(std::move(timeline));
+                    break;
+                }
+                case Instruction::JMP:
+                case Instruction::CALL:
+                    op.onTrue = resolveLabel(operands[0].value, decoded);
+                    break;
+                case Instruction::CEJMP:
+                case Instruction::CGJMP:
+                case Instruction::CLJMP:
+                case Instruction::CEGJMP:
+                case Instruction::CELJMP:
+                case Instruction::CEJMPR:
+                case Instruction::CGJMPR:
+                case Instruction::CLJMPR:
+                case Instruction::CEGJMPR:
+                case Instruction::CELJMPR:
+                    op.a = resolveOperand(operands[0]);
+                    op.b = resolveOperand(operands[1]);
+                    op.onTrue = resolveLabel(operands[2].value, decoded);
+                    op.onFalse = resolveLabel(operands[3].value, decoded);
+                    break;
+                case Instruction::CV:
+                    break;
+                default:
+                    if (operands.size() > 0) op.a = resolveOperand(operands[0]);
+                    if (operands.size() > 1) op.b = resolveOperand(operands[1]);
+                    break;
+            }
+
+            code.push_back(op);
+        } catch (const std::exception& e) {
+            throw std::runtime_error("Offset " + std::to_string(instruction.address) + ": " + e.what());
+        }
+    }
+}
+
+ExecutionStats VirtualMachine::run(uint64_t maxSteps) {
+    ExecutionStats stats;
+    auto start = std::chrono::steady_clock::now();
+
+    const Op* ops = code.data();
+    const size_t count = code.size();
+    std::vector<uint64_t> executions(profiling ? count : 0);
+    const uint64_t overhead = timing ? clockOverhead() : 0;
+    delayMilliseconds = 0;
+    returnStack.reserve(MAX_CALL_DEPTH);
+
+    while (pc < count) {
+        if (maxSteps != 0 && stats.instructions >= maxSteps) break;
+
+        if (profiling) executions[pc]++;
+        const Op& op = ops[pc++];
+        stats.opcodeCounts[static_cast<uint8_t>(op.opcode)]++;
+        stats.instructions++;
+
+        if (timing) {
+            uint64_t delayed = delayMilliseconds;
+            auto before = std::chrono::steady_clock::now();
+            (this->*op.handler)(op);
+            uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - before).count();
+            stats.opcodeNanoseconds[static_cast<uint8_t>(op.opcode)] += elapsed > overhead ? elapsed - overhead : 0;
+            stats.opcodeDelayMilliseconds[static_cast<uint8_t>(op.opcode)] += delayMilliseconds - delayed;
+        } else {
+            (this->*op.handler)(op);
+        }
+    }
+
+    stats.finished = pc >= count;
+    for (size_t i = 0; i < executions.size(); i++) {
+        if (executions[i] != 0) {
+            stats.addressCounts.emplace_back(code[i].address, executions[i]);
+        }
+    }
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+// The cheapest of many back-to-back clock reads, as a floor for what reading it costs
+uint64_t VirtualMachine::clockOverhead() {
+    constexpr int SAMPLES = 1000;
+
+    uint64_t cheapest = UINT64_MAX;
+    for (int i = 0; i < SAMPLES; i++) {
+        auto before = std::chrono::steady_clock::now();
+        uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - before).count();
+        cheapest = std::min(cheapest, elapsed);
+    }
+    return cheapest;
+}
+
+VirtualMachine::Handler VirtualMachine::handlerFor(Instruction opcode) {
+    // Memory is laid out and zeroed by load(), so cv has nothing left to do at runtime
+    static const std::unordered_map<Instruction, Handler> handlers = {
+        {Instruction::CV, &VirtualMachine::execNop},
+        {Instruction::AV, &VirtualMachine::execAv},
+        {Instruction::AAV, &VirtualMachine::execAav},
+        {Instruction::SAV, &VirtualMachine::execSav},
+        {Instruction::MAV, &VirtualMachine::execMav},
+        {Instruction::DAV, &VirtualMachine::execDav},
+        {Instruction::MOAV, &VirtualMachine::execMoav},
+        {Instruction::INC, &VirtualMachine::execInc},
+        {Instruction::DEC, &VirtualMachine::execDec},
+        {Instruction::P, &VirtualMachine::execP},
+        {Instruction::PL, &VirtualMachine::execPl},
+        {Instruction::PK, &VirtualMachine::execPk},
+        {Instruction::RK, &VirtualMachine::execRk},
+        {Instruction::IKD, &VirtualMachine::execIkd},
+        {Instruction::MVM, &VirtualMachine::execMvm},
+        {Instruction::DFP, &VirtualMachine::execNop},
+        {Instruction::JMP, &VirtualMachine::execJmp},
+        {Instruction::CALL, &VirtualMachine::execCall},
+        {Instruction::RET, &VirtualMachine::execRet},
+        {Instruction::CEJMP, &VirtualMachine::execConditionalJmp},
+        {Instruction::CGJMP, &VirtualMachine::execConditionalJmp},
+        {Instruction::CLJMP, &VirtualMachine::execConditionalJmp},
+        {Instruction::CEGJMP, &VirtualMachine::execConditionalJmp},
+        {Instruction::CELJMP, &VirtualMachine::execConditionalJmp},
+        {Instruction::DL, &VirtualMachine::execDl},
+        {Instruction::PKB, &VirtualMachine::execPkb},
+        {Instruction::RKB, &VirtualMachine::execRkb},
+        {Instruction::TL, &VirtualMachine::execTl},
+        {Instruction::FILL, &VirtualMachine::execFill},
+        {Instruction::SPILL, &VirtualMachine::execSpill},
+        {Instruction::AVR, &VirtualMachine::execAv},
+        {Instruction::AAVR, &VirtualMachine::execAavr},
+        {Instruction::SAVR, &VirtualMachine::execSavr},
+        {Instruction::MAVR, &VirtualMachine::execMavr},
+        {Instruction::DAVR, &VirtualMachine::execDavr},
+        {Instruction::MOAVR, &VirtualMachine::execMoavr},
+        {Instruction::INCR, &VirtualMachine::execIncr},
+        {Instruction::DECR, &VirtualMachine::execDecr},
+        {Instruction::CEJMPR, &VirtualMachine::execConditionalJmp},
+        {Instruction::CGJMPR, &VirtualMachine::execConditionalJmp},
+        {Instruction::CLJMPR, &VirtualMachine::execConditionalJmp},
+        {Instruction::CEGJMPR, &VirtualMachine::execConditionalJmp},
+        {Instruction::CELJMPR, &VirtualMachine::execConditionalJmp},
+        {Instruction::NOP, &VirtualMachine::execNop}
+    };
+
+    auto it = handlers.find(opcode);
+    if (it == handlers.end()) {
+        throw std::runtime_error("No handler for opcode " + std::to_string(static_cast<int>(opcode)));
+    }
+    return it->second;
+}
+
+VirtualMachine::Operand VirtualMachine::resolveOperand(const DecodedOperand& operand) const {
+    if (operand.kind == OperandKind::VARIABLE) {
+        return resolveVariable(operand.value);
+    }
+    if (operand.kind == OperandKind::REGISTER) {
+        return resolveRegister(operand.value);
+    }
+
+    Operand resolved;
+    resolved.type = operand.type;
+    switch (operand.type) {
+        case Type::I8: resolved.literal = { false, static_cast<int8_t>(operand.value), 0 }; break;
+        case Type::UI8: resolved.literal = { false, static_cast<uint8_t>(operand.value), 0 }; break;
+        case Type::I16: resolved.literal = { false, static_cast<int16_t>(operand.value), 0 }; break;
+        case Type::UI16: resolved.literal = { false, static_cast<uint16_t>(operand.value), 0 }; break;
+        case Type::I32: resolved.literal = { false, static_cast<int32_t>(operand.value), 0 }; break;
+        case Type::UI32: resolved.literal = { false, static_cast<uint32_t>(operand.value), 0 }; break;
+        case Type::F32: {
+            float real;
+            memcpy(&real, &operand.value, sizeof(float));
+            resolved.literal = { true, 0, real };
+            break;
+        }
+        default: throw std::runtime_error("Invalid literal type");
+    }
+    return resolved;
+}
+
+VirtualMachine::Operand VirtualMachine::resolveVariable(uint32_t offset) const {
+    if (!verified && (offset >= slotTypes.size() || slotTypes[offset] == Type::NT)) {
+        throw std::runtime_error("Reference to undeclared variable at offset " + std::to_string(offset));
+    }
+
+    Operand resolved;
+    resolved.type = slotTypes[offset];
+    resolved.isVariable = true;
+    resolved.offset = offset;
+    return resolved;
+}
+
+VirtualMachine::Operand VirtualMachine::resolveRegister(uint32_t index) const {
+    if (!verified && registerTypes[index] == Type::NT) {
+        throw std::runtime_error("Register " + std::to_string(index) + " is never filled");
+    }
+
+    Operand resolved;
+    resolved.type = registerTypes[index];
+    resolved.isVariable = true;
+    resolved.isRegister = true;
+    resolved.offset = index;
+    return resolved;
+}
+
+// A register holds one variable for the whole module, so it takes the type of the variables
+// its fills and spills name, and starts out zero like memory does
+void VirtualMachine::bindRegisters(const std::vector<DecodedInstruction>& decoded) {
+    registerTypes.fill(Type::NT);
+    for (const auto& instruction : decoded) {
+        if (instruction.opcode != Instruction::FILL && instruction.opcode != Instruction::SPILL) continue;
+
+        uint32_t index = instruction.operands[0].value, offset = instruction.operands[1].value;
+        if (verified) {
+            registerTypes[index] = slotTypes[offset];
+            continue;
+        }
+
+        Type type = offset < slotTypes.size() ? slotTypes[offset] : Type::NT;
+        if (type == Type::NT) {
+            throw std::runtime_error("Offset " + std::to_string(instruction.address) + ": Reference to undeclared variable at offset " + std::to_string(offset));
+        }
+        if (registerTypes[index] != Type::NT && registerTypes[index] != type) {
+            throw std::runtime_error("Offset " + std::to_string(instruction.address) + ": Register " + std::to_string(index) + " holds variables of different types");
+        }
+        registerTypes[index] = type;
+    }
+
+    registers.fill(0);
+}
+
+size_t VirtualMachine::resolveLabel(uint32_t address, const std::vector<DecodedInstruction>& decoded) const {
+    auto it = std::lower_bound(decoded.begin(), decoded.end(), address,
+        [](const DecodedInstruction& instruction, uint32_t target) { return instruction.address < target; });
+    if (!verified) {
+        size_t end = decoded.empty() ? 0 : decoded.back().address + decoded.back().size;
+        if (it == decoded.end() ? address != end : it->address != address) {
+            throw std::runtime_error("Jump target " + std::to_string(address) + " is not an instruction boundary");
+        }
+    }
+    return it - decoded.begin();
+}
+
+VirtualMachine::Value VirtualMachine::load(const Operand& operand) const {
+    if (!operand.isVariable) return operand.literal;
+    if (operand.isRegister) {
+        int64_t bits = registers[operand.offset];
+        if (operand.type != Type::F32) return { false, bits, 0 };
+        float v;
+        memcpy(&v, &bits, sizeof(v));
+        return { true, 0, v };
+    }
+
+    const uint8_t* slot = memory.data() + operand.offset;
+    switch (operand.type) {
+        case Type::I8: return { false, static_cast<int8_t>(slot[0]), 0 };
+        case Type::UI8: return { false, slot[0], 0 };
+        case Type::I16: { int16_t v; memcpy(&v, slot, sizeof(v)); return { false, v, 0 }; }
+        case Type::UI16: { uint16_t v; memcpy(&v, slot, sizeof(v)); return { false, v, 0 }; }
+        case Type::I32: { int32_t v; memcpy(&v, slot, sizeof(v)); return { false, v, 0 }; }
+        case Type::UI32: { uint32_t v; memcpy(&v, slot, sizeof(v)); return { false, v, 0 }; }
+        case Type::F32: { float v; memcpy(&v, slot, sizeof(v)); return { true, 0, v }; }
+        default: throw runtimeError("Load from untyped variable");
+    }
+}
+
+void VirtualMachine::store(const Operand& variable, Value value) {
+    if (variable.isRegister) {
+        registers[variable.offset] = registerBits(variable.type, value);
+        return;
+    }
+
+    uint8_t* slot = memory.data() + variable.offset;
+    switch (variable.type) {
+        case Type::I8: case Type::UI8: {
+            auto v = static_cast<uint8_t>(toInteger(value));
+            slot[0] = v;
+            break;
+        }
+        case Type::I16: case Type::UI16: {
+            auto v = static_cast<uint16_t>(toInteger(value));
+            memcpy(slot, &v, sizeof(v));
+            break;
+        }
+        case Type::I32: case Type::UI32: {
+            auto v = static_cast<uint32_t>(toInteger(value));
+            memcpy(slot, &v, sizeof(v));
+            break;
+        }
+        case Type::F32: {
+            float v = toFloat(value);
+            memcpy(slot, &v, sizeof(v));
+            break;
+        }
+        default: throw runtimeError("Store to untyped variable");
+    }
+}
+
+// Wraps value to the width of the register's variable, exactly as a store to memory would
+int64_t VirtualMachine::registerBits(Type type, Value value) {
+    if (type != Type::F32) return wrapInteger(type, toInteger(value));
+
+    int64_t bits = 0;
+    float v = toFloat(value);
+    memcpy(&bits, &v, sizeof(v));
+    return bits;
+}
+
+int64_t VirtualMachine::wrapInteger(Type type, int64_t value) {
+    switch (type) {
+        case Type::I8: return static_cast<int8_t>(value);
+        case Type::UI8: return static_cast<uint8_t>(value);
+        case Type::I16: return static_cast<int16_t>(value);
+        case Type::UI16: return static_cast<uint16_t>(value);
+        case Type::I32: return static_cast<int32_t>(value);
+        case Type::UI32: return static_cast<uint32_t>(value);
+        default: throw std::runtime_error("Store to untyped register");
+    }
+}
+
+int64_t VirtualMachine::toInteger(Value value) {
+    return value.isFloat ? static_cast<int64_t>(value.real) : value.integer;
+}
+
+float VirtualMachine::toFloat(Value value) {
+    return value.isFloat ? value.real : static_cast<float>(value.integer);
+}
+
+std::string VirtualMachine::format(Value value) {
+    if (!value.isFloat) return std::to_string(value.integer);
+
+    std::ostringstream ss;
+    ss << value.real;
+    return ss.str();
+}
+
+void VirtualMachine::arithmetic(const Op& op, Instruction kind) {
+    Value lhs = load(op.a);
+    Value rhs = load(op.b);
+
+    if (op.a.type == Type::F32) {
+        float a = toFloat(lhs), b = toFloat(rhs), result = 0;
+        switch (kind) {
+            case Instruction::AAV: result = a + b; break;
+            case Instruction::SAV: result = a - b; break;
+            case Instruction::MAV: result = a * b; break;
+            case Instruction::DAV: result = a / b; break;
+            case Instruction::MOAV: result = std::fmod(a, b); break;
+            default: break;
+        }
+        store(op.a, { true, 0, result });
+        return;
+    }
+
+    // Integer variables compute in 64 bits and wrap to their own width on store
+    store(op.a, { false, integerArithmetic(kind, toInteger(lhs), toInteger(rhs)), 0 });
+}
+
+// Integer registers are already widened, so their arithmetic skips the Value round trip
+void VirtualMachine::registerArithmetic(const Op& op, Instruction kind) {
+    if (op.a.type == Type::F32) {
+        arithmetic(op, kind);
+        return;
+    }
+
+    int64_t& a = registers[op.a.offset];
+    a = wrapInteger(op.a.type, integerArithmetic(kind, a, toInteger(load(op.b))));
+}
+
+int64_t VirtualMachine::integerArithmetic(Instruction kind, int64_t a, int64_t b) const {
+    int64_t result = 0;
+    switch (kind) {
+        case Instruction::AAV: result = static_cast<int64_t>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b)); break;
+        case Instruction::SAV: result = static_cast<int64_t>(static_cast<uint64_t>(a) - static_cast<uint64_t>(b)); break;
+        case Instruction::MAV: result = static_cast<int64_t>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b)); break;
+        case Instruction::DAV:
+            if (b == 0) throw runtimeError("Division by zero");
+            result = a / b;
+            break;
+        case Instruction::MOAV:
+            if (b == 0) throw runtimeError("Modulus by zero");
+            result = a % b;
+            break;
+        default: break;
+    }
+    return result;
+}
+
+bool VirtualMachine::compare(const Op& op, Instruction kind) const {
+    Value lhs = load(op.a);
+    Value rhs = load(op.b);
+
+    if (lhs.isFloat || rhs.isFloat) {
+        float a = toFloat(lhs), b = toFloat(rhs);
+        switch (kind) {
+            case Instruction::CEJMP: case Instruction::CEJMPR: return a == b;
+            case Instruction::CGJMP: case Instruction::CGJMPR: return a > b;
+            case Instruction::CLJMP: case Instruction::CLJMPR: return a < b;
+            case Instruction::CEGJMP: case Instruction::CEGJMPR: return a >= b;
+            case Instruction::CELJMP: case Instruction::CELJMPR: return a <= b;
+            default: return false;
+        }
+    }
+
+    int64_t a = lhs.integer, b = rhs.integer;
+    switch (kind) {
+        case Instruction::CEJMP: case Instruction::CEJMPR: return a == b;
+        case Instruction::CGJMP: case Instruction::CGJMPR: return a > b;
+        case Instruction::CLJMP: case Instruction::CLJMPR: return a < b;
+        case Instruction::CEGJMP: case Instruction::CEGJMPR: return a >= b;
+        case Instruction::CELJMP: case Instruction::CELJMPR: return a <= b;
+        default: return false;
+    }
+}
+
+void VirtualMachine::execNop(const Op&) {
+}
+
+void VirtualMachine::execAv(const Op& op) {
+    store(op.a, load(op.b));
+}
+
+void VirtualMachine::execAav(const Op& op) {
+    arithmetic(op, Instruction::AAV);
+}
+
+void VirtualMachine::execSav(const Op& op) {
+    arithmetic(op, Instruction::SAV);
+}
+
+void VirtualMachine::execMav(const Op& op) {
+    arithmetic(op, Instruction::MAV);
+}
+
+void VirtualMachine::execDav(const Op& op) {
+    arithmetic(op, Instruction::DAV);
+}
+
+void VirtualMachine::execMoav(const Op& op) {
+    arithmetic(op, Instruction::MOAV);
+}
+
+void VirtualMachine::execInc(const Op& op) {
+    Value value = load(op.a);
+    if (value.isFloat) value.real += 1;
+    else value.integer++;
+    store(op.a, value);
+}
+
+void VirtualMachine::execDec(const Op& op) {
+    Value value = load(op.a);
+    if (value.isFloat) value.real -= 1;
+    else value.integer--;
+    store(op.a, value);
+}
+
+void VirtualMachine::execAavr(const Op& op) {
+    registerArithmetic(op, Instruction::AAV);
+}
+
+void VirtualMachine::execSavr(const Op& op) {
+    registerArithmetic(op, Instruction::SAV);
+}
+
+void VirtualMachine::execMavr(const Op& op) {
+    registerArithmetic(op, Instruction::MAV);
+}
+
+void VirtualMachine::execDavr(const Op& op) {
+    registerArithmetic(op, Instruction::DAV);
+}
+
+void VirtualMachine::execMoavr(const Op& op) {
+    registerArithmetic(op, Instruction::MOAV);
+}
+
+void VirtualMachine::execIncr(const Op& op) {
+    if (op.a.type == Type::F32) {
+        execInc(op);
+        return;
+    }
+    int64_t& value = registers[op.a.offset];
+    value = wrapInteger(op.a.type, value + 1);
+}
+
+void VirtualMachine::execDecr(const Op& op) {
+    if (op.a.type == Type::F32) {
+        execDec(op);
+        return;
+    }
+    int64_t& value = registers[op.a.offset];
+    value = wrapInteger(op.a.type, value - 1);
+}
+
+void VirtualMachine::execP(const Op& op) {
+    std::string text;
+    for (const auto& item : printLists[op.printIndex]) {
+        text += item.isString ? item.text : format(load(item.variable));
+    }
+    device.print(text);
+}
+
+void VirtualMachine::execPl(const Op& op) {
+    execP(op);
+    device.print("\n");
+}
+
+void VirtualMachine::execPk(const Op& op) {
+    device.pressKey(static_cast<uint8_t>(toInteger(load(op.a))));
+}
+
+void VirtualMachine::execRk(const Op& op) {
+    device.releaseKey(static_cast<uint8_t>(toInteger(load(op.a))));
+}
+
+void VirtualMachine::execIkd(const Op& op) {
+    bool down = device.isKeyDown(static_cast<uint8_t>(toInteger(load(op.a))));
+    store(op.b, { false, down ? 1 : 0, 0 });
+}
+
+void VirtualMachine::execMvm(const Op& op) {
+    device.moveMouse(static_cast<int32_t>(toInteger(load(op.a))), static_cast<int32_t>(toInteger(load(op.b))));
+}
+
+void VirtualMachine::execJmp(const Op& op) {
+    pc = op.onTrue;
+}
+
+void VirtualMachine::execCall(const Op& op) {
+    if (returnStack.size() == MAX_CALL_DEPTH) throw runtimeError("Call stack overflow");
+    returnStack.push_back(pc);
+    pc = op.onTrue;
+}
+
+void VirtualMachine::execRet(const Op& op) {
+    if (returnStack.empty()) throw runtimeError("ret without a call");
+    pc = returnStack.back();
+    returnStack.pop_back();
+}
+
+void VirtualMachine::execConditionalJmp(const Op& op) {
+    pc = compare(op, op.opcode) ? op.onTrue : op.onFalse;
+}
+
+void VirtualMachine::execDl(const Op& op) {
+    uint32_t milliseconds = static_cast<uint32_t>(toInteger(load(op.a)));
+    delayMilliseconds += milliseconds;
+    device.delay(milliseconds);
+}
+
+void VirtualMachine::execPkb(const Op& op) {
+    device.pressKeys(keyBatches[op.batchIndex]);
+}
+
+void VirtualMachine::execRkb(const Op& op) {
+    device.releaseKeys(keyBatches[op.batchIndex]);
+}
+
+void VirtualMachine::execTl(const Op& op) {
+    const Timeline& timeline = timelines[op.batchIndex];
+    delayMilliseconds += timeline.delayMilliseconds;
+    device.playTimeline(timeline.events);
+}
+
+void VirtualMachine::execFill(const Op& op) {
+    store(op.a, load(op.b));
+}
+
+void VirtualMachine::execSpill(const Op& op) {
+    store(op.b, load(op.a));
+}
+
+std::runtime_error VirtualMachine::runtimeError(const std::string& message) const {
+    return std::runtime_error("Offset " + std::to_string(code[pc - 1].address) + ": " + message);
+}
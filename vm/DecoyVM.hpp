@@ -0,0 +1,169 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "../codegen/DecoyBytecode.hpp"
+#include "../codegen/DecoyVerifier.hpp"
+#include "DecoyInputDevice.hpp"
+
+struct ExecutionStats {
+    uint64_t instructions = 0;
+    std::array<uint64_t, 256> opcodeCounts{};
+    double seconds = 0.0;
+    bool finished = false; // Ran off the end of the module rather than hitting the step limit
+    std::vector<std::pair<size_t, uint64_t>> addressCounts; // (address, executions), only when profiling
+    std::array<uint64_t, 256> opcodeNanoseconds{}; // Time spent in each opcode, only when timing
+    std::array<uint64_t, 256> opcodeDelayMilliseconds{}; // Waits each opcode asked the device for, part of its time above
+};
+
+// Headless reference interpreter for the bytecode CodeGenerator emits.
+// load() decodes the module once into an array of pre-resolved operations,
+// each carrying a pointer to its handler, so run() is a plain
+// fetch-and-call loop with no further decoding.
+class VirtualMachine {
+    public:
+    explicit VirtualMachine(InputDevice& device) : device(device) {}
+
+    // The bytecode is only read during load(), so it may live in a mapped archive. stringPool
+    // resolves pooled print strings and is needed only for modules that use them.
+    //
+    // load() checks every operand against the memory layout, registers and instruction
+    // boundaries, so run() never has to. A certificate from verifyModule says those checks have
+    // passed: load() then takes the memory size and instruction count from it and skips them.
+    // The caller makes sure the certificate belongs to these bytes (ModuleCertificate::certifies);
+    // a wrong one makes run() read and jump out of bounds.
+    void load(std::span<const uint8_t> bytecode, std::span<const std::string> stringPool = {},
+        const ModuleCertificate* certificate = nullptr);
+    ExecutionStats run(uint64_t maxSteps = 0);
+
+    // Count executions of every instruction, reported as ExecutionStats::addressCounts
+    void setProfiling(bool enabled) { profiling = enabled; }
+
+    // Time every instruction, reported as ExecutionStats::opcodeNanoseconds for calibrating a
+    // CostModel. The clock's own overhead is measured and left out, but timing still slows
+    // the run down considerably.
+    void setTiming(bool enabled) { timing = enabled; }
+
+    size_t getMemorySize() const { return memory.size(); }
+
+    // Nested calls deeper than this are a runtime error rather than unbounded growth
+    static constexpr size_t MAX_CALL_DEPTH = 1024;
+
+    private:
+    struct Value {
+        bool isFloat;
+        int64_t integer;
+        float real;
+    };
+
+    struct Operand {
+        Type type = Type::NT; // Variable type, or literal type when !isVariable
+        bool isVariable = false;
+        bool isRegister = false; // A variable held in registers[offset] rather than memory
+        uint32_t offset = 0;
+        Value literal{};
+    };
+
+    struct PrintItem {
+        bool isString;
+        std::string text;
+        Operand variable;
+    };
+
+    struct Timeline {
+        std::vector<TimelineEvent> events;
+        uint64_t delayMilliseconds = 0; // All its waits together
+    };
+
+    struct Op;
+    using Handler = void (VirtualMachine::*)(const Op& op);
+
+    struct Op {
+        Handler handler;
+        Instruction opcode;
+        size_t address;
+        Operand a;
+        Operand b;
+        size_t onTrue = 0;
+        size_t onFalse = 0;
+        size_t printIndex = 0;
+        size_t batchIndex = 0; // Into keyBatches or timelines
+    };
+
+    InputDevice& device;
+    std::vector<Op> code;
+    std::vector<std::vector<PrintItem>> printLists;
+    std::vector<std::vector<uint8_t>> keyBatches;
+    std::vector<Timeline> timelines;
+    std::vector<uint8_t> memory;
+    std::vector<Type> slotTypes; // Type of the variable starting at each offset, NT elsewhere
+    std::array<int64_t, REGISTER_COUNT> registers{}; // Integers widened to 64 bits, or the bits of an f32
+    std::array<Type, REGISTER_COUNT> registerTypes{}; // Type of the variable each register is filled from, NT if none
+    std::vector<size_t> returnStack; // Instruction index after each active call
+    size_t pc = 0;
+    bool verified = false; // The module being loaded has a certificate
+    bool profiling = false;
+    bool timing = false;
+    uint64_t delayMilliseconds = 0;
+
+    static Handler handlerFor(Instruction opcode);
+    static uint64_t clockOverhead();
+
+    Operand resolveOperand(const DecodedOperand& operand) const;
+    Operand resolveVariable(uint32_t offset) const;
+    Operand resolveRegister(uint32_t index) const;
+    void bindRegisters(const std::vector<DecodedInstruction>& decoded);
+    size_t resolveLabel(uint32_t address, const std::vector<DecodedInstruction>& decoded) const;
+
+    Value load(const Operand& operand) const;
+    void store(const Operand& variable, Value value);
+    static int64_t registerBits(Type type, Value value);
+    static int64_t wrapInteger(Type type, int64_t value);
+
+    static int64_t toInteger(Value value);
+    static float toFloat(Value value);
+    static std::string format(Value value);
+
+    void arithmetic(const Op& op, Instruction kind);
+    void registerArithmetic(const Op& op, Instruction kind);
+    int64_t integerArithmetic(Instruction kind, int64_t a, int64_t b) const;
+    bool compare(const Op& op, Instruction kind) const;
+
+    void execNop(const Op& op);
+    void execAv(const Op& op);
+    void execAav(const Op& op);
+    void execSav(const Op& op);
+    void execMav(const Op& op);
+    void execDav(const Op& op);
+    void execMoav(const Op& op);
+    void execInc(const Op& op);
+    void execDec(const Op& op);
+    void execP(const Op& op);
+    void execPl(const Op& op);
+    void execPk(const Op& op);
+    void execRk(const Op& op);
+    void execIkd(const Op& op);
+    void execMvm(const Op& op);
+    void execJmp(const Op& op);
+    void execCall(const Op& op);
+    void execRet(const Op& op);
+    void execConditionalJmp(const Op& op);
+    void execDl(const Op& op);
+    void execPkb(const Op& op);
+    void execRkb(const Op& op);
+    void execTl(const Op& op);
+    void execAavr(const Op& op);
+    void execSavr(const Op& op);
+    void execMavr(const Op& op);
+    void execDavr(const Op& op);
+    void execMoavr(const Op& op);
+    void execIncr(const Op& op);
+    void execDecr(const Op& op);
+    void execFill(const Op& op);
+    void execSpill(const Op& op);
+
+    std::runtime_error runtimeError(const std::string& message) const;
+};
@@ -0,0 +1,132 @@
+#include "DecoyFileWatcher.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+FileWatcher::FileWatcher(const std::vector<std::string>& paths) {
+    for (const auto& path : paths) {
+        files.push_back(fs::absolute(path).lexically_normal());
+    }
+    for (size_t i = 0; i < files.size(); i++) {
+        snapshots.push_back(snapshot(i));
+    }
+
+#ifdef __linux__
+    descriptor = inotify_init1(IN_CLOEXEC);
+    if (descriptor < 0) {
+        throw std::runtime_error("Could not initialize inotify");
+    }
+
+    std::set<fs::path> watched;
+    for (const auto& file : files) {
+        if (!watched.insert(file.parent_path()).second) continue;
+
+        int watch = inotify_add_watch(descriptor, file.parent_path().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (watch < 0) {
+            throw std::runtime_error("Could not watch " + file.parent_path().string());
+        }
+        directories[watch] = file.parent_path();
+    }
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+#ifdef __linux__
+    if (descriptor >= 0) close(descriptor);
+#endif
+}
+
+std::vector<size_t> FileWatcher::wait() {
+    while (true) {
+        std::vector<size_t> changed = descriptor >= 0 ? readEvents(-1) : poll();
+        if (changed.empty()) continue;
+
+        // Collect the rest of the burst, e.g. a save that touches several scripts at once
+        while (true) {
+            std::vector<size_t> more;
+            if (descriptor >= 0) {
+                more = readEvents(SETTLE_MS);
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(SETTLE_MS));
+                more = poll();
+            }
+            if (more.empty()) break;
+            changed.insert(changed.end(), more.begin(), more.end());
+        }
+
+        std::sort(changed.begin(), changed.end());
+        changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+        // An event is not proof of new contents (e.g. a file opened for writing and closed again)
+        std::erase_if(changed, [&](size_t index) {
+            Snapshot current = snapshot(index);
+            bool same = current == snapshots[index];
+            snapshots[index] = current;
+            return same;
+        });
+
+        if (!changed.empty()) return changed;
+    }
+}
+
+const char* FileWatcher::backendName() const {
+    return descriptor >= 0 ? "inotify" : "polling";
+}
+
+FileWatcher::Snapshot FileWatcher::snapshot(size_t index) const {
+    Snapshot result;
+    std::error_code error;
+    result.modified = fs::last_write_time(files[index], error);
+    if (error) return result;
+
+    result.size = fs::file_size(files[index], error);
+    result.exists = !error;
+    return result;
+}
+
+std::vector<size_t> FileWatcher::poll() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+
+    std::vector<size_t> changed;
+    for (size_t i = 0; i < files.size(); i++) {
+        if (snapshot(i) != snapshots[i]) changed.push_back(i);
+    }
+    return changed;
+}
+
+std::vector<size_t> FileWatcher::readEvents(int timeoutMs) {
+    std::vector<size_t> changed;
+
+#ifdef __linux__
+    pollfd request = { descriptor, POLLIN, 0 };
+    if (::poll(&request, 1, timeoutMs) <= 0) return changed;
+
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length = read(descriptor, buffer, sizeof(buffer));
+    for (ssize_t offset = 0; offset < length;) {
+        const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+        offset += sizeof(inotify_event) + event->len;
+        if (event->len == 0) continue;
+
+        fs::path path = directories[event->wd] / event->name;
+        for (size_t i = 0; i < files.size(); i++) {
+            if (files[i] == path) changed.push_back(i);
+        }
+    }
+#else
+    (void)timeoutMs;
+#endif
+
+    return changed;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Blocks until watched files change.
+//
+// On Linux this uses inotify on the files' directories, so editors that save by writing a
+// temporary file and renaming it over the original are seen too. Elsewhere it falls back to
+// polling modification times and sizes.
+class FileWatcher {
+    public:
+    explicit FileWatcher(const std::vector<std::string>& paths);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Indices (into paths) of every file that changed, once writes have settled
+    std::vector<size_t> wait();
+
+    const char* backendName() const;
+
+    private:
+    // Saves often arrive as several events; wait this long for the burst to end
+    static constexpr int SETTLE_MS = 5;
+    static constexpr int POLL_INTERVAL_MS = 10;
+
+    struct Snapshot {
+        bool exists = false;
+        std::filesystem::file_time_type modified;
+        uintmax_t size = 0;
+
+        bool operator==(const Snapshot&) const = default;
+    };
+
+    std::vector<std::filesystem::path> files;
+    std::vector<Snapshot> snapshots;
+
+    int descriptor = -1;
+    std::unordered_map<int, std::filesystem::path> directories; // Watch descriptor -> directory
+
+    Snapshot snapshot(size_t index) const;
+    std::vector<size_t> poll();
+    std::vector<size_t> readEvents(int timeoutMs);
+};